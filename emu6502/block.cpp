@@ -0,0 +1,184 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "block.h"
+
+BlockDevice::BlockDevice(Processor &CPU, Memory &RAM, byte Page, const MappedFile &Image, bool ReadOnly) : CPU(CPU), RAM(RAM), Image(Image)
+{
+	Base = (word)(Page << 8);
+	this->ReadOnly = ReadOnly;
+	Track = 0;
+	Busy = false;
+	Timing = {100, 300, 256, 16};
+	SectorsRead = 0;
+	SectorsWritten = 0;
+	StolenCycles = 0;
+	RAM.Fill(Base, 0x00, 0x100);
+	RAM.Attach(this, Page);
+}
+
+BlockDevice::~BlockDevice(void)
+{
+	RAM.Detach(this);
+}
+
+size_t BlockDevice::Sectors() const
+{
+	return (Image.Length() + SectorSize - 1) / SectorSize;
+}
+
+size_t BlockDevice::DirtySectors() const
+{
+	return Overlay.size();
+}
+
+void BlockDevice::Discard()
+{
+	Overlay.clear();
+}
+
+void BlockDevice::ReadSector(word Sector, byte *Destination) const
+{
+	auto written = Overlay.find(Sector);
+
+	if (written != Overlay.end())
+	{
+		memcpy(Destination, written->second.get(), SectorSize);
+		return;
+	}
+
+	size_t offset = (size_t)Sector * SectorSize;
+	size_t length = Image.Length() - offset < SectorSize ? Image.Length() - offset : SectorSize;
+
+	memcpy(Destination, Image.Data() + offset, length);
+	memset(Destination + length, 0, SectorSize - length);
+}
+
+bool BlockDevice::Transfer(byte Command, word Sector, word Address, byte Count)
+{
+	if (Sector + Count > Sectors() || (Command == bcWrite && ReadOnly))
+		return false;
+
+	for (int i = 0; i < Count; i++, Sector++, Address += SectorSize)
+	{
+		if (Command == bcRead)
+		{
+			auto written = Overlay.find(Sector);
+			size_t offset = (size_t)Sector * SectorSize;
+
+			// untouched full sectors go straight from the mapping
+			if (written == Overlay.end() && offset + SectorSize <= Image.Length())
+				RAM.CopyIn(Address, Image.Data() + offset, SectorSize);
+			else
+			{
+				byte sector[SectorSize];
+
+				ReadSector(Sector, sector);
+				RAM.CopyIn(Address, sector, SectorSize);
+			}
+			SectorsRead++;
+		}
+		else
+		{
+			std::unique_ptr<byte[]> &sector = Overlay[Sector];
+
+			if (!sector)
+				sector.reset(new byte[SectorSize]);
+			RAM.CopyOut(sector.get(), Address, SectorSize);
+			SectorsWritten++;
+		}
+	}
+
+	return true;
+}
+
+void BlockDevice::Write(word Address, byte Value)
+{
+	byte *registers = RAM.Pointer(Base + (Address & 0xF8));
+
+	switch (Address & 7)
+	{
+	case brStatus:
+		registers[brStatus] = 0;
+		break;
+	case brCommand:
+		byte command = Value & ~bcInterrupt;
+
+		if (command == 0 || Busy)
+			break;
+
+		word sector = (word)(registers[brSector] | registers[brSector + 1] << 8);
+		word address = (word)(registers[brAddress] | registers[brAddress + 1] << 8);
+		byte count = registers[brCount];
+		int track = sector / Timing.SectorsPerTrack;
+		Busy = true;
+		bool done = (command == bcRead || command == bcWrite) && Transfer(command, sector, address, count);
+		Busy = false;
+		int stolen = Timing.Command;
+
+		if (done && count > 0)
+		{
+			stolen += Timing.Seek * abs(track - Track) + Timing.Sector * count;
+			Track = (sector + count - 1) / Timing.SectorsPerTrack;
+		}
+
+		// a read may have landed on our own page, the commands it wrote there were ignored
+		registers[brCommand] = 0;
+		registers[brStatus] = done ? bsDone : bsDone | bsError;
+		RAM.Touch(Base);
+
+		CPU.Clock += stolen;
+		StolenCycles += stolen;
+
+		if (Value & bcInterrupt)
+			CPU.SendIRQ();
+		break;
+	}
+}
+
+bool BlockDevice::WriteBack(const char *Filename, LoadError *Error)
+{
+	FILE *file = fopen(Filename, "r+b");
+
+	if (file == nullptr)
+	{
+		if (Error != nullptr)
+			*Error = {0, 0, "cannot open file"};
+		return false;
+	}
+
+	bool written = true;
+
+	for (const auto &sector : Overlay)
+	{
+		if (fseek(file, (long)sector.first * SectorSize, SEEK_SET) != 0 || fwrite(sector.second.get(), 1, SectorSize, file) != SectorSize)
+		{
+			written = false;
+			break;
+		}
+	}
+
+	if (fclose(file) != 0)
+		written = false;
+	if (!written && Error != nullptr)
+		*Error = {0, 0, "cannot write file"};
+
+	return written;
+}
\ No newline at end of file
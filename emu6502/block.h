@@ -0,0 +1,98 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include "types.h"
+#include "device.h"
+#include "memory.h"
+#include "processor.h"
+#include "mappedfile.h"
+
+// block device registers, offsets from the base address
+enum BlockRegisters : byte {
+	brSector	= 0,	// 2 bytes, little endian, first sector of the transfer
+	brAddress	= 2,	// 2 bytes, guest memory, wraps around at $FFFF
+	brCount		= 4,	// sectors, 0 does nothing
+	brCommand	= 5,	// BlockCommands, cleared once the command is done
+	brStatus	= 6		// BlockStatuses, any write clears it
+};
+
+enum BlockCommands : byte {
+	bcRead		= 1,	// image to memory
+	bcWrite		= 2,	// memory to image
+	bcInterrupt	= 128	// IRQ when the command completes
+};
+
+enum BlockStatuses : byte {
+	bsDone		= 1,
+	bsError		= 2		// sector past the end of the image, write to a read only device or unknown command
+};
+
+// cycles a command keeps the CPU waiting
+struct BlockTiming
+{
+	int	Command;			// fixed cost of every command
+	int	Seek;				// per track the head moves
+	int	Sector;				// per sector transferred
+	int	SectorsPerTrack;
+};
+
+// disk image as a memory mapped block device with 256 bytes sectors, one per 6502 page
+// the image is mapped read only and can be shared by any number of devices, sectors written by
+// the guest go to a private copy on write overlay that WriteBack() can save
+// like Dma, a command completes at once and charges its latency to the CPU clock
+class BlockDevice : public Device
+{
+protected:
+	Processor			&CPU;
+	Memory				&RAM;
+	const MappedFile	&Image;
+	word				Base;
+	bool				ReadOnly;
+	int					Track;		// head position
+	bool				Busy;		// a read can land on our page and write the command register again
+
+	std::unordered_map<word, std::unique_ptr<byte[]>>	Overlay;	// written sectors
+
+	bool Transfer(byte Command, word Sector, word Address, byte Count);
+	void ReadSector(word Sector, byte *Destination) const;
+
+public:
+	static const int SectorSize = 256;
+
+	BlockTiming	Timing;
+	uint64_t	SectorsRead;
+	uint64_t	SectorsWritten;
+	uint64_t	StolenCycles;
+
+	BlockDevice(Processor &CPU, Memory &RAM, byte Page, const MappedFile &Image, bool ReadOnly = false);
+	~BlockDevice(void);
+	void Write(word Address, byte Value) override;
+
+	size_t Sectors() const;			// in the image, the last one may be partial and reads padded with zeros
+	size_t DirtySectors() const;	// in the overlay
+	void Discard();					// drops the overlay, the guest sees the image as it is again
+	// writes the overlay into Filename, usually the image itself (no other device should be using it then)
+	// Filename must exist, it is extended when needed
+	bool WriteBack(const char *Filename, LoadError *Error = nullptr);
+};
\ No newline at end of file
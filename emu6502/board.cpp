@@ -0,0 +1,248 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include "board.h"
+
+Board::Board(int Count, int Quantum, bool Threads) : Machines(Count > 0 ? Count : 1), Barrier(Threads && Count > 1 ? Count : 1, QuantumEnd{this})
+{
+	Count = Count > 0 ? Count : 1;
+	this->Quantum = Quantum > 0 ? Quantum : 1;
+	this->Threads = Threads && Count > 1;
+	Remaining = 0;
+	Done = true;
+	Epoch = 0;
+	Finished = 0;
+	Quit = false;
+	Time = 0;
+	Quanta = 0;
+	memset(SharedPages, 0, sizeof(SharedPages));
+	Base.assign(0x10000, 0x00);
+
+	Lanes.resize(Count);
+	for (Lane &lane : Lanes)
+	{
+		lane.Instance = Machines.Acquire();
+		lane.Cycles = 0;
+		lane.Reason = srBudget;
+		lane.Stopped = lane.Instance == nullptr;
+	}
+
+	if (this->Threads && IsOpen())
+		for (int i = 1; i < Count; i++)
+			Workers.emplace_back(&Board::Worker, this, i);
+}
+
+Board::~Board(void)
+{
+	Quit = true;
+	Epoch++;
+	Epoch.notify_all();
+	for (std::thread &worker : Workers)
+		worker.join();
+	for (Lane &lane : Lanes)
+		if (lane.Instance != nullptr)
+			Machines.Release(lane.Instance);
+}
+
+bool Board::IsOpen() const
+{
+	return Machines.IsOpen();
+}
+
+int Board::Count() const
+{
+	return (int)Lanes.size();
+}
+
+Machine &Board::Core(int Index)
+{
+	return *Lanes[Index].Instance;
+}
+
+void Board::Share(byte First, int Pages)
+{
+	for (int page = First; page < First + Pages && page < 0x100; page++)
+	{
+		word address = (word)(page << 8);
+
+		SharedPages[page >> 6] |= 1ULL << (page & 63);
+		Lanes[0].Instance->RAM.CopyOut(Base.data() + address, address, 0x100);
+		for (size_t i = 1; i < Lanes.size(); i++)
+			Lanes[i].Instance->RAM.CopyIn(address, Base.data() + address, 0x100);
+	}
+}
+
+bool Board::IsShared(byte Page) const
+{
+	return (SharedPages[Page >> 6] >> (Page & 63)) & 1;
+}
+
+void Board::RunQuantum(int Index)
+{
+	Lane &lane = Lanes[Index];
+	Processor &cpu = lane.Instance->CPU;
+	uint64_t end = Time + Quantum;
+
+	while (!lane.Stopped && lane.Cycles < end)
+	{
+		// Clock belongs to the processor (a Profiler reads it), only the difference counts here,
+		// it is rebased now and then since boards run for ever
+		if (cpu.Clock >= ClockRebase)
+			cpu.Clock = 0;
+
+		int start = cpu.Clock;
+		StopReasons reason = cpu.Run((int)(end - lane.Cycles));
+
+		lane.Cycles += cpu.Clock - start;
+		if (reason == srLoop)
+			// only an interrupt gets it out of there and they come between runs, the quantum is idle
+			lane.Cycles = end;
+		else if (reason != srBudget)
+		{
+			lane.Reason = reason;
+			lane.Stopped = true;
+		}
+	}
+}
+
+void Board::Merge()
+{
+	byte merged[0x100];
+
+	for (int page = 0; page < 0x100; page++)
+	{
+		if (!IsShared((byte)page))
+			continue;
+
+		word address = (word)(page << 8);
+		const byte *base = Base.data() + address;
+		bool changed = false;
+
+		memcpy(merged, base, sizeof(merged));
+		for (Lane &lane : Lanes)
+		{
+			std::span<const byte> current = lane.Instance->RAM.View(address, 0x100);
+
+			if (memcmp(current.data(), base, 0x100) == 0)
+				continue;
+			for (int i = 0; i < 0x100; i++)
+				if (current[i] != base[i])
+					merged[i] = current[i];
+			changed = true;
+		}
+
+		if (!changed)
+			continue;
+		memcpy(Base.data() + address, merged, sizeof(merged));
+		for (Lane &lane : Lanes)
+			lane.Instance->RAM.CopyIn(address, merged, sizeof(merged));
+	}
+}
+
+void Board::EndQuantum()
+{
+	bool stopped = true;
+
+	Merge();
+	Time += Quantum;
+	Quanta++;
+	Remaining--;
+	for (const Lane &lane : Lanes)
+		stopped &= lane.Stopped;
+	Done = Remaining == 0 || stopped;
+}
+
+void Board::Loop(int Index)
+{
+	while (!Done)
+	{
+		RunQuantum(Index);
+		Barrier.arrive_and_wait();
+	}
+}
+
+void Board::Worker(int Index)
+{
+	uint32_t epoch = 0;
+
+	while (true)
+	{
+		Epoch.wait(epoch);
+		epoch = Epoch.load();
+		if (Quit)
+			return;
+
+		Loop(Index);
+		Finished++;
+		Finished.notify_one();
+	}
+}
+
+bool Board::Run(uint64_t Cycles)
+{
+	bool stopped = true;
+
+	for (const Lane &lane : Lanes)
+		stopped &= lane.Stopped;
+	if (stopped || Cycles == 0)
+		return !stopped;
+
+	Remaining = (Cycles + Quantum - 1) / Quantum;
+	Done = false;
+
+	if (!Threads)
+	{
+		while (!Done)
+		{
+			for (int i = 0; i < Count(); i++)
+				RunQuantum(i);
+			EndQuantum();
+		}
+	}
+	else
+	{
+		Finished = 0;
+		Epoch++;
+		Epoch.notify_all();
+		Loop(0);
+
+		// the workers still have to see Done before the next Run() resets it
+		for (int finished = Finished.load(); finished < Count() - 1; finished = Finished.load())
+			Finished.wait(finished);
+	}
+
+	for (const Lane &lane : Lanes)
+		if (!lane.Stopped)
+			return true;
+	return false;
+}
+
+bool Board::IsStopped(int Index) const
+{
+	return Lanes[Index].Stopped;
+}
+
+StopReasons Board::Reason(int Index) const
+{
+	return Lanes[Index].Reason;
+}
+
+uint64_t Board::Cycles(int Index) const
+{
+	return Lanes[Index].Cycles;
+}
\ No newline at end of file
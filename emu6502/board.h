@@ -0,0 +1,103 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <barrier>
+#include <thread>
+#include <vector>
+#include "types.h"
+#include "pool.h"
+
+// several 6502s, each with its own memory, exchanging data through shared pages (mailboxes)
+// every CPU runs Quantum cycles on its own host thread, then they all meet at a barrier where
+// the shared pages are merged: each byte a CPU changed during the quantum is applied in CPU
+// order (the last CPU wins when two of them wrote the same byte) and the result is copied back
+// to every CPU. Writes to a shared page are seen by the other CPUs at the next quantum, whatever
+// the host thread timing, so runs are reproducible and Threads = false gives the same results
+// accesses to shared pages are not serialised: within a quantum each CPU reads its own copy, so
+// read-modify-write on a byte that several CPUs write loses updates (two CPUs doing INC on the
+// same counter add 1, not 2) and test-and-set locks let every CPU in; mailboxes need one writer
+// per byte, e.g. a request byte written by one CPU and an acknowledge byte written by the other
+class Board
+{
+protected:
+	struct alignas(64) Lane
+	{
+		Machine		*Instance;
+		uint64_t	Cycles;		// local time, can run ahead of Time by the last instruction
+		StopReasons	Reason;
+		bool		Stopped;	// BRK, breakpoint or illegal opcode, doesn't run anymore
+	};
+
+	// runs on the last thread to reach the barrier
+	struct QuantumEnd
+	{
+		Board	*Owner;
+		void operator () () noexcept { Owner->EndQuantum(); }
+	};
+
+	Pool				Machines;
+	std::vector<Lane>	Lanes;
+	int					Quantum;
+	bool				Threads;
+	uint64_t			SharedPages[4];
+	std::vector<byte>	Base;				// 64kb, content of the shared pages at the start of the quantum
+	uint64_t			Remaining;			// quanta left in this Run()
+	bool				Done;				// written by EndQuantum(), read after the barrier
+	std::barrier<QuantumEnd>	Barrier;
+	std::vector<std::thread>	Workers;
+	std::atomic<uint32_t>		Epoch;		// bumped by Run() to wake the workers up
+	std::atomic<int>			Finished;	// workers done with the current Run()
+	bool						Quit;
+
+	void RunQuantum(int Index);
+	void EndQuantum();
+	void Merge();
+	void Loop(int Index);		// worker thread Index runs its CPU until Done
+	void Worker(int Index);
+
+public:
+	uint64_t	Time;		// cycles since the board was built, a multiple of Quantum
+	uint64_t	Quanta;
+
+	// Threads: one host thread per CPU (the caller of Run() being the first one), false runs them
+	// one after the other on the caller thread, Quantum stays below ClockRebase
+	Board(int Count, int Quantum = 1000, bool Threads = true);
+	~Board(void);
+	Board(const Board &) = delete;
+	Board &operator = (const Board &) = delete;
+
+	bool IsOpen() const;
+	int Count() const;
+	Machine &Core(int Index);	// only touch it between calls to Run()
+	// shares the pages from First to First + Pages - 1, their content is taken from CPU 0
+	void Share(byte First, int Pages = 1);
+	bool IsShared(byte Page) const;
+
+	// runs every CPU for Cycles rounded up to a whole number of quanta
+	// returns false once every CPU is stopped
+	bool Run(uint64_t Cycles);
+	bool IsStopped(int Index) const;
+	StopReasons Reason(int Index) const;
+	uint64_t Cycles(int Index) const;
+};
\ No newline at end of file
@@ -0,0 +1,254 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include <memory>
+#include <vector>
+#include "capi.h"
+#include "pool.h"
+#include "image.h"
+
+static_assert((int)esIllegal == (int)srIllegal, "EmuStopReasons and StopReasons must match");
+static_assert(sizeof(EmuRegisters) == 12, "EmuRegisters is part of the ABI");
+static_assert(sizeof(EmuRange) == 8, "EmuRange is part of the ABI");
+
+struct EmuMachine
+{
+	Machine		*Instance;
+	EmuPool		*Owner;
+	size_t		Slot;		// position in Owner->Acquired
+};
+
+struct EmuPool
+{
+	Pool	Machines;
+	std::vector<std::unique_ptr<EmuMachine>>	Acquired;
+
+	EmuPool(uint32_t Count) : Machines(Count) {}
+};
+
+static void CopyError(EmuLoadError *Target, const LoadError &Source)
+{
+	if (Target)
+	{
+		Target->Line = Source.Line;
+		Target->Column = Source.Column;
+		Target->Message = Source.Message;
+	}
+}
+
+int32_t EmuAbiVersion(void)
+{
+	return EMU_ABI_VERSION;
+}
+
+EmuPool *EmuCreatePool(uint32_t Count)
+{
+	EmuPool *pool = new EmuPool(Count);
+
+	if (!pool->Machines.IsOpen())
+	{
+		delete pool;
+		return nullptr;
+	}
+
+	return pool;
+}
+
+void EmuDestroyPool(EmuPool *Pool)
+{
+	delete Pool;
+}
+
+EmuMachine *EmuAcquire(EmuPool *Pool)
+{
+	if (!Pool)
+		return nullptr;
+
+	Machine *instance = Pool->Machines.Acquire();
+
+	if (!instance)
+		return nullptr;
+
+	Pool->Acquired.push_back(std::make_unique<EmuMachine>(EmuMachine{instance, Pool, Pool->Acquired.size()}));
+	return Pool->Acquired.back().get();
+}
+
+void EmuRelease(EmuMachine *Machine)
+{
+	if (!Machine)
+		return;
+
+	EmuPool *pool = Machine->Owner;
+	size_t slot = Machine->Slot;
+
+	pool->Machines.Release(Machine->Instance);
+
+	// the last handle takes the released one's place
+	std::swap(pool->Acquired[slot], pool->Acquired.back());
+	pool->Acquired[slot]->Slot = slot;
+	pool->Acquired.pop_back();
+}
+
+void EmuHardReset(EmuMachine *Machine, uint8_t FillByte)
+{
+	Machine->Instance->CPU.HardReset(FillByte);
+}
+
+int32_t EmuLoadFile(EmuMachine *Machine, const char *Filename, EmuLoadError *Error)
+{
+	LoadError error = {};
+
+	if (Machine->Instance->RAM.ReadFile(Filename, &error))
+		return 1;
+
+	CopyError(Error, error);
+	return 0;
+}
+
+int32_t EmuLoadHex(EmuMachine *Machine, const char *Text, size_t Length, EmuLoadError *Error)
+{
+	Image image;
+	LoadError error = {};
+
+	if (image.ParseHex(Text, Length, &error) && Machine->Instance->RAM.Load(image))
+		return 1;
+
+	CopyError(Error, error);
+	return 0;
+}
+
+int32_t EmuLoadBinary(EmuMachine *Machine, uint16_t Address, const uint8_t *Data, size_t Length)
+{
+	if (Length > 0x10000)
+		return 0;
+
+	Machine->Instance->RAM.CopyIn(Address, Data, Length);
+	return 1;
+}
+
+void EmuSetStops(EmuMachine *Machine, int32_t EndOnBreak, int32_t Breakpoint)
+{
+	Machine->Instance->CPU.EndOnBreak = EndOnBreak != 0;
+	Machine->Instance->CPU.Breakpoint = Breakpoint;
+}
+
+void EmuGetRegisters(const EmuMachine *Machine, EmuRegisters *Registers)
+{
+	const Processor &cpu = Machine->Instance->CPU;
+
+	*Registers = EmuRegisters{cpu.Clock, cpu.PC, cpu.A, cpu.X, cpu.Y, cpu.S, cpu.P, 0};
+}
+
+void EmuSetRegisters(EmuMachine *Machine, const EmuRegisters *Registers)
+{
+	Processor &cpu = Machine->Instance->CPU;
+
+	cpu.Clock = Registers->Clock;
+	cpu.PC = Registers->PC;
+	cpu.A = Registers->A;
+	cpu.X = Registers->X;
+	cpu.Y = Registers->Y;
+	cpu.S = Registers->S;
+	cpu.P = Registers->P;
+}
+
+void EmuSendIRQ(EmuMachine *Machine)
+{
+	Machine->Instance->CPU.SendIRQ();
+}
+
+void EmuSendNMI(EmuMachine *Machine)
+{
+	Machine->Instance->CPU.SendNMI();
+}
+
+void EmuSendRST(EmuMachine *Machine)
+{
+	Machine->Instance->CPU.SendRST();
+}
+
+int32_t EmuRun(EmuMachine *Machine, int32_t Cycles, EmuRegisters *Registers)
+{
+	if (!Machine || Cycles < 0)
+		return esError;
+
+	int32_t reason = Machine->Instance->CPU.Run(Cycles);
+
+	if (Registers)
+		EmuGetRegisters(Machine, Registers);
+
+	return reason;
+}
+
+int64_t EmuRunMany(EmuMachine *const *Machines, size_t Count, int32_t Cycles, int32_t *Reasons, EmuRegisters *Registers)
+{
+	int64_t total = 0;
+
+	for (size_t i = 0; i < Count; i++)
+	{
+		Processor &cpu = Machines[i]->Instance->CPU;
+		int start = cpu.Clock;
+		int32_t reason = EmuRun(Machines[i], Cycles, Registers ? Registers + i : nullptr);
+
+		total += cpu.Clock - start;
+		if (Reasons)
+			Reasons[i] = reason;
+	}
+
+	return total;
+}
+
+void EmuRead(const EmuMachine *Machine, uint16_t Address, uint8_t *Buffer, size_t Length)
+{
+	Machine->Instance->RAM.CopyOut(Buffer, Address, Length);
+}
+
+void EmuWrite(EmuMachine *Machine, uint16_t Address, const uint8_t *Data, size_t Length)
+{
+	Machine->Instance->RAM.CopyIn(Address, Data, Length);
+}
+
+void EmuFill(EmuMachine *Machine, uint16_t Address, uint8_t Value, size_t Length)
+{
+	Machine->Instance->RAM.Fill(Address, Value, Length);
+}
+
+size_t EmuReadRanges(const EmuMachine *Machine, const EmuRange *Ranges, size_t Count, uint8_t *Buffer)
+{
+	size_t total = 0;
+
+	for (size_t i = 0; i < Count; i++)
+	{
+		Machine->Instance->RAM.CopyOut(Buffer + total, Ranges[i].Address, Ranges[i].Length);
+		total += Ranges[i].Length;
+	}
+
+	return total;
+}
+
+size_t EmuWriteRanges(EmuMachine *Machine, const EmuRange *Ranges, size_t Count, const uint8_t *Data)
+{
+	size_t total = 0;
+
+	for (size_t i = 0; i < Count; i++)
+	{
+		Machine->Instance->RAM.CopyIn(Ranges[i].Address, Data + total, Ranges[i].Length);
+		total += Ranges[i].Length;
+	}
+
+	return total;
+}
\ No newline at end of file
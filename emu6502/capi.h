@@ -0,0 +1,109 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+/* plain C interface, built as libemu6502 (emu6502lib project on Windows, elsewhere every emu6502
+   source but main.cpp with g++ -std=c++20 -O2 -shared -fPIC -fno-semantic-interposition)
+   meant for foreign function interfaces (ctypes, cgo, etc.): every call does a whole run or moves
+   whole blocks of memory and registers, never a single instruction or byte at a time
+   a pool and its machines must not be used from two threads at once, different pools can */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bumped whenever a signature or a structure below changes */
+#define EMU_ABI_VERSION 1
+
+typedef struct EmuPool EmuPool;			/* opaque */
+typedef struct EmuMachine EmuMachine;	/* opaque, belongs to the pool it was acquired from */
+
+/* same values as StopReasons */
+enum EmuStopReasons {
+	esError = -1,		/* invalid argument */
+	esBudget,
+	esBreak,
+	esBreakpoint,
+	esLoop,
+	esIllegal
+};
+
+typedef struct EmuRegisters {
+	int32_t		Clock;
+	uint16_t	PC;
+	uint8_t		A, X, Y, S, P;
+	uint8_t		Reserved;
+} EmuRegisters;
+
+/* one block of the 6502 address space, wraps around after $FFFF */
+typedef struct EmuRange {
+	uint16_t	Address;
+	uint16_t	Reserved;
+	uint32_t	Length;
+} EmuRange;
+
+typedef struct EmuLoadError {
+	int32_t		Line;		/* 1-based, 0 when the error is not tied to a line */
+	int32_t		Column;
+	const char	*Message;	/* static string, never freed */
+} EmuLoadError;
+
+int32_t EmuAbiVersion(void);
+
+/* machines are carved out of one arena, see Pool */
+EmuPool *EmuCreatePool(uint32_t Count);
+void EmuDestroyPool(EmuPool *Pool);			/* also releases every machine acquired from it */
+EmuMachine *EmuAcquire(EmuPool *Pool);		/* NULL when every machine is in use */
+void EmuRelease(EmuMachine *Machine);		/* back to its power on state, ready for the next EmuAcquire() */
+void EmuHardReset(EmuMachine *Machine, uint8_t FillByte);
+
+/* loading returns 1 on success, 0 with Error filled (when not NULL) otherwise */
+int32_t EmuLoadFile(EmuMachine *Machine, const char *Filename, EmuLoadError *Error);	/* .hex or raw binary */
+int32_t EmuLoadHex(EmuMachine *Machine, const char *Text, size_t Length, EmuLoadError *Error);
+int32_t EmuLoadBinary(EmuMachine *Machine, uint16_t Address, const uint8_t *Data, size_t Length);
+
+/* Breakpoint: address where runs stop, -1 for none */
+void EmuSetStops(EmuMachine *Machine, int32_t EndOnBreak, int32_t Breakpoint);
+void EmuGetRegisters(const EmuMachine *Machine, EmuRegisters *Registers);
+void EmuSetRegisters(EmuMachine *Machine, const EmuRegisters *Registers);
+void EmuSendIRQ(EmuMachine *Machine);
+void EmuSendNMI(EmuMachine *Machine);
+void EmuSendRST(EmuMachine *Machine);
+
+/* runs Cycles and returns why it stopped, Registers (when not NULL) gets the final state */
+int32_t EmuRun(EmuMachine *Machine, int32_t Cycles, EmuRegisters *Registers);
+/* runs Count machines one after the other, each for Cycles, Reasons and Registers (when not NULL)
+   get Count entries, returns the total number of cycles run */
+int64_t EmuRunMany(EmuMachine *const *Machines, size_t Count, int32_t Cycles, int32_t *Reasons, EmuRegisters *Registers);
+
+void EmuRead(const EmuMachine *Machine, uint16_t Address, uint8_t *Buffer, size_t Length);
+void EmuWrite(EmuMachine *Machine, uint16_t Address, const uint8_t *Data, size_t Length);
+void EmuFill(EmuMachine *Machine, uint16_t Address, uint8_t Value, size_t Length);
+/* gather / scatter: the ranges are packed one after the other in Buffer / Data,
+   returns the number of bytes copied */
+size_t EmuReadRanges(const EmuMachine *Machine, const EmuRange *Ranges, size_t Count, uint8_t *Buffer);
+size_t EmuWriteRanges(EmuMachine *Machine, const EmuRange *Ranges, size_t Count, const uint8_t *Data);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
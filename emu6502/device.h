@@ -0,0 +1,32 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "types.h"
+
+// memory mapped peripheral, see Memory::Attach()
+// its registers are plain memory: reads see whatever the device last stored there, writes from
+// the CPU, a DMA transfer or the bulk Memory functions land first and are reported afterwards
+class Device
+{
+public:
+	virtual ~Device(void) {}
+	virtual void Write(word Address, byte Value) = 0;
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include "dma.h"
+
+Dma::Dma(Processor &CPU, Memory &RAM, byte Page) : CPU(CPU), RAM(RAM)
+{
+	Base = (word)(Page << 8);
+	Busy = false;
+	Setup = 4;
+	CyclesPerByte = 1;
+	Transfers = 0;
+	Bytes = 0;
+	StolenCycles = 0;
+	RAM.Fill(Base, 0x00, 0x100);
+	RAM.Attach(this, Page);
+}
+
+Dma::~Dma(void)
+{
+	RAM.Detach(this);
+}
+
+void Dma::Write(word Address, byte Value)
+{
+	byte *registers = RAM.Pointer(Base + (Address & 0xF8));
+
+	switch (Address & 7)
+	{
+	case drStatus:
+		registers[drStatus] = 0;
+		break;
+	case drControl:
+		if (!(Value & dcStart) || Busy)
+			break;
+
+		word source = (word)(registers[drSource] | registers[drSource + 1] << 8);
+		word destination = (word)(registers[drDestination] | registers[drDestination + 1] << 8);
+		word length = (word)(registers[drLength] | registers[drLength + 1] << 8);
+		int stolen = Setup + length * CyclesPerByte;
+
+		Busy = true;
+		RAM.Copy(destination, source, length);
+		Busy = false;
+
+		// the transfer may have overwritten the registers
+		registers[drControl] &= ~dcStart;
+		registers[drStatus] |= dsDone;
+		RAM.Touch(Base);
+
+		CPU.Clock += stolen;
+		Transfers++;
+		Bytes += length;
+		StolenCycles += stolen;
+
+		if (Value & dcInterrupt)
+			CPU.SendIRQ();
+		break;
+	}
+}
\ No newline at end of file
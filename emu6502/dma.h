@@ -0,0 +1,69 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+#include "device.h"
+#include "memory.h"
+#include "processor.h"
+
+// DMA controller registers, offsets from the base address
+enum DmaRegisters : byte {
+	drSource		= 0,	// 2 bytes, little endian
+	drDestination	= 2,	// 2 bytes
+	drLength		= 4,	// 2 bytes, 0 copies nothing but the transfer still completes (Setup, dsDone, IRQ)
+	drControl		= 6,	// DmaControls
+	drStatus		= 7		// DmaStatuses, any write clears it
+};
+
+enum DmaControls : byte {
+	dcStart		= 1,	// cleared once the transfer is done
+	dcInterrupt	= 2		// IRQ when a transfer completes
+};
+
+enum DmaStatuses : byte {
+	dsDone		= 1
+};
+
+// cycle stealing block transfer: writing dcStart halts the CPU for Setup + Length * CyclesPerByte
+// cycles while Memory::Copy() moves the block, so the whole transfer is done by the time the
+// next instruction runs, ROM pages are left alone and device pages see the writes
+// the registers take a whole page (Memory::Attach() works on pages), each 8 bytes slot of it is a
+// separate set of registers sharing the one transfer engine
+class Dma : public Device
+{
+protected:
+	Processor	&CPU;
+	Memory		&RAM;
+	word		Base;
+	bool		Busy;		// the transfer itself can write to our page
+
+public:
+	int			Setup;			// cycles stolen on top of the bytes
+	int			CyclesPerByte;
+	uint64_t	Transfers;
+	uint64_t	Bytes;
+	uint64_t	StolenCycles;
+
+	Dma(Processor &CPU, Memory &RAM, byte Page);
+	~Dma(void);
+	void Write(word Address, byte Value) override;
+};
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstring>
+#include "hash.h"
+
+static const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+static const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+static uint64_t RotateLeft(uint64_t Value, int Count)
+{
+	return (Value << Count) | (Value >> (64 - Count));
+}
+
+static uint64_t Read64(const unsigned char *Pointer)
+{
+	uint64_t value;
+	memcpy(&value, Pointer, 8);	// little endian hosts only
+	return value;
+}
+
+static uint32_t Read32(const unsigned char *Pointer)
+{
+	uint32_t value;
+	memcpy(&value, Pointer, 4);
+	return value;
+}
+
+static uint64_t Round(uint64_t Accumulator, uint64_t Input)
+{
+	Accumulator += Input * Prime2;
+	Accumulator = RotateLeft(Accumulator, 31);
+	return Accumulator * Prime1;
+}
+
+static uint64_t MergeRound(uint64_t Accumulator, uint64_t Value)
+{
+	Accumulator ^= Round(0, Value);
+	return Accumulator * Prime1 + Prime4;
+}
+
+uint64_t Hash64(const void *Data, size_t Length, uint64_t Seed)
+{
+	const unsigned char *p = (const unsigned char *)Data;
+	const unsigned char *end = p + Length;
+	uint64_t hash;
+
+	if (Length >= 32)
+	{
+		const unsigned char *limit = end - 32;
+		uint64_t v1 = Seed + Prime1 + Prime2;
+		uint64_t v2 = Seed + Prime2;
+		uint64_t v3 = Seed;
+		uint64_t v4 = Seed - Prime1;
+
+		// the four lanes are independent, which keeps the pipeline (or the vectorizer) busy
+		do
+		{
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	}
+	else
+	{
+		hash = Seed + Prime5;
+	}
+
+	hash += (uint64_t)Length;
+
+	while (p + 8 <= end)
+	{
+		hash ^= Round(0, Read64(p));
+		hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+		p += 8;
+	}
+
+	if (p + 4 <= end)
+	{
+		hash ^= (uint64_t)Read32(p) * Prime1;
+		hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+		p += 4;
+	}
+
+	while (p < end)
+	{
+		hash ^= (*p) * Prime5;
+		hash = RotateLeft(hash, 11) * Prime1;
+		p++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
@@ -0,0 +1,61 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include "hooks.h"
+
+HookTable::HookTable(void)
+{
+	memset(Targets, 0, sizeof(Targets));
+}
+
+void HookTable::Add(word Address, HookFunction Function, int Cycles)
+{
+	Entries[Address] = {Function, Cycles, false};
+	Enable(Address, true);
+}
+
+void HookTable::Remove(word Address)
+{
+	Enable(Address, false);
+	Entries.erase(Address);
+}
+
+void HookTable::Enable(word Address, bool Enabled)
+{
+	auto entry = Entries.find(Address);
+
+	if (entry == Entries.end())
+		return;
+
+	entry->second.Enabled = Enabled;
+	if (Enabled)
+		Targets[Address >> 6] |= 1ULL << (Address & 63);
+	else
+		Targets[Address >> 6] &= ~(1ULL << (Address & 63));
+}
+
+void HookTable::EnableAll(bool Enabled)
+{
+	for (auto &entry : Entries)
+		Enable(entry.first, Enabled);
+}
+
+bool HookTable::IsEnabled(word Address) const
+{
+	return Find(Address) != nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include "types.h"
+
+class Processor;
+class Memory;
+
+// native implementation of a subroutine, it runs in place of the 6502 code when JSR targets it:
+// the return address is on the stack as usual, the function works on the registers and memory
+// (through the bus functions like Memory::CopyIn() so ROM and devices behave) and returns true
+// to have the processor return from the subroutine, false to run the 6502 code after all
+typedef bool (*HookFunction)(Processor &CPU, Memory &RAM);
+
+struct Hook
+{
+	HookFunction	Function;
+	int				Cycles;		// charged for the body of the routine, the JSR and RTS are counted as usual
+	bool			Enabled;	// false runs the 6502 code, to check the hook against it
+};
+
+// hooks by subroutine address, see Processor::Hooks
+// one table can be shared by any number of processors as long as it isn't changed while they run
+class HookTable
+{
+protected:
+	uint64_t	Targets[1024];	// one bit per address with an enabled hook, keeps JSR cheap
+	std::unordered_map<word, Hook>	Entries;
+
+public:
+	HookTable(void);
+	void Add(word Address, HookFunction Function, int Cycles);	// replaces the hook at Address, enabled
+	void Remove(word Address);
+	void Enable(word Address, bool Enabled);
+	void EnableAll(bool Enabled);
+	bool IsEnabled(word Address) const;
+
+	// enabled hook at Address, nullptr if none
+	const Hook *Find(word Address) const
+	{
+		if (!((Targets[Address >> 6] >> (Address & 63)) & 1))
+			return nullptr;
+
+		return &Entries.find(Address)->second;
+	}
+};
\ No newline at end of file
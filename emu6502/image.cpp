@@ -0,0 +1,483 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstring>
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <chrono>
+#include "image.h"
+#include "hash.h"
+
+using std::string;
+using std::to_string;
+using std::ofstream;
+using std::ios;
+using std::streamsize;
+
+// ASCII to nibble value, 0xFF for anything that is not an hexadecimal digit
+struct HexDigitTable
+{
+	byte Value[256];
+
+	HexDigitTable()
+	{
+		memset(Value, 0xFF, sizeof(Value));
+		for (int i = 0; i < 10; i++)
+			Value['0' + i] = i;
+		for (int i = 0; i < 6; i++)
+		{
+			Value['A' + i] = 10 + i;
+			Value['a' + i] = 10 + i;
+		}
+	}
+};
+
+static const HexDigitTable HexDigits;
+
+enum RecordTypes {
+	rData = 0,
+	rEndOfFile,
+	rExtendedSegmentAddress,
+	rStartSegmentAddress,
+	rExtendedLinearAddress,
+	rStartLinearAddress
+};
+
+// cache files start with this header, followed by one CacheBank per bank, the segments and
+// then the 64kb of each bank at 64kb aligned offsets so they can be mapped straight into Memory
+struct CacheHeader
+{
+	char		Magic[8];
+	uint32_t	Version;
+	uint32_t	BankCount;
+	uint32_t	SegmentCount;
+	uint32_t	StartAddress;
+	uint64_t	SourceHash;		// hash and size of the .hex file the cache was built from
+	uint64_t	SourceSize;
+};
+
+struct CacheBank
+{
+	uint32_t	Index;
+	uint32_t	Reserved;
+	uint64_t	Pages[4];
+	uint64_t	Offset;
+};
+
+static const char		CacheMagic[8] = {'E', 'M', 'U', '6', '5', '0', '2', 'C'};
+static const uint32_t	CacheVersion = 1;
+
+static bool Fail(LoadError *Error, int Line, int Column, const char *Message)
+{
+	if (Error != nullptr)
+	{
+		Error->Line = Line;
+		Error->Column = Column;
+		Error->Message = Message;
+	}
+	return false;
+}
+
+Image::Image(void)
+{
+	Cache = nullptr;
+	StartAddress = 0;
+}
+
+Image::~Image(void)
+{
+	Clear();
+}
+
+void Image::Clear()
+{
+	for (auto &bank : Banks)
+	{
+		if (Cache == nullptr)
+			delete[] bank.second->Data;
+		delete bank.second;
+	}
+
+	delete Cache;
+	Cache = nullptr;
+	Banks.clear();
+	Segments.clear();
+	StartAddress = 0;
+}
+
+Image::Bank *Image::GetBank(uint32_t Index)
+{
+	Bank *&bank = Banks[Index];
+
+	if (bank == nullptr)
+	{
+		bank = new Bank;
+		bank->Data = new byte[0x10000];
+		bank->Offset = 0;
+		memset(bank->Pages, 0, sizeof(bank->Pages));
+		memset(bank->Data, 0xFF, 0x10000);
+	}
+
+	return bank;
+}
+
+const Image::Bank *Image::FindBank(uint32_t Index) const
+{
+	auto bank = Banks.find(Index);
+
+	return bank == Banks.end() ? nullptr : bank->second;
+}
+
+size_t Image::BankCount() const
+{
+	return Banks.size();
+}
+
+const MappedFile *Image::CacheFile() const
+{
+	return Cache;
+}
+
+void Image::Store(uint32_t Address, const byte *Data, size_t Length)
+{
+	if (Length == 0)
+		return;
+
+	if (!Segments.empty() && Segments.back().Address + Segments.back().Length == Address)
+		Segments.back().Length += (uint32_t)Length;
+	else
+		Segments.push_back({Address, (uint32_t)Length});
+
+	while (Length > 0)
+	{
+		Bank *bank = GetBank(Address >> 16);
+		word offset = Address & 0xFFFF;
+		size_t count = 0x10000 - offset;
+
+		if (count > Length)
+			count = Length;
+
+		memcpy(bank->Data + offset, Data, count);
+		for (uint32_t page = offset >> 8; page <= (offset + count - 1) >> 8; page++)
+			bank->Pages[page >> 6] |= 1ULL << (page & 63);
+
+		Address += (uint32_t)count;
+		Data += count;
+		Length -= count;
+	}
+}
+
+bool Image::ReadHex(const char *Filename, LoadError *Error, const char *CacheDirectory)
+{
+	MappedFile file(Filename);
+
+	if (!file.IsOpen())
+		return Fail(Error, 0, 0, "cannot open file");
+
+	if (CacheDirectory == nullptr)
+		return ParseHex((const char *)file.Data(), file.Length(), Error);
+
+	// hashing the source is a lot cheaper than parsing it and guarantees the cache is up to date
+	uint64_t	hash = Hash64(file.Data(), file.Length());
+	string		cache;
+
+	if (*CacheDirectory == 0)
+		cache = string(Filename) + ".cache";
+	else
+	{
+		char name[24];
+
+		snprintf(name, sizeof(name), "/%016llX.cache", (unsigned long long)hash);
+		cache = CacheDirectory + string(name);
+	}
+
+	if (ReadCache(cache.c_str(), hash, file.Length()))
+		return true;
+
+	if (!ParseHex((const char *)file.Data(), file.Length(), Error))
+		return false;
+
+	// not being able to write the cache doesn't prevent us from using the image
+	WriteCache(cache.c_str(), hash, file.Length());
+	return true;
+}
+
+bool Image::ReadCache(const char *Filename, uint64_t SourceHash, uint64_t SourceSize)
+{
+	MappedFile *file = new MappedFile(Filename);
+	const byte *data = file->Data();
+	size_t length = file->Length();
+
+	Clear();
+
+	if (!file->IsOpen() || length < sizeof(CacheHeader))
+	{
+		delete file;
+		return false;
+	}
+
+	CacheHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	size_t directory = sizeof(CacheHeader) + (size_t)header.BankCount * sizeof(CacheBank);
+	size_t segments = directory + (size_t)header.SegmentCount * sizeof(Segment);
+
+	if (memcmp(header.Magic, CacheMagic, sizeof(CacheMagic)) != 0 || header.Version != CacheVersion ||
+		header.SourceHash != SourceHash || header.SourceSize != SourceSize || 
+		header.BankCount > 0x10000 || segments > length)
+	{
+		delete file;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.BankCount; i++)
+	{
+		CacheBank entry;
+		memcpy(&entry, data + sizeof(CacheHeader) + i * sizeof(CacheBank), sizeof(entry));
+
+		if ((entry.Offset & 0xFFFF) || entry.Offset + 0x10000 > length)
+		{
+			// the banks we already have point to the mapping
+			Cache = file;
+			Clear();
+			return false;
+		}
+
+		Bank *bank = new Bank;
+		memcpy(bank->Pages, entry.Pages, sizeof(bank->Pages));
+		bank->Data = (byte *)data + entry.Offset;	// read-only, the image is never modified once loaded
+		bank->Offset = entry.Offset;
+		Banks[entry.Index] = bank;
+	}
+
+	Segments.resize(header.SegmentCount);
+	if (header.SegmentCount)
+		memcpy(Segments.data(), data + directory, header.SegmentCount * sizeof(Segment));
+
+	StartAddress = header.StartAddress;
+	Cache = file;
+	return true;
+}
+
+bool Image::WriteCache(const char *Filename, uint64_t SourceHash, uint64_t SourceSize) const
+{
+	// jobs running in parallel may try to build the same cache: each one writes its own 
+	// temporary file and renames it when it's complete
+	string temporary = string(Filename) + "." + to_string((uintptr_t)this ^ (uintptr_t)std::chrono::steady_clock::now().time_since_epoch().count());
+	ofstream file(temporary, ios::binary);
+	CacheHeader header;
+
+	memcpy(header.Magic, CacheMagic, sizeof(CacheMagic));
+	header.Version = CacheVersion;
+	header.BankCount = (uint32_t)Banks.size();
+	header.SegmentCount = (uint32_t)Segments.size();
+	header.StartAddress = StartAddress;
+	header.SourceHash = SourceHash;
+	header.SourceSize = SourceSize;
+	file.write((const char *)&header, sizeof(header));
+
+	uint64_t offset = sizeof(CacheHeader) + Banks.size() * sizeof(CacheBank) + Segments.size() * sizeof(Segment);
+	offset = (offset + 0xFFFF) & ~0xFFFFULL;
+
+	for (auto &bank : Banks)
+	{
+		CacheBank entry;
+
+		entry.Index = bank.first;
+		entry.Reserved = 0;
+		memcpy(entry.Pages, bank.second->Pages, sizeof(entry.Pages));
+		entry.Offset = offset;
+		file.write((const char *)&entry, sizeof(entry));
+		offset += 0x10000;
+	}
+
+	if (!Segments.empty())
+		file.write((const char *)Segments.data(), Segments.size() * sizeof(Segment));
+
+	static const char padding[0x10000] = {};
+
+	for (auto &bank : Banks)
+	{
+		uint64_t position = (uint64_t)file.tellp();
+
+		file.write(padding, (streamsize)(((position + 0xFFFF) & ~0xFFFFULL) - position));
+		file.write((const char *)bank.second->Data, 0x10000);
+	}
+
+	file.close();
+
+	if (file.fail())
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	// rename() doesn't replace existing files on Windows
+	remove(Filename);
+#endif
+	if (rename(temporary.c_str(), Filename) != 0)
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+// record layout, after the colon:
+// byte count (1 byte) | address (2 bytes) | record type (1 byte) | data (byte count bytes) | checksum (1 byte)
+// every byte is written as two hexadecimal digits
+bool Image::ParseHex(const char *Text, size_t Length, LoadError *Error)
+{
+	const byte	*p = (const byte *)Text;
+	const byte	*end = p + Length;
+	byte		record[1 + 2 + 1 + 255 + 1];
+	uint32_t	base = 0;			// from extended address records
+	bool		segmented = false;	// true if base comes from an extended segment address record
+	int			line = 1;
+
+	Clear();
+
+	while (p < end)
+	{
+		const byte *start = p;
+
+		if (*p == '\n' || *p == '\r')
+		{
+			// empty line
+			if (*p == '\r' && p + 1 < end && p[1] == '\n')
+				p++;
+			p++;
+			line++;
+			continue;
+		}
+
+		if (*p != ':')
+			return Fail(Error, line, 1, "record should start with a colon");
+		p++;
+
+		if (end - p < 2 || ((HexDigits.Value[p[0]] | HexDigits.Value[p[1]]) & 0xF0))
+			return Fail(Error, line, 2, "invalid byte count");
+
+		int		count = (HexDigits.Value[p[0]] << 4) | HexDigits.Value[p[1]];
+		int		size = count + 5;
+		byte	invalid = 0;
+
+		if (end - p < size * 2)
+			return Fail(Error, line, (int)(end - start) + 1, "record is truncated");
+
+		// decode the whole record before checking for bad digits so the loop doesn't branch
+		for (int i = 0; i < size; i++)
+		{
+			byte hi = HexDigits.Value[p[i * 2]];
+			byte lo = HexDigits.Value[p[i * 2 + 1]];
+
+			invalid |= hi | lo;
+			record[i] = (hi << 4) | lo;
+		}
+
+		if (invalid & 0xF0)
+		{
+			for (int i = 0; i < size * 2; i++)
+			{
+				if (HexDigits.Value[p[i]] & 0xF0)
+					return Fail(Error, line, i + 2, (p[i] == '\r' || p[i] == '\n') ? "record is truncated" : "invalid hexadecimal digit");
+			}
+		}
+
+		byte checksum = 0;
+		for (int i = 0; i < size; i++)
+			checksum += record[i];
+
+		if (checksum != 0)
+			return Fail(Error, line, size * 2, "checksum error");
+
+		p += size * 2;
+
+		if (p < end && *p != '\n' && *p != '\r')
+			return Fail(Error, line, (int)(p - start) + 1, "record is too long");
+
+		word		offset = (record[1] << 8) | record[2];
+		const byte	*data = record + 4;
+
+		switch (record[3])
+		{
+		case rData:
+			if (segmented && offset + count > 0x10000)
+			{
+				// segmented addresses wrap around within the 64kb segment
+				int split = 0x10000 - offset;
+
+				Store(base + offset, data, split);
+				Store(base, data + split, count - split);
+			}
+			else
+				Store(base + offset, data, count);
+			break;
+		case rEndOfFile:
+			return true;
+		case rExtendedSegmentAddress:
+			if (count != 2)
+				return Fail(Error, line, 2, "extended segment address record should hold 2 bytes");
+			base = ((data[0] << 8) | data[1]) << 4;
+			segmented = true;
+			break;
+		case rStartSegmentAddress:
+			if (count != 4)
+				return Fail(Error, line, 2, "start segment address record should hold 4 bytes");
+			StartAddress = (((data[0] << 8) | data[1]) << 4) + ((data[2] << 8) | data[3]);
+			break;
+		case rExtendedLinearAddress:
+			if (count != 2)
+				return Fail(Error, line, 2, "extended linear address record should hold 2 bytes");
+			base = ((data[0] << 8) | data[1]) << 16;
+			segmented = false;
+			break;
+		case rStartLinearAddress:
+			if (count != 4)
+				return Fail(Error, line, 2, "start linear address record should hold 4 bytes");
+			StartAddress = ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+			break;
+		default:
+			return Fail(Error, line, 8, "unknown record type");
+		}
+	}
+
+	return Fail(Error, line, 1, "missing end of file record");
+}
+
+bool Image::IsHexFile(const char *Filename)
+{
+	const char *dot = strrchr(Filename, '.');
+	const char *extension = ".hex";
+
+	if (dot == nullptr)
+		return false;
+
+	for (; *dot && *extension; dot++, extension++)
+	{
+		if (tolower(*dot) != *extension)
+			return false;
+	}
+
+	return *dot == *extension;
+}
\ No newline at end of file
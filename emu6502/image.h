@@ -0,0 +1,83 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <vector>
+#include "types.h"
+#include "mappedfile.h"
+
+// where and why loading a file failed
+struct LoadError
+{
+	int			Line;		// 1-based, 0 when the error is not tied to a line
+	int			Column;		// 1-based
+	const char	*Message;
+};
+
+// program image with a 32 bits address space (Intel HEX extended addresses)
+// split in 64kb banks, Memory::Load() copies one bank into the 6502 address space
+class Image
+{
+public:
+	struct Bank
+	{
+		uint64_t	Pages[4];		// one bit per 256 bytes page holding data
+		byte		*Data;			// 64kb, 0xFF where nothing was loaded
+		uint64_t	Offset;			// position of Data in the cache file, if loaded from one
+	};
+
+	struct Segment
+	{
+		uint32_t	Address;
+		uint32_t	Length;
+	};
+
+protected:
+	std::map<uint32_t, Bank *>	Banks;		// indexed by address >> 16
+	MappedFile					*Cache;		// owns the bank data when loaded from a cache file
+
+	Bank *GetBank(uint32_t Index);
+	void Store(uint32_t Address, const byte *Data, size_t Length);
+	bool ReadCache(const char *Filename, uint64_t SourceHash, uint64_t SourceSize);
+	bool WriteCache(const char *Filename, uint64_t SourceHash, uint64_t SourceSize) const;
+
+public:
+	std::vector<Segment>	Segments;		// contiguous runs of data, in file order
+	uint32_t				StartAddress;	// from start address records (03/05), 0 if none
+	
+	Image(void);
+	~Image(void);
+	Image(const Image &) = delete;
+	Image &operator = (const Image &) = delete;
+
+	void Clear();
+	// with a CacheDirectory the parsed image is saved in a binary cache file ("" puts it next to 
+	// the source file), later calls map the cache file instead of parsing the source again
+	bool ReadHex(const char *Filename, LoadError *Error = nullptr, const char *CacheDirectory = nullptr);
+	bool ParseHex(const char *Text, size_t Length, LoadError *Error = nullptr);
+	const Bank *FindBank(uint32_t Index) const;	// nullptr if nothing was loaded in this bank
+	size_t BankCount() const;
+	const MappedFile *CacheFile() const;		// nullptr unless the banks come from a cache file
+
+	static bool IsHexFile(const char *Filename);	// .hex extension, whatever the case
+};
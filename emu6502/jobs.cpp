@@ -0,0 +1,521 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include "jobs.h"
+#include "pool.h"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::unique_ptr;
+using std::atomic;
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::function;
+using std::ifstream;
+using std::ostringstream;
+using std::to_string;
+
+static bool Fail(LoadError *Error, int Line, int Column, const char *Message)
+{
+	if (Error != nullptr)
+	{
+		Error->Line = Line;
+		Error->Column = Column;
+		Error->Message = Message;
+	}
+
+	return false;
+}
+
+static int HexValue(char Digit)
+{
+	if (Digit >= '0' && Digit <= '9')
+		return Digit - '0';
+	if ((Digit | 0x20) >= 'a' && (Digit | 0x20) <= 'f')
+		return (Digit | 0x20) - 'a' + 10;
+	return -1;
+}
+
+// whole token as an hexadecimal number of at most Digits digits
+static bool ReadHexNumber(const char *Text, size_t Length, size_t Digits, uint32_t &Value)
+{
+	if (Length == 0 || Length > Digits)
+		return false;
+
+	Value = 0;
+	for (size_t i = 0; i < Length; i++)
+	{
+		int digit = HexValue(Text[i]);
+
+		if (digit < 0)
+			return false;
+		Value = Value << 4 | digit;
+	}
+
+	return true;
+}
+
+// "0200:A9D5" for inputs, "0300:10" for outputs
+static bool ReadRange(const char *Text, size_t Length, bool Bytes, Job::Range &Range)
+{
+	const char *colon = (const char *)memchr(Text, ':', Length);
+	uint32_t value;
+
+	if (colon == nullptr || !ReadHexNumber(Text, colon - Text, 4, value))
+		return false;
+	Range.Address = (word)value;
+
+	const char *data = colon + 1;
+	size_t size = Text + Length - data;
+
+	if (!Bytes)
+	{
+		if (!ReadHexNumber(data, size, 5, value) || value == 0 || value > 0x10000)
+			return false;
+		Range.Data.resize(value);
+		return true;
+	}
+
+	if (size == 0 || size & 1 || size / 2 > 0x10000)
+		return false;
+
+	Range.Data.resize(size / 2);
+	for (size_t i = 0; i < size; i += 2)
+	{
+		int high = HexValue(data[i]);
+		int low = HexValue(data[i + 1]);
+
+		if (high < 0 || low < 0)
+			return false;
+		Range.Data[i / 2] = (byte)(high << 4 | low);
+	}
+
+	return true;
+}
+
+bool ParseManifest(const char *Text, size_t Length, vector<Job> &Jobs, LoadError *Error)
+{
+	const char *end = Text + Length;
+	int line = 0;
+
+	for (const char *p = Text; p < end; )
+	{
+		const char *eol = (const char *)memchr(p, '\n', end - p);
+		const char *start = p;
+
+		if (eol == nullptr)
+			eol = end;
+		line++;
+
+		Job job;
+		bool empty = true;
+
+		job.Entry = -1;
+		job.Stop = -1;
+		job.Budget = 1000000;
+		job.Fill = 0x00;
+
+		while (p < eol)
+		{
+			while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r'))
+				p++;
+			if (p == eol || (*p == '#' && empty))
+				break;
+
+			const char *token = p;
+			while (p < eol && *p != ' ' && *p != '\t' && *p != '\r')
+				p++;
+
+			int column = (int)(token - start) + 1;
+			const char *equal = (const char *)memchr(token, '=', p - token);
+
+			if (equal == nullptr)
+				return Fail(Error, line, column, "expected key=value");
+
+			string key(token, equal - token);
+			const char *value = equal + 1;
+			size_t size = p - value;
+			uint32_t number;
+
+			if (key == "id")
+				job.Id.assign(value, size);
+			else if (key == "image")
+				job.Image.assign(value, size);
+			else if (key == "entry" || key == "stop")
+			{
+				if (!ReadHexNumber(value, size, 4, number))
+					return Fail(Error, line, column, "invalid address");
+				(key == "entry" ? job.Entry : job.Stop) = (int)number;
+			}
+			else if (key == "fill")
+			{
+				if (!ReadHexNumber(value, size, 2, number))
+					return Fail(Error, line, column, "invalid fill byte");
+				job.Fill = (byte)number;
+			}
+			else if (key == "budget")
+			{
+				job.Budget = 0;
+				for (size_t i = 0; i < size; i++)
+				{
+					if (value[i] < '0' || value[i] > '9' || job.Budget > UINT64_MAX / 10 - 1)
+						return Fail(Error, line, column, "invalid cycle budget");
+					job.Budget = job.Budget * 10 + (value[i] - '0');
+				}
+				if (size == 0)
+					return Fail(Error, line, column, "invalid cycle budget");
+			}
+			else if (key == "input" || key == "output")
+			{
+				Job::Range range;
+
+				if (!ReadRange(value, size, key == "input", range))
+					return Fail(Error, line, column, key == "input" ? "invalid input, expected address:bytes" : "invalid output, expected address:size");
+				(key == "input" ? job.Inputs : job.Outputs).push_back(range);
+			}
+			else
+				return Fail(Error, line, column, "unknown key");
+
+			empty = false;
+		}
+
+		if (!empty)
+		{
+			if (job.Image.empty())
+				return Fail(Error, line, 1, "missing image");
+			if (job.Id.empty())
+				job.Id = to_string(Jobs.size());
+			Jobs.push_back(job);
+		}
+
+		p = eol + 1;
+	}
+
+	return true;
+}
+
+bool ReadManifest(const char *Filename, vector<Job> &Jobs, LoadError *Error)
+{
+	ifstream file(Filename, std::ios::binary);
+
+	if (!file)
+		return Fail(Error, 0, 0, "cannot open file");
+
+	ostringstream text;
+	text << file.rdbuf();
+
+	string content = text.str();
+
+	return ParseManifest(content.data(), content.size(), Jobs, Error);
+}
+
+// every image named in the manifest, loaded once
+struct LoadedImage
+{
+	unique_ptr<Image>		Hex;
+	unique_ptr<MappedFile>	Binary;
+	LoadError				Error;
+};
+
+// [begin, end) of the jobs owned by a thread, packed in one word so that the owner taking jobs
+// from the front and thieves taking the back half race on a single compare and swap
+struct alignas(64) WorkRange
+{
+	atomic<uint64_t>	Range;
+};
+
+static uint64_t Pack(uint32_t Begin, uint32_t End)
+{
+	return (uint64_t)Begin << 32 | End;
+}
+
+static bool TakeJob(WorkRange &Own, uint32_t &Index)
+{
+	uint64_t range = Own.Range.load();
+
+	while (true)
+	{
+		uint32_t begin = (uint32_t)(range >> 32);
+		uint32_t end = (uint32_t)range;
+
+		if (begin >= end)
+			return false;
+		if (Own.Range.compare_exchange_weak(range, Pack(begin + 1, end)))
+		{
+			Index = begin;
+			return true;
+		}
+	}
+}
+
+static bool Steal(WorkRange *Ranges, int Count, int Thief)
+{
+	for (int i = 1; i < Count; i++)
+	{
+		WorkRange &victim = Ranges[(Thief + i) % Count];
+		uint64_t range = victim.Range.load();
+
+		while (true)
+		{
+			uint32_t begin = (uint32_t)(range >> 32);
+			uint32_t end = (uint32_t)range;
+			uint32_t middle = begin + (end - begin) / 2;
+
+			if (begin >= end)
+				break;
+			if (victim.Range.compare_exchange_weak(range, Pack(begin, middle)))
+			{
+				// nobody steals from an empty range, so this can't race with anything
+				Ranges[Thief].Range.store(Pack(middle, end));
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+// own jobs first, then stolen ones: another thief can empty what we just stole before we take
+// from it, so we keep stealing until there is nothing left anywhere
+static bool NextJob(WorkRange *Ranges, int Count, int Index, uint32_t &Job)
+{
+	while (!TakeJob(Ranges[Index], Job))
+	{
+		if (!Steal(Ranges, Count, Index))
+			return false;
+	}
+
+	return true;
+}
+
+StopReasons RunBudget(Processor &CPU, uint64_t Budget, uint64_t &Cycles)
+{
+	// Run() counts cycles in an int, the budget is spent in slices
+	StopReasons reason = srBudget;
+
+	Cycles = 0;
+	while (Cycles < Budget)
+	{
+		uint64_t slice = Budget - Cycles < 0x40000000 ? Budget - Cycles : 0x40000000;
+
+		CPU.Clock = 0;
+		reason = CPU.Run((int)slice);
+		Cycles += CPU.Clock;
+
+		if (reason != srBudget)
+			break;
+	}
+
+	return reason;
+}
+
+static const char *StopNames[] = {"budget", "break", "breakpoint", "loop", "illegal"};
+
+static void AppendHex(string &Text, uint64_t Value, int Digits)
+{
+	for (int i = Digits - 1; i >= 0; i--)
+		Text += "0123456789ABCDEF"[(Value >> (i * 4)) & 15];
+}
+
+static void AppendString(string &Text, const string &Value)
+{
+	Text += '"';
+	for (char c : Value)
+	{
+		if (c == '"' || c == '\\')
+			Text += '\\';
+		if ((unsigned char)c < 0x20)
+		{
+			Text += "\\u00";
+			AppendHex(Text, (unsigned char)c, 2);
+		}
+		else
+			Text += c;
+	}
+	Text += '"';
+}
+
+// runs Task on Instance and formats its result in Line, returns the number of cycles
+static uint64_t RunJob(Machine &Instance, const Job &Task, size_t Index, const LoadedImage &Loaded, string &Line)
+{
+	Processor &cpu = Instance.CPU;
+	Memory &ram = Instance.RAM;
+
+	Line = "{\"job\":" + to_string(Index) + ",\"id\":";
+	AppendString(Line, Task.Id);
+
+	cpu.HardReset(Task.Fill);
+	if (Loaded.Hex)
+		ram.LoadSegments(*Loaded.Hex);
+	else
+		ram.Load(*Loaded.Binary);
+
+	for (const Job::Range &input : Task.Inputs)
+		ram.CopyIn(input.Address, input.Data.data(), input.Data.size());
+
+	cpu.EndOnBreak = true;
+	cpu.SendRST();
+	cpu.Step();
+	if (Task.Entry >= 0)
+		cpu.PC = (word)Task.Entry;
+	cpu.Breakpoint = Task.Stop;
+
+	uint64_t cycles;
+	StopReasons reason = RunBudget(cpu, Task.Budget, cycles);
+
+	Line += ",\"stop\":\"";
+	Line += StopNames[reason];
+	Line += "\",\"cycles\":" + to_string(cycles);
+	Line += ",\"pc\":\"";
+	AppendHex(Line, cpu.PC, 4);
+	Line += "\",\"a\":\"";
+	AppendHex(Line, cpu.A, 2);
+	Line += "\",\"x\":\"";
+	AppendHex(Line, cpu.X, 2);
+	Line += "\",\"y\":\"";
+	AppendHex(Line, cpu.Y, 2);
+	Line += "\",\"s\":\"";
+	AppendHex(Line, cpu.S, 2);
+	Line += "\",\"p\":\"";
+	AppendHex(Line, cpu.P, 2);
+	Line += "\",\"digest\":\"";
+	AppendHex(Line, ram.Digest(), 16);
+	Line += "\"";
+
+	if (!Task.Outputs.empty())
+	{
+		const Memory &memory = ram;
+
+		Line += ",\"outputs\":{";
+		for (size_t i = 0; i < Task.Outputs.size(); i++)
+		{
+			const Job::Range &output = Task.Outputs[i];
+
+			Line += i ? ",\"" : "\"";
+			AppendHex(Line, output.Address, 4);
+			Line += "\":\"";
+			for (size_t a = 0; a < output.Data.size(); a++)
+				AppendHex(Line, memory[(word)(output.Address + a)], 2);
+			Line += "\"";
+		}
+		Line += "}";
+	}
+
+	Line += "}\n";
+
+	return cycles;
+}
+
+JobRunner::JobRunner(int Threads)
+{
+	this->Threads = Threads > 0 ? Threads : (int)thread::hardware_concurrency();
+	if (this->Threads <= 0)
+		this->Threads = 1;
+	Cycles = 0;
+}
+
+void JobRunner::Run(const vector<Job> &Jobs, const function<void(const char *Line, size_t Length)> &Output)
+{
+	map<string, LoadedImage> images;
+
+	for (const Job &job : Jobs)
+	{
+		if (images.count(job.Image))
+			continue;
+
+		LoadedImage &loaded = images[job.Image];
+
+		loaded.Error = {0, 0, "cannot open file"};
+		if (Image::IsHexFile(job.Image.c_str()))
+		{
+			loaded.Hex.reset(new Image());
+			if (!loaded.Hex->ReadHex(job.Image.c_str(), &loaded.Error))
+				loaded.Hex.reset();
+		}
+		else
+		{
+			loaded.Binary.reset(new MappedFile(job.Image.c_str()));
+			if (!loaded.Binary->IsOpen())
+				loaded.Binary.reset();
+		}
+	}
+
+	int count = Threads < (int)Jobs.size() ? Threads : (int)Jobs.size();
+	unique_ptr<WorkRange[]> ranges(new WorkRange[count > 0 ? count : 1]);
+	atomic<uint64_t> cycles(0);
+	mutex output;
+
+	// contiguous shares to start with, the threads done first steal from the others
+	for (int i = 0; i < count; i++)
+		ranges[i].Range.store(Pack((uint32_t)(Jobs.size() * i / count), (uint32_t)(Jobs.size() * (i + 1) / count)));
+
+	auto worker = [&](int Index) {
+		Pool pool(1, Pool::CurrentNode());
+		Machine *instance = pool.Acquire();
+		string line;
+		uint64_t total = 0;
+		uint32_t job;
+
+		while (NextJob(ranges.get(), count, Index, job))
+		{
+			const LoadedImage &loaded = images.find(Jobs[job].Image)->second;
+
+			if (instance == nullptr)
+			{
+				line = "{\"job\":" + to_string(job) + ",\"error\":\"out of memory\"}\n";
+			}
+			else if (!loaded.Hex && !loaded.Binary)
+			{
+				line = "{\"job\":" + to_string(job) + ",\"id\":";
+				AppendString(line, Jobs[job].Id);
+				line += ",\"error\":";
+				AppendString(line, string("cannot load ") + Jobs[job].Image + ": " + loaded.Error.Message);
+				line += "}\n";
+			}
+			else
+				total += RunJob(*instance, Jobs[job], job, loaded, line);
+
+			lock_guard<mutex> lock(output);
+			Output(line.data(), line.size());
+		}
+
+		cycles += total;
+	};
+
+	vector<thread> threads;
+
+	for (int i = 1; i < count; i++)
+		threads.emplace_back(worker, i);
+	if (count > 0)
+		worker(0);
+	for (thread &t : threads)
+		t.join();
+
+	Cycles = cycles;
+}
\ No newline at end of file
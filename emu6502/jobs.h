@@ -0,0 +1,76 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include "types.h"
+#include "image.h"
+#include "processor.h"
+
+// one independent program run, usually a line of a manifest (see ParseManifest())
+struct Job
+{
+	struct Range
+	{
+		word				Address;
+		std::vector<byte>	Data;		// bytes written before the run, only the size for outputs
+	};
+
+	std::string			Id;
+	std::string			Image;		// .hex or raw binary file, see Memory::ReadFile()
+	int					Entry;		// start address, -1 to go through the reset vector
+	int					Stop;		// Processor::Breakpoint
+	uint64_t			Budget;		// cycles
+	byte				Fill;		// value of the memory not covered by the image
+	std::vector<Range>	Inputs;
+	std::vector<Range>	Outputs;	// reported in the results
+};
+
+// spends a 64 bits Budget in slices Run(Cycles) can count, Clock restarts from 0 on each slice
+// Cycles gets the number of cycles actually run
+StopReasons RunBudget(Processor &CPU, uint64_t Budget, uint64_t &Cycles);
+
+// manifest: one job per line, blank lines and lines starting with # are ignored
+//   id=fw1-v3 image=fw1.hex entry=0400 budget=1000000 input=0200:A9D5 output=0300:10 stop=0450 fill=FF
+// addresses, sizes and bytes are hexadecimal, the budget is decimal, image is the only required key
+// input and output can be repeated
+bool ParseManifest(const char *Text, size_t Length, std::vector<Job> &Jobs, LoadError *Error = nullptr);
+bool ReadManifest(const char *Filename, std::vector<Job> &Jobs, LoadError *Error = nullptr);
+
+// runs jobs on a work stealing thread pool, each thread reuses a single machine (HardReset() between 
+// jobs) and images are loaded once per Run() whatever the number of jobs using them
+// results are JSON objects, one per line, in completion order:
+//   {"job":0,"id":"fw1-v3","stop":"break","cycles":1234,"pc":"0452","a":"D5",...,"outputs":{"0300":"A9D5..."}}
+class JobRunner
+{
+protected:
+	int		Threads;
+
+public:
+	uint64_t	Cycles;		// total of the last Run()
+
+	JobRunner(int Threads = 0);		// 0: one thread per hardware thread
+	// Output gets one result line at a time (new line included), never from two threads at once
+	void Run(const std::vector<Job> &Jobs, const std::function<void(const char *Line, size_t Length)> &Output);
+};
\ No newline at end of file
@@ -0,0 +1,588 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+#include "lockstep.h"
+
+Lockstep::Decoded Lockstep::Table[256];
+const bool Lockstep::TableReady = Lockstep::BuildTable();
+
+bool Lockstep::BuildTable()
+{
+	// Processor::InstructionSet may not be built yet, use the constant table it comes from
+	const struct {
+		void		(Processor::*Function)();
+		Operations	Operation;
+	} operations[] = {
+		{&Processor::Load, oLoad},
+		{&Processor::Store, oStore},
+		{&Processor::Compare, oCompare},
+		{&Processor::And, oAnd},
+		{&Processor::Xor, oXor},
+		{&Processor::Or, oOr},
+		{&Processor::RotateLeft, oRotateLeft},
+		{&Processor::RotateRight, oRotateRight},
+		{&Processor::ShiftLeft, oShiftLeft},
+		{&Processor::ShiftRight, oShiftRight},
+		{&Processor::Increment, oIncrement},
+		{&Processor::Decrement, oDecrement},
+		{&Processor::AddWithCarry, oAddWithCarry},
+		{&Processor::SubtractWithCarry, oSubtractWithCarry},
+		{&Processor::Push, oPush},
+		{&Processor::Pull, oPull},
+		{&Processor::Jump, oJump},
+		{&Processor::Call, oCall},
+		{&Processor::Return, oReturn},
+		{&Processor::Break, oBreak},
+		{&Processor::Nop, oNop},
+		{&Processor::BranchIfMinus, oBranchIfMinus},
+		{&Processor::BranchIfPositive, oBranchIfPositive},
+		{&Processor::BranchIfEqual, oBranchIfEqual},
+		{&Processor::BranchIfNotEqual, oBranchIfNotEqual},
+		{&Processor::BranchIfCarrySet, oBranchIfCarrySet},
+		{&Processor::BranchIfCarryClear, oBranchIfCarryClear},
+		{&Processor::BranchIfOverflowSet, oBranchIfOverflowSet},
+		{&Processor::BranchIfOverflowClear, oBranchIfOverflowClear},
+		{&Processor::ClearCarryFlag, oClearCarryFlag},
+		{&Processor::ClearDecimalFlag, oClearDecimalFlag},
+		{&Processor::ClearInterruptFlag, oClearInterruptFlag},
+		{&Processor::ClearOverflowFlag, oClearOverflowFlag},
+		{&Processor::SetCarryFlag, oSetCarryFlag},
+		{&Processor::SetDecimalFlag, oSetDecimalFlag},
+		{&Processor::SetInterruptFlag, oSetInterruptFlag},
+		{&Processor::BitTest, oBitTest},
+		{&Processor::ReturnFromInterrupt, oReturnFromInterrupt}
+	};
+
+	for (int i = 0; i < 256; i++)
+		Table[i] = {oIllegal, sImplied, tNone, false};
+
+	for (const Processor::Instruction &ins : Processor::LegalInstructionSet)
+	{
+		for (const auto &op : operations)
+		{
+			if (ins.Function == op.Function)
+				Table[ins.OpCode] = {op.Operation, ins.Source, ins.Target, ins.InternalExecution};
+		}
+	}
+
+	return true;
+}
+
+Lockstep::Lockstep(void)
+{
+	for (int i = 0; i < Width; i++)
+	{
+		RAM[i] = nullptr;
+		Array[i] = nullptr;
+		Start[i] = 0;
+		Active[i] = 0;
+		A[i] = 0;
+		X[i] = 0;
+		Y[i] = 0;
+		S[i] = 0;
+		P[i] = 0;
+		PC[i] = 0;
+		Clock[i] = 0;
+		Reason[i] = srBudget;
+	}
+
+	EndOnBreak = false;
+	Breakpoint = -1;
+	Breakpoints = nullptr;
+	Hooks = nullptr;
+	Groups = 0;
+	Instructions = 0;
+}
+
+void Lockstep::Attach(int Lane, Memory *RAM)
+{
+	this->RAM[Lane] = RAM;
+	Array[Lane] = RAM ? RAM->Pointer(0) : nullptr;
+	Scalar[Lane].reset(RAM ? new Processor(RAM) : nullptr);
+}
+
+Memory *Lockstep::Lane(int Lane)
+{
+	return RAM[Lane];
+}
+
+void Lockstep::Reset(int Lane)
+{
+	S[Lane] = 0xFF;
+	P[Lane] = 0b00110100;
+	PC[Lane] = Array[Lane][0xFFFC] | (Array[Lane][0xFFFD] << 8);
+	Clock[Lane] = 0;
+}
+
+bool Lockstep::Import(int Lane, const Processor &CPU)
+{
+	if (CPU.ResetState || CPU.InterruptState || CPU.NonMaskableInterruptState)
+		return false;
+
+	Store(Lane, CPU);
+	return true;
+}
+
+void Lockstep::Store(int Lane, const Processor &CPU)
+{
+	A[Lane] = CPU.A;
+	X[Lane] = CPU.X;
+	Y[Lane] = CPU.Y;
+	S[Lane] = CPU.S;
+	P[Lane] = CPU.P;
+	PC[Lane] = CPU.PC;
+	Clock[Lane] = CPU.Clock;
+}
+
+void Lockstep::Export(int Lane, Processor &CPU) const
+{
+	CPU.A = A[Lane];
+	CPU.X = X[Lane];
+	CPU.Y = Y[Lane];
+	CPU.S = S[Lane];
+	CPU.P = P[Lane];
+	CPU.PC = PC[Lane];
+	CPU.Clock = Clock[Lane];
+}
+
+void Lockstep::Run(int Cycles)
+{
+	alignas(64) byte running[Width];
+	alignas(64) int key[Width];	// PC of the running lanes, past the address space for the others
+
+	for (int i = 0; i < Width; i++)
+	{
+		running[i] = Array[i] != nullptr;
+		Start[i] = Clock[i];
+		Reason[i] = srBudget;
+	}
+
+	while (true)
+	{
+		int lowest = 0x10000;
+
+		// the lanes that spent their cycles stop with srBudget, set above
+		for (int i = 0; i < Width; i++)
+		{
+			running[i] &= Clock[i] - Start[i] < Cycles;
+			key[i] = running[i] ? PC[i] : 0x10000;
+			lowest = key[i] < lowest ? key[i] : lowest;
+		}
+
+		if (lowest == 0x10000)
+			return;
+
+		word pc = (word)lowest;
+		int first = 0;
+		int count = 0;
+		byte stop = 0;
+
+		while (key[first] != lowest)
+			first++;
+
+		byte opcode = Array[first][pc];
+		const Decoded &ins = Table[opcode];
+
+		for (int i = 0; i < Width; i++)
+			Active[i] = key[i] == lowest ? 0xFF : 0x00;
+		// lanes running self modifying code may have another opcode at the same address
+		for (int i = first + 1; i < Width; i++)
+		{
+			if (Active[i] && Array[i][pc] != opcode)
+				Active[i] = 0;
+		}
+
+		if (ins.Operation == oIllegal)
+		{
+			for (int i = 0; i < Width; i++)
+			{
+				if (Active[i])
+				{
+					running[i] = false;
+					Reason[i] = srIllegal;
+				}
+			}
+			continue;
+		}
+
+		if (!ExecuteVector(pc, ins))
+		{
+			for (int i = 0; i < Width; i++)
+			{
+				if (Active[i])
+					Execute(i);
+			}
+		}
+
+		bool brk = ins.Operation == oBreak && EndOnBreak;
+
+		for (int i = 0; i < Width; i++)
+		{
+			count += Active[i] & 1;
+			stop |= Active[i] & (brk | IsBreakpoint(PC[i]) | (PC[i] == pc));
+		}
+
+		Groups++;
+		Instructions += count;
+
+		if (!stop)
+			continue;
+
+		for (int i = 0; i < Width; i++)
+		{
+			if (!Active[i])
+				continue;
+
+			if (brk)
+				Reason[i] = srBreak;
+			else if (IsBreakpoint(PC[i]))
+				Reason[i] = srBreakpoint;
+			else if (PC[i] == pc)
+				Reason[i] = srLoop;
+			else
+				continue;
+
+			running[i] = false;
+		}
+	}
+}
+
+byte *Lockstep::Register(int Lane, Targets Target)
+{
+	switch (Target)
+	{
+	case tAccumulator:
+		return &A[Lane];
+	case tIndexX:
+		return &X[Lane];
+	case tIndexY:
+		return &Y[Lane];
+	case tStackPointer:
+		return &S[Lane];
+	case tStatus:
+		return &P[Lane];
+	default:
+		return nullptr;
+	}
+}
+
+// the instructions without a vector version run on a Processor bound to the memory of the lane,
+// so the lanes can't drift from it
+void Lockstep::Execute(int Lane)
+{
+	Processor &cpu = *Scalar[Lane];
+
+	Export(Lane, cpu);
+	cpu.EndOnBreak = EndOnBreak;
+	cpu.Hooks = Hooks;
+	cpu.Step();
+	Store(Lane, cpu);
+}
+
+static inline byte ZeroNegative(byte P, byte Value)
+{
+	return (P & ~(fZero | fNegative)) | (Value == 0 ? fZero : 0) | (Value & fNegative);
+}
+
+// Mask is 0xFF to pick Value, 0x00 to keep Old
+static inline byte Select(byte Mask, byte Value, byte Old)
+{
+	return (Value & Mask) | (Old & ~Mask);
+}
+
+static inline word Select(byte Mask, word Value, word Old)
+{
+	word mask = (word)(signed char)Mask;
+
+	return (Value & mask) | (Old & ~mask);
+}
+
+// Operation(Value, Operand, Flags) on the active lanes of a register, Target, Source and P
+// are separate arrays, which the compiler needs to know to vectorize the loop
+template <typename Function>
+static inline void Apply(byte *__restrict Target, const byte *__restrict Source, byte *__restrict P,
+	const byte *__restrict Active, Function Operation)
+{
+	for (int i = 0; i < Lockstep::Width; i++)
+	{
+		byte value = Target[i];
+		byte flags = P[i];
+
+		Operation(value, Source[i], flags);
+		Target[i] = Select(Active[i], value, Target[i]);
+		P[i] = Select(Active[i], flags, P[i]);
+	}
+}
+
+// the loops below go over every lane and merge the results with the Active[] masks instead
+// of branching on them, which is what lets the compiler vectorize them
+bool Lockstep::ExecuteVector(word Address, const Decoded &Ins)
+{
+	alignas(64) byte data[Width];
+	byte *target = nullptr;
+	const byte *source = data;
+	byte flag = 0;
+	bool set = false;
+	word next = Address + InstructionLength[Ins.Source];
+	int cycles;		// same count as Processor for everything but taken branches
+
+	switch (Ins.Target)
+	{
+	case tAccumulator:
+		target = A;
+		break;
+	case tIndexX:
+		target = X;
+		break;
+	case tIndexY:
+		target = Y;
+		break;
+	case tStackPointer:
+		target = S;
+		break;
+	default:
+		break;
+	}
+
+	switch (Ins.Source)
+	{
+	case sImmediate:
+		// operands are gathered from the memory of each lane
+		for (int i = 0; i < Width; i++)
+			data[i] = Active[i] ? Array[i][(word)(Address + 1)] : 0;
+		cycles = 2;
+		break;
+	case sZeroPage:
+	case sAbsolute:
+		// reads only, with a register as target
+		if (target == nullptr || Ins.Operation == oStore)
+			return false;
+		for (int i = 0; i < Width; i++)
+		{
+			if (!Active[i])
+				continue;
+
+			word operand = Array[i][(word)(Address + 1)];
+
+			if (Ins.Source == sAbsolute)
+				operand |= Array[i][(word)(Address + 2)] << 8;
+			data[i] = Array[i][operand];
+		}
+		cycles = Ins.Source == sAbsolute ? 4 : 3;
+		break;
+	case sAccumulator:
+		source = A;
+		cycles = 1;
+		break;
+	case sIndexX:
+		source = X;
+		cycles = 1;
+		break;
+	case sIndexY:
+		source = Y;
+		cycles = 1;
+		break;
+	case sStackPointer:
+		source = S;
+		cycles = 1;
+		break;
+	case sImplied:
+		cycles = 2;
+		break;
+	default:
+		return false;
+	}
+
+	switch (Ins.Operation)
+	{
+	case oClearCarryFlag:
+	case oBranchIfCarryClear:
+		flag = fCarry;
+		break;
+	case oSetCarryFlag:
+	case oBranchIfCarrySet:
+		flag = fCarry;
+		set = true;
+		break;
+	case oClearDecimalFlag:
+		flag = fDecimal;
+		break;
+	case oSetDecimalFlag:
+		flag = fDecimal;
+		set = true;
+		break;
+	case oClearInterruptFlag:
+		flag = fInterrupt;
+		break;
+	case oSetInterruptFlag:
+		flag = fInterrupt;
+		set = true;
+		break;
+	case oClearOverflowFlag:
+	case oBranchIfOverflowClear:
+		flag = fOverflow;
+		break;
+	case oBranchIfOverflowSet:
+		flag = fOverflow;
+		set = true;
+		break;
+	case oBranchIfPositive:
+		flag = fNegative;
+		break;
+	case oBranchIfMinus:
+		flag = fNegative;
+		set = true;
+		break;
+	case oBranchIfNotEqual:
+		flag = fZero;
+		break;
+	case oBranchIfEqual:
+		flag = fZero;
+		set = true;
+		break;
+	default:
+		break;
+	}
+
+	byte want = set ? flag : 0;
+
+	switch (Ins.Operation)
+	{
+	case oNop:
+	case oClearCarryFlag:
+	case oClearDecimalFlag:
+	case oClearInterruptFlag:
+	case oClearOverflowFlag:
+	case oSetCarryFlag:
+	case oSetDecimalFlag:
+	case oSetInterruptFlag:
+		for (int i = 0; i < Width; i++)
+			P[i] = Select(Active[i], (byte)((P[i] & ~flag) | want), P[i]);
+		break;
+	case oBranchIfMinus:
+	case oBranchIfPositive:
+	case oBranchIfEqual:
+	case oBranchIfNotEqual:
+	case oBranchIfCarrySet:
+	case oBranchIfCarryClear:
+	case oBranchIfOverflowSet:
+	case oBranchIfOverflowClear:
+		for (int i = 0; i < Width; i++)
+		{
+			word destination = next + (signed char)data[i];
+			byte taken = (P[i] & flag) == want ? Active[i] : 0;
+			int extra = 1 + (((next ^ destination) & 0xFF00) != 0);
+
+			PC[i] = Select(taken, destination, Select(Active[i], next, PC[i]));
+			Clock[i] += (cycles & (signed char)Active[i]) + (extra & (signed char)taken);
+		}
+		return true;
+	case oIncrement:
+	case oDecrement:
+		// INX, INY, DEX, DEY
+		if (Ins.Source != sImplied || target == nullptr)
+			return false;
+		cycles += 2;
+		for (int i = 0; i < Width; i++)
+			data[i] = Ins.Operation == oIncrement ? 1 : 0xFF;
+		Apply(target, data, P, Active, [](byte &Value, byte Operand, byte &Flags) {
+			Value += Operand;
+			Flags = ZeroNegative(Flags, Value);
+		});
+		break;
+	case oLoad:
+		// transfers and loads, TXS leaves the flags alone
+		if (Ins.Target == tStackPointer)
+			Apply(target, source, P, Active, [](byte &Value, byte Operand, byte &) { Value = Operand; });
+		else
+			Apply(target, source, P, Active, [](byte &Value, byte Operand, byte &Flags) {
+				Value = Operand;
+				Flags = ZeroNegative(Flags, Value);
+			});
+		break;
+	case oAnd:
+		Apply(target, source, P, Active, [](byte &Value, byte Operand, byte &Flags) {
+			Value &= Operand;
+			Flags = ZeroNegative(Flags, Value);
+		});
+		break;
+	case oXor:
+		Apply(target, source, P, Active, [](byte &Value, byte Operand, byte &Flags) {
+			Value ^= Operand;
+			Flags = ZeroNegative(Flags, Value);
+		});
+		break;
+	case oOr:
+		Apply(target, source, P, Active, [](byte &Value, byte Operand, byte &Flags) {
+			Value |= Operand;
+			Flags = ZeroNegative(Flags, Value);
+		});
+		break;
+	case oCompare:
+		Apply(target, source, P, Active, [](byte &Value, byte Operand, byte &Flags) {
+			Flags &= ~(fCarry | fZero | fNegative);
+			Flags |= Value >= Operand ? fCarry : 0;
+			Flags |= Value == Operand ? fZero : 0;
+			Flags |= (Value - Operand) & fNegative;
+		});
+		break;
+	case oAddWithCarry:
+	case oSubtractWithCarry:
+	{
+		// binary mode only, decimal arithmetic is left to Execute()
+		byte decimal = 0;
+
+		for (int i = 0; i < Width; i++)
+			decimal |= Active[i] & P[i] & fDecimal;
+		if (decimal)
+			return false;
+
+		if (Ins.Operation == oAddWithCarry)
+			Apply(target, source, P, Active, [](byte &Value, byte Operand, byte &Flags) {
+				word result = Value + Operand + (Flags & fCarry);
+
+				Flags &= ~(fCarry | fOverflow);
+				Flags |= (result >> 8) & fCarry;
+				Flags |= ((Operand ^ result) & (Value ^ result) & 0x80) >> 1;
+				Value = (byte)result;
+				Flags = ZeroNegative(Flags, Value);
+			});
+		else
+			Apply(target, source, P, Active, [](byte &Value, byte Operand, byte &Flags) {
+				word result = Value - Operand - 1 + (Flags & fCarry);
+
+				Flags &= ~(fCarry | fOverflow);
+				Flags |= (~result >> 8) & fCarry;
+				Flags |= (~(Operand ^ result) & (Value ^ result) & 0x80) >> 1;
+				Value = (byte)result;
+				Flags = ZeroNegative(Flags, Value);
+			});
+		break;
+	}
+	default:
+		return false;
+	}
+
+	for (int i = 0; i < Width; i++)
+	{
+		PC[i] = Select(Active[i], next, PC[i]);
+		Clock[i] += cycles & (signed char)Active[i];
+	}
+
+	return true;
+}
\ No newline at end of file
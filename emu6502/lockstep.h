@@ -0,0 +1,109 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "types.h"
+#include "memory.h"
+#include "processor.h"
+
+// up to Width machines running the same program with different data, one instruction at a time:
+// the lanes whose PC points to the same opcode are decoded once and executed together, the ones
+// that branched elsewhere are masked out and rejoin the group when their PC matches again
+// (the group with the lowest PC always goes first so that lanes left behind catch up)
+// registers are stored as arrays indexed by lane: transfers, flag changes, INX and co, branches,
+// loads, logic, compares and binary ADC/SBC from immediate, zero page or absolute operands are
+// loops over all the lanes that the compiler turns into vector code (operands are gathered lane
+// by lane since every lane has its own Memory), the other instructions run one lane at a time
+// with Processor::Step()
+// cycles, registers and memory end up exactly as with Processor::Run(Cycles) on each machine,
+// interrupts aren't supported
+class Lockstep
+{
+public:
+	static const int Width = 16;
+
+protected:
+	enum Operations : byte {
+		oLoad, oStore, oCompare, oAnd, oXor, oOr, oRotateLeft, oRotateRight, oShiftLeft, oShiftRight,
+		oIncrement, oDecrement, oAddWithCarry, oSubtractWithCarry, oPush, oPull, oJump, oCall, oReturn,
+		oBreak, oNop, oBranchIfMinus, oBranchIfPositive, oBranchIfEqual, oBranchIfNotEqual,
+		oBranchIfCarrySet, oBranchIfCarryClear, oBranchIfOverflowSet, oBranchIfOverflowClear,
+		oClearCarryFlag, oClearDecimalFlag, oClearInterruptFlag, oClearOverflowFlag, oSetCarryFlag,
+		oSetDecimalFlag, oSetInterruptFlag, oBitTest, oReturnFromInterrupt, oIllegal
+	};
+
+	// Processor::InstructionSet with the member function replaced by an Operations value
+	struct Decoded {
+		Operations	Operation;
+		Sources		Source;
+		Targets		Target;
+		bool		InternalExecution;
+	};
+
+	static Decoded		Table[256];
+	static const bool	TableReady;
+
+	Memory	*RAM[Width];
+	byte	*Array[Width];	// RAM[lane]->Pointer(0), nullptr for unused lanes
+	std::unique_ptr<Processor>	Scalar[Width];	// bound to RAM[lane], runs what ExecuteVector() can't
+	int		Start[Width];	// Clock when Run() was called
+
+	alignas(64) byte Active[Width];	// 0xFF for the lanes executing the current instruction, 0x00 for the others
+
+	static bool BuildTable();
+	byte *Register(int Lane, Targets Target);
+	void Execute(int Lane);							// one instruction on one lane through Scalar[Lane]
+	void Store(int Lane, const Processor &CPU);		// the registers of CPU into the lane
+	bool IsBreakpoint(word Address) const
+	{
+		return Address == Breakpoint || (Breakpoints && (Breakpoints[Address >> 6] >> (Address & 63)) & 1);
+	}
+	bool ExecuteVector(word Address, const Decoded &Ins);	// same on every active lane, false if there's no vector version
+
+public:
+	alignas(64) byte	A[Width];
+	alignas(64) byte	X[Width];
+	alignas(64) byte	Y[Width];
+	alignas(64) byte	S[Width];
+	alignas(64) byte	P[Width];
+	alignas(64) word	PC[Width];
+	alignas(64) int		Clock[Width];
+	StopReasons	Reason[Width];	// why each lane stopped during the last Run()
+	bool		EndOnBreak;		// shared by all the lanes, same meaning as in Processor
+	int			Breakpoint;
+	const uint64_t	*Breakpoints;	// same as Processor::Breakpoints
+	const HookTable	*Hooks;			// same as Processor::Hooks
+	uint64_t	Groups;			// instructions decoded by Run(), each one executed by one or more lanes
+	uint64_t	Instructions;	// instructions executed by all the lanes, Instructions / Groups tells how well they stay together
+
+	Lockstep(void);
+	void Attach(int Lane, Memory *RAM);	// nullptr to leave the lane unused
+	Memory *Lane(int Lane);
+	void Reset(int Lane);				// same as Processor::SendRST() followed by Step()
+	// copy the registers of CPU into the lane, false if CPU has an interrupt pending (lanes can't hold one)
+	bool Import(int Lane, const Processor &CPU);
+	void Export(int Lane, Processor &CPU) const;	// and back
+	// every attached lane runs until its own Clock has advanced by Cycles or something stops it,
+	// see Reason[] for what it was
+	void Run(int Cycles);
+};
\ No newline at end of file
@@ -18,9 +18,15 @@ along with this program.If not, see < http://www.gnu.org/licenses/>.
 
 #include <iostream>
 #include <bitset>
+#include <cstdlib>
 #include "processor.h"
+#include "profiler.h"
 
-using namespace std;
+using std::cout;
+using std::endl;
+using std::hex;
+using std::uppercase;
+using std::bitset;
 
 int main(int argc, char **argv)
 {
@@ -34,8 +40,15 @@ int main(int argc, char **argv)
 		CPU->Step();
 		CPU->PC = 0x400;
 
-		if (RAM->ReadFile(argv[1]))
+		LoadError error;
+
+		// parsed .hex files are cached in the directory given by EMU6502_CACHE if it is set
+		if (RAM->ReadFile(argv[1], &error, getenv("EMU6502_CACHE")))
 		{
+			// EMU6502_PROFILER=D3 maps the profiler registers at $D300, its slots are printed at exit
+			const char *page = getenv("EMU6502_PROFILER");
+			Profiler *profiler = page ? new Profiler(*CPU, *RAM, (byte)strtol(page, nullptr, 16)) : nullptr;
+
 			word previous_pc;
 			do
 			{
@@ -43,12 +56,9 @@ int main(int argc, char **argv)
 				CPU->Step();
 			} while (previous_pc != CPU->PC);
 
-			char *buffer = new char[16 * 3 + 1];
+			char *buffer = new char[Memory::DumpCapacity(0x100, dHex)];
 
-			for (int a = 0; a < 0x100; a += 16)
-			{
-				cout << RAM->Read(buffer, a + 0x200, 16) << endl;
-			}
+			cout.write(buffer, RAM->Dump(buffer, Memory::DumpCapacity(0x100, dHex), 0x200, 0x100, dHex));
 			cout << uppercase << hex << endl;
 
 			cout << CPU->PC - 30 << ": " << RAM->Read(buffer, CPU->PC - 30, 16) << endl;
@@ -62,11 +72,22 @@ int main(int argc, char **argv)
 			cout << "S  = " << (int)CPU->S << endl;
 			cout << "PC = " << (int)CPU->PC << endl;
 			cout << "     NO-BDIZC" << endl;
-			cout << "P  = " << bitset<8>(CPU->P) << endl;
+			cout << "P  = " << bitset<8>(CPU->P) << endl << endl;
+			cout << "Memory digest = " << RAM->Digest() << endl;
+
+			if (profiler != nullptr)
+			{
+				cout << endl;
+				profiler->Report("-");
+				delete profiler;
+			}
 		}
 		else
 		{
-			cout << "Cannot open file \"" << argv[1] << "\"" << endl;
+			cout << "Cannot load file \"" << argv[1] << "\"";
+			if (error.Line > 0)
+				cout << " (line " << error.Line << ", column " << error.Column << ")";
+			cout << ": " << error.Message << endl;
 		}
 	}
 	else
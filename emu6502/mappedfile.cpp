@@ -0,0 +1,142 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <cstring>
+#include "mappedfile.h"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const char *Filename)
+{
+	Mapping = nullptr;
+	View = nullptr;
+	Size = 0;
+
+	File = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		File = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(File, &size) || size.QuadPart == 0)
+		return;
+	Size = (size_t)size.QuadPart;
+
+	Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (Mapping != nullptr)
+		View = (const byte *)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+}
+
+MappedFile::~MappedFile(void)
+{
+	if (View != nullptr)
+		UnmapViewOfFile(View);
+	if (Mapping != nullptr)
+		CloseHandle(Mapping);
+	if (File != nullptr)
+		CloseHandle(File);
+}
+
+bool MappedFile::IsOpen() const
+{
+	return File != nullptr && (View != nullptr || Size == 0);
+}
+
+bool MappedFile::MapInto(byte *Address, size_t Length, size_t Offset) const
+{
+	// MapViewOfFileEx can't replace pages that are already allocated
+	return false;
+}
+
+#else
+
+MappedFile::MappedFile(const char *Filename)
+{
+	struct stat info;
+
+	View = nullptr;
+	Size = 0;
+
+	File = open(Filename, O_RDONLY);
+	if (File < 0 || fstat(File, &info) != 0)
+		return;
+	Size = (size_t)info.st_size;
+
+	if (Size != 0)
+	{
+		void *view = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, File, 0);
+
+		if (view != MAP_FAILED)
+			View = (const byte *)view;
+	}
+}
+
+MappedFile::~MappedFile(void)
+{
+	if (View != nullptr)
+		munmap((void *)View, Size);
+	if (File >= 0)
+		close(File);
+}
+
+bool MappedFile::IsOpen() const
+{
+	return File >= 0 && (View != nullptr || Size == 0);
+}
+
+bool MappedFile::MapInto(byte *Address, size_t Length, size_t Offset) const
+{
+	if (Offset > Size)
+		return false;
+	if (Length > Size - Offset)
+		Length = Size - Offset;
+	if (Length == 0)
+		return true;
+
+	// only whole host pages are mapped, a partial one would clear the memory past Length
+	size_t mapped = Length & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+
+	if (mapped > 0 && mmap(Address, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, File, (off_t)Offset) == MAP_FAILED)
+		return false;
+	memcpy(Address + mapped, View + Offset + mapped, Length - mapped);
+
+	return true;
+}
+
+#endif
+
+const byte *MappedFile::Data() const
+{
+	return View;
+}
+
+size_t MappedFile::Length() const
+{
+	return Size;
+}
@@ -0,0 +1,52 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include "types.h"
+
+// read-only memory mapping of a whole file
+// one instance can be shared by any number of Memory objects loading the same image
+class MappedFile
+{
+protected:
+#ifdef _WIN32
+	void	*File;
+	void	*Mapping;
+#else
+	int		File;
+#endif
+	const byte	*View;
+	size_t		Size;
+
+public:
+	MappedFile(const char *Filename);
+	~MappedFile(void);
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator = (const MappedFile &) = delete;
+
+	bool IsOpen() const;
+	const byte *Data() const;
+	size_t Length() const;
+	// maps Length bytes from Offset (page aligned) at Address (page aligned too) as 
+	// private, copy on write, pages, a partial last page is copied so the memory after it stays as it was
+	// returns false if the platform can't do it, the caller then has to copy from Data()
+	bool MapInto(byte *Address, size_t Length, size_t Offset = 0) const;
+};
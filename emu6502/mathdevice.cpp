@@ -0,0 +1,127 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include "mathdevice.h"
+
+MathDevice::MathDevice(Processor &CPU, Memory &RAM, byte Page) : CPU(CPU), RAM(RAM)
+{
+	Base = (word)(Page << 8);
+	MultiplyCycles = 8;
+	DivideCycles = 16;
+	Operations = 0;
+	StolenCycles = 0;
+	RAM.Fill(Base, 0x00, 0x100);
+	RAM.Attach(this, Page);
+}
+
+MathDevice::~MathDevice(void)
+{
+	RAM.Detach(this);
+}
+
+// false when a nibble isn't a decimal digit
+bool MathDevice::FromBCD(uint32_t Value, int Digits, uint32_t &Binary)
+{
+	Binary = 0;
+	for (int i = Digits - 1; i >= 0; i--)
+	{
+		uint32_t digit = (Value >> (i * 4)) & 0x0F;
+
+		if (digit > 9)
+			return false;
+		Binary = Binary * 10 + digit;
+	}
+
+	return true;
+}
+
+// Binary must fit in 8 digits
+uint32_t MathDevice::ToBCD(uint32_t Binary)
+{
+	uint32_t value = 0;
+
+	for (int i = 0; Binary > 0; i++, Binary /= 10)
+		value |= (Binary % 10) << (i * 4);
+
+	return value;
+}
+
+void MathDevice::Write(word Address, byte Value)
+{
+	byte *registers = RAM.Pointer(Base + (Address & 0xF0));
+
+	switch (Address & 15)
+	{
+	case mrStatus:
+		registers[mrStatus] = 0;
+		break;
+	case mrOperation:
+		if (Value == 0)
+			break;
+
+		uint32_t a = registers[mrOperandA] | registers[mrOperandA + 1] << 8 | registers[mrOperandA + 2] << 16 | (uint32_t)registers[mrOperandA + 3] << 24;
+		uint32_t b = registers[mrOperandB] | registers[mrOperandB + 1] << 8;
+		uint32_t result = 0, remainder = 0;
+		bool valid = true;
+		bool decimal = Value == moMultiplyBCD || Value == moDivideBCD;
+		int stolen = 0;		// unknown operations are rejected at once
+
+		switch (Value)
+		{
+		case moMultiply:
+		case moMultiplyBCD:
+			a &= 0xFFFF;
+			stolen = MultiplyCycles;
+			valid = !decimal || (FromBCD(a, 4, a) && FromBCD(b, 4, b));
+			result = a * b;
+			break;
+		case moDivide:
+		case moDivideBCD:
+			stolen = DivideCycles;
+			valid = (!decimal || (FromBCD(a, 8, a) && FromBCD(b, 4, b))) && b != 0;
+			if (valid)
+			{
+				result = a / b;
+				remainder = a % b;
+			}
+			break;
+		default:
+			valid = false;
+		}
+
+		if (valid)
+		{
+			if (decimal)
+			{
+				result = ToBCD(result);
+				remainder = ToBCD(remainder);
+			}
+			for (int i = 0; i < 4; i++)
+				registers[mrResult + i] = (byte)(result >> (i * 8));
+			registers[mrRemainder] = (byte)remainder;
+			registers[mrRemainder + 1] = (byte)(remainder >> 8);
+		}
+		registers[mrOperation] = 0;
+		registers[mrStatus] = valid ? msDone : msDone | msError;
+		RAM.Touch(Base);
+
+		CPU.Clock += stolen;
+		Operations++;
+		StolenCycles += stolen;
+		break;
+	}
+}
\ No newline at end of file
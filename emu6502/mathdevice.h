@@ -0,0 +1,73 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+#include "device.h"
+#include "memory.h"
+#include "processor.h"
+
+// math device registers, offsets from the base address, little endian
+enum MathRegisters : byte {
+	mrOperandA		= 0,	// 4 bytes: 16 bits multiplicand or 32 bits dividend
+	mrOperandB		= 4,	// 2 bytes: multiplier or divisor
+	mrOperation		= 6,	// MathOperations, cleared once the result is there
+	mrStatus		= 7,	// MathStatuses, any write clears it
+	mrResult		= 8,	// 4 bytes: product or quotient
+	mrRemainder		= 12	// 2 bytes
+};
+
+enum MathOperations : byte {
+	moMultiply		= 1,	// 16 x 16 = 32 bits
+	moDivide		= 2,	// 32 / 16 = 32 bits quotient and 16 bits remainder
+	moMultiplyBCD	= 3,	// same with packed BCD: 4 digits x 4 digits = 8 digits
+	moDivideBCD		= 4		// 8 digits / 4 digits = 8 digits quotient and 4 digits remainder
+};
+
+enum MathStatuses : byte {
+	msDone			= 1,
+	msError			= 2		// division by zero, invalid BCD digit or unknown operation, the results are left alone
+};
+
+// multiply and divide accelerator: writing mrOperation computes the result at once and charges
+// its latency to the CPU clock, so the guest can read it with the next instruction
+// the registers take a whole page (Memory::Attach() works on pages), each 16 bytes slot of it is a
+// separate set of registers, handy to keep one per task
+class MathDevice : public Device
+{
+protected:
+	Processor	&CPU;
+	Memory		&RAM;
+	word		Base;
+
+	static bool FromBCD(uint32_t Value, int Digits, uint32_t &Binary);
+	static uint32_t ToBCD(uint32_t Binary);
+
+public:
+	int			MultiplyCycles;
+	int			DivideCycles;
+	uint64_t	Operations;
+	uint64_t	StolenCycles;
+
+	MathDevice(Processor &CPU, Memory &RAM, byte Page);
+	~MathDevice(void);
+	void Write(word Address, byte Value) override;
+};
\ No newline at end of file
@@ -17,22 +17,125 @@ along with this program.If not, see < http://www.gnu.org/licenses/>.
 */
 
 #include <cassert>
-#include <fstream>
 #include <cctype>
 #include <cstring>
+#include <atomic>
+#include <random>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include "memory.h"
+#include "hash.h"
 
-using namespace std;
+using std::atomic;
 
-Memory::Memory(void)
+// each saved snapshot gets a unique generation number so Restore() knows when
+// only the pages written since the last Save() need to be copied back
+static atomic<uint64_t> SnapshotGeneration(0);
+
+// snapshots can come from a file written by another process, whose instances and generations
+// are numbered the same way: a random salt keeps the identities apart
+static const uint64_t IdentitySalt = (uint64_t)std::random_device()() << 32 ^ std::random_device()();
+static atomic<uint64_t> InstanceCount(0);
+
+// "A9 " for each byte value, padded to 4 bytes so that it can be copied in one go
+struct HexPairs
+{
+	char Digits[256][4];
+
+	constexpr HexPairs() : Digits()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			Digits[i][0] = "0123456789ABCDEF"[i >> 4];
+			Digits[i][1] = "0123456789ABCDEF"[i & 15];
+			Digits[i][2] = ' ';
+			Digits[i][3] = ' ';
+		}
+	}
+};
+
+static constexpr HexPairs Hex;
+
+// "0200: " followed by 16 times "A9 " with the last space replaced by a new line
+static const size_t DumpLineLength = 6 + 16 * 3;
+
+static int CountTrailingZeros(uint64_t Value)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, Value);
+	return (int)index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (!_BitScanForward(&index, (unsigned long)Value))
+	{
+		_BitScanForward(&index, (unsigned long)(Value >> 32));
+		index += 32;
+	}
+	return (int)index;
+#else
+	return __builtin_ctzll(Value);
+#endif
+}
+
+byte *Memory::Allocate()
+{
+	// allocated straight from the OS so that the array is page aligned and 
+	// file mappings can be placed over it (see Load())
+#ifdef _WIN32
+	return (byte *)VirtualAlloc(nullptr, 0x10000, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	return (byte *)mmap(nullptr, 0x10000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+}
+
+Memory::Memory(void) : Memory(Allocate())
 {
-	Array = new byte[0x10000];
+	OwnsArray = true;
+}
+
+Memory::Memory(byte *Storage, bool Mappable)
+{
+	Array = Storage;
+	OwnsArray = false;
+	Mapped = false;
+	this->Mappable = Mappable;
+	ResetFill = 0x00;
 	WriteCounter = 0;
+	Identity = IdentitySalt + ++InstanceCount;
+	Generation = 0;
+	SpecialPages = 0;
+	memset(PageTable, ptRAM, sizeof(PageTable));
+
+	for (int i = 0; i < 4; i++)
+	{
+		DirtyPages[i] = 0;
+		UserPages[i] = 0;
+		SnapshotPages[i] = 0;
+		HashPages[i] = ~0ULL;
+		ResetPages[i] = 0;
+	}
 }
 
 Memory::~Memory(void)
 {
-	delete[] Array;
+	if (!OwnsArray)
+		return;
+
+#ifdef _WIN32
+	VirtualFree(Array, 0, MEM_RELEASE);
+#else
+	munmap(Array, 0x10000);
+#endif
 }
 
 byte Memory::NibbleToByte(const char Nibble)
@@ -48,42 +151,279 @@ byte Memory::NibbleToByte(const char Nibble)
 		return 0;
 }
 
-byte Memory::HexToByte(const char *Hex)
+byte Memory::operator [] (word Index) const
 {
-	return NibbleToByte(*(Hex + 1)) + (NibbleToByte(*Hex) << 4);
+	return Array[Index];
 }
 
-word Memory::HexToWord(const char *Hex)
+byte& Memory::operator[] (word Index)
 {
-	return HexToByte(Hex + 2) + (HexToByte(Hex) << 8);
+	Touch(Index);
+	return Array[Index];
 }
 
-byte Memory::operator [] (word Index) const
+byte *Memory::Pointer(word Address)
 {
-	return Array[Index];
+	return Array + Address;
 }
 
-byte& Memory::operator[] (word Index)
+void Memory::Touch(word Address)
 {
-	return Array[Index];
+	DirtyPages[Address >> 14] |= 1ULL << ((Address >> 8) & 63);
+}
+
+void Memory::Stored(word Address)
+{
+	DirtyPages[Address >> 14] |= 1ULL << ((Address >> 8) & 63);
+
+	if (SpecialPages == 0)
+		return;
+
+	switch (PageTable[Address >> 8])
+	{
+	case ptROM:
+		// the write already happened, take it back
+		Array[Address] = Rom[Address];
+		break;
+	case ptDevice:
+		Notify(Address, 1);
+		break;
+	}
+}
+
+void Memory::Notify(word Address, size_t Length)
+{
+	for (size_t i = 0; i < Length; i++)
+	{
+		word address = (word)(Address + i);
+		Device *target = PageDevices[address >> 8];
+
+		if (target != nullptr)
+			target->Write(address, Array[address]);
+	}
+}
+
+void Memory::FoldDirtyPages()
+{
+	for (int i = 0; i < 4; i++)
+	{
+		UserPages[i] |= DirtyPages[i];
+		SnapshotPages[i] |= DirtyPages[i];
+		HashPages[i] |= DirtyPages[i];
+		ResetPages[i] |= DirtyPages[i];
+		DirtyPages[i] = 0;
+	}
+}
+
+void Memory::ReadDirtyPages(uint64_t Pages[4])
+{
+	FoldDirtyPages();
+
+	for (int i = 0; i < 4; i++)
+		Pages[i] = UserPages[i];
+}
+
+void Memory::ClearDirtyPages()
+{
+	FoldDirtyPages();
+
+	for (int i = 0; i < 4; i++)
+		UserPages[i] = 0;
+}
+
+uint64_t Memory::PageDigest(byte Page)
+{
+	FoldDirtyPages();
+
+	if (HashPages[Page >> 6] & (1ULL << (Page & 63)))
+	{
+		PageHashes[Page] = Hash64(Array + Page * 0x100, 0x100, Page);
+		HashPages[Page >> 6] &= ~(1ULL << (Page & 63));
+	}
+
+	return PageHashes[Page];
+}
+
+uint64_t Memory::Digest()
+{
+	FoldDirtyPages();
+
+	for (int i = 0; i < 4; i++)
+	{
+		uint64_t pages = HashPages[i];
+
+		while (pages)
+		{
+			int page = i * 64 + CountTrailingZeros(pages);
+
+			PageHashes[page] = Hash64(Array + page * 0x100, 0x100, page);
+			pages &= pages - 1;
+		}
+		HashPages[i] = 0;
+	}
+
+	// root hash over the 256 page hashes
+	return Hash64(PageHashes, sizeof(PageHashes));
 }
 
 char *Memory::Read(char *Buffer, word Address, word Size)
 {
+	char *out = Buffer;
+
 	for (int i = 0; i < Size; i++)
 	{
-		word a = i + Address;
-
-		Buffer[i * 3] = (Array[a] >> 4) + ((Array[a] >> 4) > 9 ? 55 : 48);
-		Buffer[i * 3 + 1] = (Array[a] & 0x0F) + ((Array[a] & 0x0F) > 9 ? 55 : 48);
-		Buffer[i * 3 + 2] = ' ';
+		memcpy(out, Hex.Digits[Array[(word)(Address + i)]], 3);
+		out += 3;
 	}
 
-	Buffer[Size * 3] = 0;
+	*out = 0;
 
 	return Buffer;
 }
 
+size_t Memory::DumpCapacity(size_t Length, byte Flags)
+{
+	if (!(Flags & dHex))
+		return Length;
+
+	// a line can start in the middle of a page when the dump isn't aligned, so
+	// each page can add one short line
+	return (Length / 16 + 2 + (Length + 0xFF) / 0x100) * DumpLineLength;
+}
+
+bool Memory::SkipPage(byte Page, byte Flags, byte FillByte)
+{
+	if (Flags & dSkipClean)
+	{
+		FoldDirtyPages();
+		if (!(UserPages[Page >> 6] & (1ULL << (Page & 63))))
+			return true;
+	}
+
+	if (Flags & dSkipFilled)
+	{
+		const byte *data = Array + Page * 0x100;
+
+		for (int i = 0; i < 0x100; i++)
+			if (data[i] != FillByte)
+				return false;
+		return true;
+	}
+
+	return false;
+}
+
+size_t Memory::Dump(char *Buffer, size_t Capacity, word Address, size_t Length, byte Flags, byte FillByte)
+{
+	char *out = Buffer;
+	char *end = Buffer + Capacity;
+
+	if (!(Flags & dHex))
+	{
+		if (Length > Capacity)
+			Length = Capacity;
+		CopyOut((byte *)Buffer, Address, Length);
+		return Length;
+	}
+
+	while (Length > 0)
+	{
+		// the bytes up to the end of the page, in lines of 16
+		size_t count = 0x100 - (Address & 0xFF);
+
+		if (count > Length)
+			count = Length;
+
+		if (!SkipPage(Address >> 8, Flags, FillByte))
+		{
+			for (size_t line = 0; line < count; line += 16)
+			{
+				size_t bytes = count - line < 16 ? count - line : 16;
+				word a = (word)(Address + line);
+				const byte *data = Array + a;
+
+				size_t length = 6 + bytes * 3;
+				char text[DumpLineLength + 1];	// 4 bytes are copied for the last 3 characters
+
+				if (out + length > end)
+					return out - Buffer;
+
+				memcpy(text, Hex.Digits[a >> 8], 2);
+				memcpy(text + 2, Hex.Digits[a & 0xFF], 2);
+				text[4] = ':';
+				text[5] = ' ';
+				for (size_t i = 0; i < bytes; i++)
+					memcpy(text + 6 + i * 3, Hex.Digits[data[i]], 4);
+				text[length - 1] = '\n';
+
+				memcpy(out, text, length);
+				out += length;
+			}
+		}
+
+		Address += (word)count;
+		Length -= count;
+	}
+
+	return out - Buffer;
+}
+
+// write() can return early, loop until everything is out
+static bool WriteAll(int Descriptor, const char *Data, size_t Length)
+{
+	while (Length > 0)
+	{
+#ifdef _WIN32
+		int written = _write(Descriptor, Data, (unsigned int)(Length < 0x40000000 ? Length : 0x40000000));
+#else
+		ssize_t written = write(Descriptor, Data, Length);
+#endif
+		if (written <= 0)
+			return false;
+
+		Data += written;
+		Length -= written;
+	}
+
+	return true;
+}
+
+bool Memory::Dump(int Descriptor, word Address, size_t Length, byte Flags, byte FillByte)
+{
+	if (!(Flags & dHex))
+	{
+		// straight from the array, at most two writes
+		while (Length > 0)
+		{
+			size_t count = Contiguous(Address, Length);
+
+			if (!WriteAll(Descriptor, (const char *)Array + Address, count))
+				return false;
+
+			Address += (word)count;
+			Length -= count;
+		}
+		return true;
+	}
+
+	// formatted 16 pages at a time
+	char buffer[(0x1000 / 16 + 2 + 0x10) * DumpLineLength];
+
+	while (Length > 0)
+	{
+		size_t count = Length < 0x1000 ? Length : 0x1000;
+		size_t size = Dump(buffer, sizeof(buffer), Address, count, Flags, FillByte);
+
+		if (!WriteAll(Descriptor, buffer, size))
+			return false;
+
+		Address += (word)count;
+		Length -= count;
+	}
+
+	return true;
+}
+
 void Memory::Write(char const *Data, bool AddBreak)
 {
 	byte value;
@@ -106,7 +446,10 @@ void Memory::Write(char const *Data, bool AddBreak)
 			if (high)
 				value <<= 4;
 			else
+			{
+				Touch(WriteCounter);
 				Array[WriteCounter++] = value;
+			}
 
 			high = !high;
 		}
@@ -116,6 +459,7 @@ void Memory::Write(char const *Data, bool AddBreak)
 
 	if (AddBreak)
 	{
+		Touch(WriteCounter);
 		Array[WriteCounter] = 0x00;
 	}
 }
@@ -126,102 +470,394 @@ void Memory::Write(word Address, char const *Data, bool AddBreak)
 	Write(Data, AddBreak);
 }
 
-// TODO: return a more explicit error (exception?)
-bool Memory::ReadFile(const char *filename)
+void Memory::Write(const byte *Data, size_t Length, bool AddBreak)
 {
-	ifstream	file;
-	bool		hex_format = false;
-	bool		success = false;
-	
-	if (_stricmp(strrchr(filename, '.'), ".hex") == 0)
+	CopyIn(WriteCounter, Data, Length);
+	WriteCounter += (word)Length;
+
+	if (AddBreak)
 	{
-		file = ifstream(filename);
-		hex_format = true;
+		Touch(WriteCounter);
+		Array[WriteCounter] = 0x00;
 	}
-	else
-		file = ifstream(filename, ios::binary);
+}
+
+void Memory::Write(word Address, const byte *Data, size_t Length, bool AddBreak)
+{
+	WriteCounter = Address;
+	Write(Data, Length, AddBreak);
+}
 
-	if (file.is_open())
+void Memory::TouchRange(word Address, size_t Length)
+{
+	if (Length == 0)
+		return;
+
+	for (size_t page = Address >> 8; page <= (Address + Length - 1) >> 8; page++)
+		Touch((word)(page << 8));
+}
+
+// how many bytes from Address can be handled as one block
+size_t Memory::Contiguous(word Address, size_t Length) const
+{
+	size_t count = 0x10000 - Address;
+
+	if (SpecialPages > 0)
 	{
-		file.seekg(0);
+		byte type = PageTable[Address >> 8];
+		size_t page = (Address >> 8) + 1;
 
-		if (hex_format)
+		count = (page << 8) - Address;
+		while (page < 0x100 && PageTable[page] == type && count < Length)
 		{
-			//   1 =  1 : semicolon
-			// + 2 =  3 : byte count
-			// + 4 =  7 : address
-			// + 2 =  9 : record type
-			// + x      : length * 2, up to 510
-			// + 2 = 11 : checksum
-			// + 1 = 12 : terminator
-			char	row[522];
-			int		line = 1;
-			bool	end_of_file = false;
-
-			for (int i = 0; i < 0x10000; i++)
-			{
-				Array[i] = 0xFF;
-			}
+			count += 0x100;
+			page++;
+		}
+	}
+
+	return count < Length ? count : Length;
+}
+
+void Memory::CopyIn(word Address, const byte *Source, size_t Length)
+{
+	while (Length > 0)
+	{
+		size_t count = Contiguous(Address, Length);
+		byte type = PageTable[Address >> 8];
+
+		if (type != ptROM)
+		{
+			memcpy(Array + Address, Source, count);
+			TouchRange(Address, count);
+			if (type == ptDevice)
+				Notify(Address, count);
+		}
+
+		Address += (word)count;
+		Source += count;
+		Length -= count;
+	}
+}
+
+void Memory::CopyOut(byte *Destination, word Address, size_t Length) const
+{
+	while (Length > 0)
+	{
+		size_t count = Contiguous(Address, Length);
+
+		memcpy(Destination, Array + Address, count);
+
+		Address += (word)count;
+		Destination += count;
+		Length -= count;
+	}
+}
+
+void Memory::Fill(word Address, byte Value, size_t Length)
+{
+	while (Length > 0)
+	{
+		size_t count = Contiguous(Address, Length);
+		byte type = PageTable[Address >> 8];
+
+		if (type != ptROM)
+		{
+			memset(Array + Address, Value, count);
+			TouchRange(Address, count);
+			if (type == ptDevice)
+				Notify(Address, count);
+		}
+
+		Address += (word)count;
+		Length -= count;
+	}
+}
+
+void Memory::Copy(word Destination, word Source, size_t Length)
+{
+	if (Length > 0x10000)
+		Length = 0x10000;
+
+	// overlapping ranges go through a copy, like memmove()
+	if (Destination != Source && ((word)(Destination - Source) < Length || (word)(Source - Destination) < Length))
+	{
+		std::vector<byte> buffer(Length);
+
+		CopyOut(buffer.data(), Source, Length);
+		CopyIn(Destination, buffer.data(), Length);
+		return;
+	}
+
+	while (Length > 0)
+	{
+		size_t count = Contiguous(Source, Length);
+
+		// Array + Source stays valid for count bytes, CopyIn() splits the destination as it needs
+		CopyIn(Destination, Array + Source, count);
+
+		Destination += (word)count;
+		Source += (word)count;
+		Length -= count;
+	}
+}
+
+void Memory::SetPages(byte First, int Count, PageTypes Type)
+{
+	for (int page = First; page < First + Count && page < 0x100; page++)
+	{
+		if (Type == ptROM)
+		{
+			if (!Rom)
+				Rom.reset(new byte[0x10000]);
+			memcpy(Rom.get() + page * 0x100, Array + page * 0x100, 0x100);
+		}
+
+		if (PageDevices)
+			PageDevices[page] = nullptr;
+
+		SpecialPages += (Type != ptRAM) - (PageTable[page] != ptRAM);
+		PageTable[page] = Type;
+	}
+}
+
+PageTypes Memory::GetPage(byte Page) const
+{
+	return (PageTypes)PageTable[Page];
+}
+
+void Memory::Attach(Device *Target, byte First, int Count)
+{
+	if (!PageDevices)
+	{
+		PageDevices.reset(new Device *[0x100]);
+		for (int page = 0; page < 0x100; page++)
+			PageDevices[page] = nullptr;
+	}
+
+	SetPages(First, Count, ptDevice);
+	for (int page = First; page < First + Count && page < 0x100; page++)
+		PageDevices[page] = Target;
+}
+
+void Memory::Detach(Device *Target)
+{
+	for (int page = 0; PageDevices && page < 0x100; page++)
+	{
+		if (PageDevices[page] == Target)
+			SetPages((byte)page, 1, ptRAM);
+	}
+}
+
+std::span<const byte> Memory::View(word Address, size_t Length) const
+{
+	if (Address + Length > 0x10000)
+		return {};
+
+	return std::span<const byte>(Array + Address, Length);
+}
+
+std::span<byte> Memory::Span(word Address, size_t Length)
+{
+	if (Address + Length > 0x10000)
+		return {};
+
+	TouchRange(Address, Length);
+	return std::span<byte>(Array + Address, Length);
+}
+
+void Memory::Save(Snapshot &Snap)
+{
+	FoldDirtyPages();
+
+	Snap.WriteCounter = WriteCounter;
+	Snap.Owner = Identity;
+	Snap.Generation = ++SnapshotGeneration;
+	memcpy(Snap.RAM, Array, 0x10000);
+
+	Generation = Snap.Generation;
+	for (int i = 0; i < 4; i++)
+		SnapshotPages[i] = 0;
+}
 
-			do
+void Memory::Restore(const Snapshot &Snap)
+{
+	FoldDirtyPages();
+
+	WriteCounter = Snap.WriteCounter;
+
+	// only our own snapshots, anything else may not match what we saved
+	if (Snap.Owner == Identity && Snap.Generation == Generation)
+	{
+		// only copy back what changed since Save() or the last Restore()
+		for (int i = 0; i < 4; i++)
+		{
+			uint64_t pages = SnapshotPages[i];
+
+			while (pages)
 			{
-				file.getline(row, 522);
-
-				if (file.fail())
-				{
-					success = false; // ERROR: row delimiter not found (line probably too long)
-					break;
-				}
-
-				if (row[0] != ':')
-				{
-					success = false; // ERROR: line should start with a semicolon
-					break;
-				}
-
-				byte byte_count = HexToByte(row + 1);
-				word address = HexToWord(row + 3);
-				byte record_type = HexToByte(row + 7);
-				int	 checksum = 0;
-
-				// TODO: should compare byte_count + metadata and strlen(row)
-
-				for (int i = 0; i < byte_count + 5; i++)
-					checksum += HexToByte(&row[i * 2 + 1]);
-
-				if (checksum & 0xFF)
-				{
-					success = false; // ERROR: checksum error
-					break;
-				}
-
-				switch (record_type)
-				{
-				case 00:	// data
-					for (int i = 0; i < byte_count; i++)
-					{
-						Array[address + i] = HexToByte(&row[i * 2 + 9]);
-					}
-					break;
-				case 01:	// end of file
-					end_of_file = true;
-					success = true;
-					break;
-				default:
-					break;
-				}
-
-				line++;
-			} while (!end_of_file && !file.eof());
+				int page = i * 64 + CountTrailingZeros(pages);
+
+				memcpy(Array + page * 0x100, Snap.RAM + page * 0x100, 0x100);
+				pages &= pages - 1;
+			}
+			// the pages we just restored changed as far as the other trackers are concerned
+			DirtyPages[i] = SnapshotPages[i];
 		}
-		else 
+	}
+	else
+	{
+		memcpy(Array, Snap.RAM, 0x10000);
+
+		for (int i = 0; i < 4; i++)
+			DirtyPages[i] = ~0ULL;
+		Generation = Snap.Generation;
+	}
+
+	FoldDirtyPages();
+
+	for (int i = 0; i < 4; i++)
+		SnapshotPages[i] = 0;
+}
+
+bool Memory::Load(const MappedFile &File)
+{
+	size_t length = File.Length() < 0x10000 ? File.Length() : 0x10000;
+
+	if (!File.IsOpen())
+		return false;
+
+	// pages are only read from disk (or the page cache) when the program touches them
+	// and are shared by all the instances loading the same image until they write to them
+	if (Mappable && File.MapInto(Array, length))
+		Mapped = true;
+	else
+		memcpy(Array, File.Data(), length);
+
+	for (size_t page = 0; page < length; page += 0x100)
+		Touch((word)page);
+
+	return true;
+}
+
+bool Memory::Load(const Image &Source, uint32_t Bank)
+{
+	const Image::Bank *bank = Source.FindBank(Bank);
+	const MappedFile *cache = Source.CacheFile();
+
+	if (bank != nullptr)
+	{
+		// banks coming from a cache file are mapped copy on write, like binary images
+		if (cache != nullptr && Mappable && cache->MapInto(Array, 0x10000, (size_t)bank->Offset))
+			Mapped = true;
+		else
+			memcpy(Array, bank->Data, 0x10000);
+	}
+	else
+		memset(Array, 0xFF, 0x10000);
+
+	for (int i = 0; i < 4; i++)
+		DirtyPages[i] = ~0ULL;
+
+	return true;
+}
+
+void Memory::LoadSegments(const Image &Source, uint32_t Bank)
+{
+	const Image::Bank *bank = Source.FindBank(Bank);
+	uint64_t first = (uint64_t)Bank << 16, last = first + 0x10000;
+
+	if (bank == nullptr)
+		return;
+
+	for (const Image::Segment &segment : Source.Segments)
+	{
+		uint64_t start = segment.Address > first ? segment.Address : first;
+		uint64_t end = (uint64_t)segment.Address + segment.Length < last ? (uint64_t)segment.Address + segment.Length : last;
+
+		if (start < end)
+			CopyIn((word)(start - first), bank->Data + (start - first), (size_t)(end - start));
+	}
+}
+
+void Memory::HardReset(byte FillByte)
+{
+	bool remapped = false;
+
+	FoldDirtyPages();
+
+#ifndef _WIN32
+	// a file mapping has to go, fresh anonymous pages are all zero
+	if (Mapped && mmap(Array, 0x10000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED)
+	{
+		remapped = true;
+		ResetFill = 0x00;
+	}
+#endif
+	Mapped = false;
+
+	if (remapped && FillByte == 0x00)
+	{
+		// already filled, writing zeros would only fault in pages the kernel left untouched
+		for (int i = 0; i < 4; i++)
+			DirtyPages[i] = ~0ULL;
+	}
+	else if (FillByte != ResetFill)
+	{
+		memset(Array, FillByte, 0x10000);
+		for (int i = 0; i < 4; i++)
+			DirtyPages[i] = ~0ULL;
+	}
+	else
+	{
+		// a 64kb memset is cheap, but most jobs only write to a handful of pages
+		for (int i = 0; i < 4; i++)
 		{
-			file.read((char *)Array, 0x10000);
-			success = true;
+			uint64_t pages = ResetPages[i];
+
+			while (pages)
+			{
+				int page = i * 64 + CountTrailingZeros(pages);
+
+				memset(Array + page * 0x100, FillByte, 0x100);
+				pages &= pages - 1;
+			}
+			DirtyPages[i] = ResetPages[i];
 		}
+	}
+
+	// the pages we just cleared changed for hashes and snapshots, not for the user
+	FoldDirtyPages();
+
+	for (int i = 0; i < 4; i++)
+	{
+		UserPages[i] = 0;
+		ResetPages[i] = 0;
+	}
+	ResetFill = FillByte;
+	WriteCounter = 0;
+
+	memset(PageTable, ptRAM, sizeof(PageTable));
+	SpecialPages = 0;
+	PageDevices.reset();
+}
 
-		file.close();
+bool Memory::ReadFile(const char *Filename, LoadError *Error, const char *CacheDirectory)
+{
+	if (Image::IsHexFile(Filename))
+	{
+		Image image;
+
+		return image.ReadHex(Filename, Error, CacheDirectory) && Load(image);
 	}
 
-	return success;
-}
\ No newline at end of file
+	MappedFile image(Filename);
+
+	if (!image.IsOpen())
+	{
+		if (Error != nullptr)
+			*Error = {0, 0, "cannot open file"};
+		return false;
+	}
+
+	return Load(image);
+}
@@ -18,26 +18,130 @@ along with this program.If not, see < http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <span>
 #include "types.h"
+#include "device.h"
+#include "snapshot.h"
+#include "mappedfile.h"
+#include "image.h"
+#include "program.h"
+
+enum DumpFlags : byte {
+	dHex		= 1,	// "0200: A9 D5 ..." lines of 16 bytes instead of raw binary
+	dSkipClean	= 2,	// hex only: leave out the pages not written since ClearDirtyPages()
+	dSkipFilled	= 4		// hex only: leave out the pages only holding the fill byte
+};
+
+// what sits behind each 256 bytes page, see Memory::SetPages()
+enum PageTypes : byte {
+	ptRAM		= 0,
+	ptROM		= 1,	// writes from the CPU, DMA transfers and bulk copies are ignored
+	ptDevice	= 2		// writes are reported to the attached Device
+};
 
 class Memory
 {
 protected:
 	byte	*Array;
+	bool	OwnsArray;
+	bool	Mapped;			// Load() placed a file mapping over Array
+	bool	Mappable;		// false when Array is shared with other processes or placed on purpose, Load() copies instead
+	byte	ResetFill;		// value of every page not in ResetPages
+
+	// one bit per 256 bytes page, set whenever the page is written to
+	// DirtyPages is the only bitmap updated by stores, it is folded into the
+	// other ones each time one of them is used
+	uint64_t	DirtyPages[4];
+	uint64_t	UserPages[4];		// reported by ReadDirtyPages()
+	uint64_t	SnapshotPages[4];	// written since the last Save() or Restore()
+	uint64_t	HashPages[4];		// pages whose hash in PageHashes is out of date
+	uint64_t	ResetPages[4];		// written since construction or the last HardReset()
+	uint64_t	Identity;			// unique to this instance, tells its own snapshots apart
+	uint64_t	Generation;			// generation of the snapshot we are in sync with
+	uint64_t	PageHashes[256];
+	byte		PageTable[256];		// PageTypes
+	int			SpecialPages;		// pages that aren't ptRAM, the fast paths only check this
+	std::unique_ptr<byte[]>		Rom;			// 64kb, content of the ptROM pages when they were set, allocated on first use
+
+	std::unique_ptr<Device *[]>	PageDevices;	// 256, device of each ptDevice page, allocated on first use
+
+	static byte *Allocate();
+	void FoldDirtyPages();
+	bool SkipPage(byte Page, byte Flags, byte FillByte);
+	void TouchRange(word Address, size_t Length);	// Length must not go past $FFFF
+	size_t Contiguous(word Address, size_t Length) const;	// stops at the end of memory or at a different page type
+	void Notify(word Address, size_t Length);	// reports writes to a device page
 
 	byte NibbleToByte(const char Nibble);
-	byte HexToByte(const char *Hex);
-	word HexToWord(const char *Hex);
 
 public:
 	word	WriteCounter;
 
 	Memory(void);
+	// 64kb owned by the caller (see Pool), zeroed and page aligned for Load() to map files over it
+	// unless Mappable is false (see SharedMachine and Pool)
+	Memory(byte *Storage, bool Mappable = true);
 	~Memory(void);
 	byte operator [] (word Index) const;
-	byte& operator [] (word Index);
-	char * Read(char *Buffer, word Address, word Size);
+	byte& operator [] (word Index);	// flags the page as dirty, whether we write to it or not, raw like Pointer()
+	// raw access, bypasses ROM and devices, writes have to be followed by Touch()
+	byte *Pointer(word Address);
+	void Touch(word Address);
+	// a bus master (CPU or DMA) just wrote Array[Address]: dirty tracking, ROM and device pages
+	void Stored(word Address);
+	void ReadDirtyPages(uint64_t Pages[4]);
+	void ClearDirtyPages();
+	uint64_t PageDigest(byte Page);
+	uint64_t Digest();				// hash of the whole memory, only rehashes the pages written since the last call
+	char * Read(char *Buffer, word Address, word Size);	// Buffer must hold Size * 3 + 1 characters
+	// dumps wrap around at $FFFF, Length can be anything up to 0x10000
+	static size_t DumpCapacity(size_t Length, byte Flags);	// worst case size of a dump in bytes
+	// stops at the last full line that fits, returns the number of bytes written
+	size_t Dump(char *Buffer, size_t Capacity, word Address, size_t Length, byte Flags, byte FillByte = 0x00);
+	bool Dump(int Descriptor, word Address, size_t Length, byte Flags, byte FillByte = 0x00);
 	void Write(char const *Data, bool AddBreak = true);
 	void Write(word Address, char const * Data, bool AddBreak = false);
-	bool ReadFile(const char *);
+	void Write(const byte *Data, size_t Length, bool AddBreak = true);
+	void Write(word Address, const byte *Data, size_t Length, bool AddBreak = false);
+	// bulk transfers, they wrap around at the end of the address space and ROM pages aren't written to
+	void CopyIn(word Address, const byte *Source, size_t Length);
+	void CopyIn(word Address, std::span<const byte> Source) { CopyIn(Address, Source.data(), Source.size()); }
+	void CopyOut(byte *Destination, word Address, size_t Length) const;
+	void CopyOut(std::span<byte> Destination, word Address) const { CopyOut(Destination.data(), Address, Destination.size()); }
+	void Fill(word Address, byte Value, size_t Length);
+	// block transfer inside the address space, like memmove() when the ranges overlap
+	void Copy(word Destination, word Source, size_t Length);
+	// page table: ptROM keeps the current content of the pages, ptRAM turns them back into RAM
+	void SetPages(byte First, int Count, PageTypes Type);
+	PageTypes GetPage(byte Page) const;
+	// Target gets the writes to pages First to First + Count - 1, it isn't owned
+	void Attach(Device *Target, byte First, int Count = 1);
+	void Detach(Device *Target);	// its pages become RAM again
+	// direct views, empty when the range would wrap around $FFFF
+	std::span<const byte> View(word Address, size_t Length) const;
+	std::span<byte> Span(word Address, size_t Length);	// flags the pages as dirty, like operator []
+	// programs built at compile time with the _6502 literal, e.g. RAM->Write("A9 D5"_6502)
+	template <size_t Size>
+	void Write(const Program<Size> &Code, bool AddBreak = true)
+	{
+		Write(Code.Bytes, Size, AddBreak);
+	}
+	template <size_t Size>
+	void Write(word Address, const Program<Size> &Code, bool AddBreak = false)
+	{
+		Write(Address, Code.Bytes, Size, AddBreak);
+	}
+	// .hex (Intel HEX) or raw binary file, see Image::ReadHex() for CacheDirectory
+	bool ReadFile(const char *Filename, LoadError *Error = nullptr, const char *CacheDirectory = nullptr);
+	bool Load(const MappedFile &File);	// raw binary image, mapped copy on write when the platform allows it
+	bool Load(const Image &Source, uint32_t Bank = 0);
+	// only the bytes the image defines in Bank, the rest of the memory keeps its content (a fill byte)
+	void LoadSegments(const Image &Source, uint32_t Bank = 0);
+	void Save(Snapshot &Snap);
+	void Restore(const Snapshot &Snap);
+	// power on state: every byte set to FillByte, only rewrites the pages written
+	// since the last reset unless FillByte changes, every page is RAM again and devices are detached
+	void HardReset(byte FillByte = 0x00);
 };
\ No newline at end of file
@@ -0,0 +1,172 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "pool.h"
+
+static const size_t HugePageSize = 0x200000;
+
+Pool::Pool(size_t Count, int Node, bool Huge)
+{
+	Capacity = Count;
+	Used = 0;
+	HugePages = false;
+	Free.reserve(Count);
+
+	// memory blocks come first so that each one is 64kb aligned
+	size_t objects = (Count * sizeof(Machine) + 0xFFFF) & ~(size_t)0xFFFF;
+	ArenaSize = (Count * 0x10000 + objects + HugePageSize - 1) & ~(HugePageSize - 1);
+
+#ifdef _WIN32
+	DWORD node = Node >= 0 ? (DWORD)Node : NUMA_NO_PREFERRED_NODE;
+	SIZE_T large = GetLargePageMinimum();
+
+	// large pages need the "lock pages in memory" privilege, fall back silently
+	Arena = nullptr;
+	if (Huge && large != 0 && ArenaSize % large == 0)
+		Arena = (byte *)VirtualAllocExNuma(GetCurrentProcess(), nullptr, ArenaSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+	HugePages = Arena != nullptr;
+	if (Arena == nullptr)
+		Arena = (byte *)VirtualAllocExNuma(GetCurrentProcess(), nullptr, ArenaSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+#else
+	// explicit huge pages only exist if the administrator reserved some, otherwise
+	// ask for transparent ones
+	void *arena = MAP_FAILED;
+
+	if (Huge)
+		arena = mmap(nullptr, ArenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	HugePages = arena != MAP_FAILED;
+	if (arena == MAP_FAILED)
+	{
+		arena = mmap(nullptr, ArenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+		if (Huge && arena != MAP_FAILED)
+			HugePages = madvise(arena, ArenaSize, MADV_HUGEPAGE) == 0;
+#endif
+	}
+	Arena = arena != MAP_FAILED ? (byte *)arena : nullptr;
+
+#ifdef SYS_mbind
+	// nothing has been touched yet, so every page will come from the preferred node
+	// (MPOL_PREFERRED, called directly so that we don't depend on libnuma)
+	if (Arena != nullptr && Node >= 0 && Node < 64)
+	{
+		unsigned long mask = 1UL << Node;
+		syscall(SYS_mbind, Arena, ArenaSize, 1, &mask, 64, 0);
+	}
+#endif
+#endif
+}
+
+Pool::~Pool(void)
+{
+	if (Arena == nullptr)
+		return;
+
+	for (size_t i = 0; i < Used; i++)
+		Object(i)->~Machine();
+
+#ifdef _WIN32
+	VirtualFree(Arena, 0, MEM_RELEASE);
+#else
+	munmap(Arena, ArenaSize);
+#endif
+}
+
+byte *Pool::Storage(size_t Slot) const
+{
+	return Arena + Slot * 0x10000;
+}
+
+Machine *Pool::Object(size_t Slot) const
+{
+	return (Machine *)(Arena + Capacity * 0x10000) + Slot;
+}
+
+bool Pool::IsOpen() const
+{
+	return Arena != nullptr;
+}
+
+bool Pool::UsesHugePages() const
+{
+	return HugePages;
+}
+
+size_t Pool::Size() const
+{
+	return Arena != nullptr ? Capacity : 0;
+}
+
+size_t Pool::Available() const
+{
+	return Size() - Used + Free.size();
+}
+
+Machine *Pool::Acquire()
+{
+	if (!Free.empty())
+	{
+		Machine *instance = Free.back();
+		Free.pop_back();
+		return instance;
+	}
+
+	if (Arena == nullptr || Used == Capacity)
+		return nullptr;
+
+	// constructed on first use, the pages are touched by the thread that needs them
+	Machine *instance = new (Object(Used)) Machine(Storage(Used));
+	Used++;
+
+	return instance;
+}
+
+void Pool::Release(Machine *Instance)
+{
+	// only the pages the machine wrote to are cleared
+	Instance->CPU.HardReset();
+
+	Free.push_back(Instance);
+}
+
+int Pool::CurrentNode()
+{
+#ifdef _WIN32
+	PROCESSOR_NUMBER processor;
+	USHORT node;
+
+	GetCurrentProcessorNumberEx(&processor);
+	if (GetNumaProcessorNodeEx(&processor, &node))
+		return node;
+#elif defined(SYS_getcpu)
+	unsigned cpu, node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+		return (int)node;
+#endif
+	return 0;
+}
\ No newline at end of file
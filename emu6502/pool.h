@@ -0,0 +1,74 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "types.h"
+#include "memory.h"
+#include "processor.h"
+
+// one emulated machine, its CPU state sits right after its memory bookkeeping
+// on the same cache lines
+struct alignas(64) Machine
+{
+	Memory		RAM;
+	Processor	CPU;
+
+	// images are copied in: a file mapping over the arena would lose its NUMA binding and huge pages
+	Machine(byte *Storage) : RAM(Storage, false), CPU(&RAM) {}
+};
+
+// fixed number of machines carved out of a single arena: the 64kb memory blocks
+// first, then the Machine objects, everything allocated at once, optionally with
+// huge pages (when the system grants them) and bound to a NUMA node
+// released machines are kept for the next Acquire() instead of being freed
+// not thread safe: meant to be owned by one worker thread
+class Pool
+{
+protected:
+	byte	*Arena;
+	size_t	ArenaSize;
+	size_t	Capacity;
+	size_t	Used;			// slots handed out at least once, the others were never touched
+	bool	HugePages;
+	std::vector<Machine *>	Free;
+
+	byte *Storage(size_t Slot) const;
+	Machine *Object(size_t Slot) const;
+
+public:
+	// Node: NUMA node to allocate from, -1 for the default policy
+	// Huge: fewer TLB misses with large pools, but the first touch of each huge page
+	// can stall on memory compaction
+	Pool(size_t Count, int Node = -1, bool Huge = false);
+	~Pool(void);
+	Pool(const Pool &) = delete;
+	Pool &operator = (const Pool &) = delete;
+
+	bool IsOpen() const;
+	bool UsesHugePages() const;
+	size_t Size() const;		// number of machines that can be acquired
+	size_t Available() const;
+	Machine *Acquire();			// nullptr when every machine is in use
+	void Release(Machine *Instance);	// memory is cleared, the CPU is back to its power on state
+
+	static int CurrentNode();	// NUMA node of the calling thread, 0 when unknown
+};
\ No newline at end of file
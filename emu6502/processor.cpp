@@ -24,7 +24,181 @@ along with this program.If not, see < http://www.gnu.org/licenses/>.
 
 #pragma warning(disable : 4996) // for strcpy() in Disassemble()
 
+// note: source and target are swapped for store instructions
+const Processor::Instruction Processor::LegalInstructionSet[151] = {
+	{0x61, "ADC",	true,	sXIndirect,		tAccumulator,	&Processor::AddWithCarry},
+	{0x65, "ADC",	true,	sZeroPage,		tAccumulator,	&Processor::AddWithCarry},
+	{0x69, "ADC",	true,	sImmediate,		tAccumulator,	&Processor::AddWithCarry},
+	{0x6D, "ADC",	true,	sAbsolute,		tAccumulator,	&Processor::AddWithCarry},
+	{0x71, "ADC",	true,	sIndirectY,		tAccumulator,	&Processor::AddWithCarry},
+	{0x75, "ADC",	true,	sZeroPageX,		tAccumulator,	&Processor::AddWithCarry},
+	{0x79, "ADC",	true,	sAbsoluteY,		tAccumulator,	&Processor::AddWithCarry},
+	{0x7D, "ADC",	true,	sAbsoluteX,		tAccumulator,	&Processor::AddWithCarry},
+	{0x21, "AND",	true,	sXIndirect,		tAccumulator,	&Processor::And},
+	{0x25, "AND",	true,	sZeroPage,		tAccumulator,	&Processor::And},
+	{0x29, "AND",	true,	sImmediate,		tAccumulator,	&Processor::And},
+	{0x2D, "AND",	true,	sAbsolute,		tAccumulator,	&Processor::And},
+	{0x31, "AND",	true,	sIndirectY,		tAccumulator,	&Processor::And},
+	{0x35, "AND",	true,	sZeroPageX,		tAccumulator,	&Processor::And},
+	{0x39, "AND",	true,	sAbsoluteY,		tAccumulator,	&Processor::And},
+	{0x3D, "AND",	true,	sAbsoluteX,		tAccumulator,	&Processor::And},
+	{0x06, "ASL",	false,	sZeroPage,		tAddress,		&Processor::ShiftLeft},
+	{0x0A, "ASL A",	false,	sImplied,		tAccumulator,	&Processor::ShiftLeft},
+	{0x0E, "ASL",	false,	sAbsolute,		tAddress,		&Processor::ShiftLeft},
+	{0x16, "ASL",	false,	sZeroPageX,		tAddress,		&Processor::ShiftLeft},
+	{0x1E, "ASL",	false,	sAbsoluteX,		tAddress,		&Processor::ShiftLeft},
+	{0x90, "BCC",	false,	sImmediate,		tNone,			&Processor::BranchIfCarryClear},
+	{0xB0, "BCS",	false,	sImmediate,		tNone,			&Processor::BranchIfCarrySet},
+	{0xF0, "BEQ",	false,	sImmediate,		tNone,			&Processor::BranchIfEqual},
+	{0x24, "BIT",	true,	sZeroPage,		tAddress,		&Processor::BitTest},
+	{0x2C, "BIT",	true,	sAbsolute,		tAddress,		&Processor::BitTest},
+	{0x30, "BMI",	false,	sImmediate,		tNone,			&Processor::BranchIfMinus},
+	{0xD0, "BNE",	false,	sImmediate,		tNone,			&Processor::BranchIfNotEqual},
+	{0x10, "BPL",	false,	sImmediate,		tNone,			&Processor::BranchIfPositive},
+	{0x00, "BRK",	false,	sImplied,		tNone,			&Processor::Break},
+	{0x50, "BVC",	false,	sImmediate,		tNone,			&Processor::BranchIfOverflowClear},
+	{0x70, "BVS",	false,	sImmediate,		tNone,			&Processor::BranchIfOverflowSet},
+	{0x18, "CLC",	false,	sImplied,		tNone,			&Processor::ClearCarryFlag},
+	{0xD8, "CLD",	false,	sImplied,		tNone,			&Processor::ClearDecimalFlag},
+	{0x58, "CLI",	false,	sImplied,		tNone,			&Processor::ClearInterruptFlag},
+	{0xB8, "CLV",	false,	sImplied,		tNone,			&Processor::ClearOverflowFlag},
+	{0xC1, "CMP",	true,	sXIndirect,		tAccumulator,	&Processor::Compare},
+	{0xC5, "CMP",	true,	sZeroPage,		tAccumulator,	&Processor::Compare},
+	{0xC9, "CMP",	true,	sImmediate,		tAccumulator,	&Processor::Compare},
+	{0xCD, "CMP",	true,	sAbsolute,		tAccumulator,	&Processor::Compare},
+	{0xD1, "CMP",	true,	sIndirectY,		tAccumulator,	&Processor::Compare},
+	{0xD5, "CMP",	true,	sZeroPageX,		tAccumulator,	&Processor::Compare},
+	{0xD9, "CMP",	true,	sAbsoluteY,		tAccumulator,	&Processor::Compare},
+	{0xDD, "CMP",	true,	sAbsoluteX,		tAccumulator,	&Processor::Compare},
+	{0xE0, "CPX",	true,	sImmediate,		tIndexX,		&Processor::Compare},
+	{0xE4, "CPX",	true,	sZeroPage,		tIndexX,		&Processor::Compare},
+	{0xEC, "CPX",	true,	sAbsolute,		tIndexX,		&Processor::Compare},
+	{0xC0, "CPY",	true,	sImmediate,		tIndexY,		&Processor::Compare},
+	{0xC4, "CPY",	true,	sZeroPage,		tIndexY,		&Processor::Compare},
+	{0xCC, "CPY",	true,	sAbsolute,		tIndexY,		&Processor::Compare},
+	{0xC6, "DEC",	false,	sZeroPage,		tAddress,		&Processor::Decrement},
+	{0xCE, "DEC",	false,	sAbsolute,		tAddress,		&Processor::Decrement},
+	{0xD6, "DEC",	false,	sZeroPageX,		tAddress,		&Processor::Decrement},
+	{0xDE, "DEC",	false,	sAbsoluteX,		tAddress,		&Processor::Decrement},
+	{0xCA, "DEX",	false,	sImplied,		tIndexX,		&Processor::Decrement},
+	{0x88, "DEY",	false,	sImplied,		tIndexY,		&Processor::Decrement},
+	{0x41, "EOR",	true,	sXIndirect,		tAccumulator,	&Processor::Xor},
+	{0x45, "EOR",	true,	sZeroPage,		tAccumulator,	&Processor::Xor},
+	{0x49, "EOR",	true,	sImmediate,		tAccumulator,	&Processor::Xor},
+	{0x4D, "EOR",	true,	sAbsolute,		tAccumulator,	&Processor::Xor},
+	{0x51, "EOR",	true,	sIndirectY,		tAccumulator,	&Processor::Xor},
+	{0x55, "EOR",	true,	sZeroPageX,		tAccumulator,	&Processor::Xor},
+	{0x59, "EOR",	true,	sAbsoluteY,		tAccumulator,	&Processor::Xor},
+	{0x5D, "EOR",	true,	sAbsoluteX,		tAccumulator,	&Processor::Xor},
+	{0xE6, "INC",	false,	sZeroPage,		tAddress,		&Processor::Increment},
+	{0xEE, "INC",	false,	sAbsolute,		tAddress,		&Processor::Increment},
+	{0xF6, "INC",	false,	sZeroPageX,		tAddress,		&Processor::Increment},
+	{0xFE, "INC",	false,	sAbsoluteX,		tAddress,		&Processor::Increment},
+	{0xE8, "INX",	false,	sImplied,		tIndexX,		&Processor::Increment},
+	{0xC8, "INY",	false,	sImplied,		tIndexY,		&Processor::Increment},
+	{0x4C, "JMP",	false,	sAbsolute,		tNone,			&Processor::Jump},
+	{0x6C, "JMP",	false,	sIndirect,		tNone,			&Processor::Jump},
+	{0x20, "JSR",	false,	sAbsolute,		tNone,			&Processor::Call},
+	{0xA1, "LDA",	true,	sXIndirect,		tAccumulator,	&Processor::Load},
+	{0xA5, "LDA",	true,	sZeroPage,		tAccumulator,	&Processor::Load},
+	{0xA9, "LDA",	true,	sImmediate,		tAccumulator,	&Processor::Load},
+	{0xAD, "LDA",	true,	sAbsolute,		tAccumulator,	&Processor::Load},
+	{0xB1, "LDA",	true,	sIndirectY,		tAccumulator,	&Processor::Load},
+	{0xB5, "LDA",	true,	sZeroPageX,		tAccumulator,	&Processor::Load},
+	{0xB9, "LDA",	true,	sAbsoluteY,		tAccumulator,	&Processor::Load},
+	{0xBD, "LDA",	true,	sAbsoluteX,		tAccumulator,	&Processor::Load},
+	{0xA2, "LDX",	true,	sImmediate,		tIndexX,		&Processor::Load},
+	{0xA6, "LDX",	true,	sZeroPage,		tIndexX,		&Processor::Load},
+	{0xAE, "LDX",	true,	sAbsolute,		tIndexX,		&Processor::Load},
+	{0xB6, "LDX",	true,	sZeroPageY,		tIndexX,		&Processor::Load},
+	{0xBE, "LDX",	true,	sAbsoluteY,		tIndexX,		&Processor::Load},
+	{0xA0, "LDY",	true,	sImmediate,		tIndexY,		&Processor::Load},
+	{0xA4, "LDY",	true,	sZeroPage,		tIndexY,		&Processor::Load},
+	{0xAC, "LDY",	true,	sAbsolute,		tIndexY,		&Processor::Load},
+	{0xB4, "LDY",	true,	sZeroPageX,		tIndexY,		&Processor::Load},
+	{0xBC, "LDY",	true,	sAbsoluteX,		tIndexY,		&Processor::Load},
+	{0x46, "LSR",	false,	sZeroPage,		tAddress,		&Processor::ShiftRight},
+	{0x4A, "LSR A",	false,	sImplied,		tAccumulator,	&Processor::ShiftRight},
+	{0x4E, "LSR",	false,	sAbsolute,		tAddress,		&Processor::ShiftRight},
+	{0x56, "LSR",	false,	sZeroPageX,		tAddress,		&Processor::ShiftRight},
+	{0x5E, "LSR",	false,	sAbsoluteX,		tAddress,		&Processor::ShiftRight},
+	{0xEA, "NOP",	false,	sImplied,		tNone,			&Processor::Nop},
+	{0x01, "ORA",	true,	sXIndirect,		tAccumulator,	&Processor::Or},
+	{0x05, "ORA",	true,	sZeroPage,		tAccumulator,	&Processor::Or},
+	{0x09, "ORA",	true,	sImmediate,		tAccumulator,	&Processor::Or},
+	{0x0D, "ORA",	true,	sAbsolute,		tAccumulator,	&Processor::Or},
+	{0x11, "ORA",	true,	sIndirectY,		tAccumulator,	&Processor::Or},
+	{0x15, "ORA",	true,	sZeroPageX,		tAccumulator,	&Processor::Or},
+	{0x19, "ORA",	true,	sAbsoluteY,		tAccumulator,	&Processor::Or},
+	{0x1D, "ORA",	true,	sAbsoluteX,		tAccumulator,	&Processor::Or},
+	{0x48, "PHA",	false,	sImplied,		tAccumulator,	&Processor::Push},
+	{0x08, "PHP",	false,	sImplied,		tStatus,		&Processor::Push},
+	{0x68, "PLA",	false,	sImplied,		tAccumulator,	&Processor::Pull},
+	{0x28, "PLP",	false,	sImplied,		tStatus,		&Processor::Pull},
+	{0x26, "ROL",	false,	sZeroPage,		tAddress,		&Processor::RotateLeft},
+	{0x2A, "ROL A",	false,	sImplied,		tAccumulator,	&Processor::RotateLeft},
+	{0x2E, "ROL",	false,	sAbsolute,		tAddress,		&Processor::RotateLeft},
+	{0x36, "ROL",	false,	sZeroPageX,		tAddress,		&Processor::RotateLeft},
+	{0x3E, "ROL",	false,	sAbsoluteX,		tAddress,		&Processor::RotateLeft},
+	{0x66, "ROR",	false,	sZeroPage,		tAddress,		&Processor::RotateRight},
+	{0x6A, "ROR A",	false,	sImplied,		tAccumulator,	&Processor::RotateRight},
+	{0x6E, "ROR",	false,	sAbsolute,		tAddress,		&Processor::RotateRight},
+	{0x76, "ROR",	false,	sZeroPageX,		tAddress,		&Processor::RotateRight},
+	{0x7E, "ROR",	false,	sAbsoluteX,		tAddress,		&Processor::RotateRight},
+	{0x40, "RTI",	false,	sImplied,		tNone,			&Processor::ReturnFromInterrupt},
+	{0x60, "RTS",	false,	sImplied,		tNone,			&Processor::Return},
+	{0xE1, "SBC",	true,	sXIndirect,		tAccumulator,	&Processor::SubtractWithCarry},
+	{0xE5, "SBC",	true,	sZeroPage,		tAccumulator,	&Processor::SubtractWithCarry},
+	{0xE9, "SBC",	true,	sImmediate,		tAccumulator,	&Processor::SubtractWithCarry},
+	{0xED, "SBC",	true,	sAbsolute,		tAccumulator,	&Processor::SubtractWithCarry},
+	{0xF1, "SBC",	true,	sIndirectY,		tAccumulator,	&Processor::SubtractWithCarry},
+	{0xF5, "SBC",	true,	sZeroPageX,		tAccumulator,	&Processor::SubtractWithCarry},
+	{0xF9, "SBC",	true,	sAbsoluteY,		tAccumulator,	&Processor::SubtractWithCarry},
+	{0xFD, "SBC",	true,	sAbsoluteX,		tAccumulator,	&Processor::SubtractWithCarry},
+	{0x38, "SEC",	false,	sImplied,		tNone,			&Processor::SetCarryFlag},
+	{0xF8, "SED",	false,	sImplied,		tNone,			&Processor::SetDecimalFlag},
+	{0x78, "SEI",	false,	sImplied,		tNone,			&Processor::SetInterruptFlag},
+	{0x81, "STA",	false,	sXIndirect,		tAccumulator,	&Processor::Store},
+	{0x85, "STA",	false,	sZeroPage,		tAccumulator,	&Processor::Store},
+	{0x8D, "STA",	false,	sAbsolute,		tAccumulator,	&Processor::Store},
+	{0x91, "STA",	false,	sIndirectY,		tAccumulator,	&Processor::Store},
+	{0x95, "STA",	false,	sZeroPageX,		tAccumulator,	&Processor::Store},
+	{0x99, "STA",	false,	sAbsoluteY,		tAccumulator,	&Processor::Store},
+	{0x9D, "STA",	false,	sAbsoluteX,		tAccumulator,	&Processor::Store},
+	{0x86, "STX",	false,	sZeroPage,		tIndexX,		&Processor::Store},
+	{0x8E, "STX",	false,	sAbsolute,		tIndexX,		&Processor::Store},
+	{0x96, "STX",	false,	sZeroPageY,		tIndexX,		&Processor::Store},
+	{0x84, "STY",	false,	sZeroPage,		tIndexY,		&Processor::Store},
+	{0x8C, "STY",	false,	sAbsolute,		tIndexY,		&Processor::Store},
+	{0x94, "STY",	false,	sZeroPageX,		tIndexY,		&Processor::Store},
+	{0xAA, "TAX",	false,	sAccumulator,	tIndexX,		&Processor::Load},
+	{0xA8, "TAY",	false,	sAccumulator,	tIndexY,		&Processor::Load},
+	{0xBA, "TSX",	false,	sStackPointer,	tIndexX,		&Processor::Load},
+	{0x8A, "TXA",	false,	sIndexX,		tAccumulator,	&Processor::Load},
+	{0x9A, "TXS",	false,	sIndexX,		tStackPointer,	&Processor::Load},
+	{0x98, "TYA",	false,	sIndexY,		tAccumulator,	&Processor::Load}
+};
+
+const Processor::Instruction *Processor::InstructionSet[256] = {};
+const bool Processor::InstructionSetReady = Processor::BuildInstructionSet();
+
+bool Processor::BuildInstructionSet()
+{
+	// leaves room for undocumented/illegal instructions
+	for (int i = 0; i < 151; i++)
+	{
+		InstructionSet[LegalInstructionSet[i].OpCode] = &LegalInstructionSet[i];
+	}
+
+	return true;
+}
+
 Processor::Processor(Memory *RAM) : RAM(*RAM)
+{
+	PowerOn();
+}
+
+void Processor::PowerOn()
 {
 	Source = nullptr;
 	Target = nullptr;
@@ -43,16 +217,13 @@ Processor::Processor(Memory *RAM) : RAM(*RAM)
 	Clock = 0;
 
 	EndOnBreak = false;
+	Breakpoint = -1;
+	Breakpoints = nullptr;
+	Hooks = nullptr;
 
 	ResetState = false;
 	InterruptState = false;
 	NonMaskableInterruptState = false;
-
-	// leaves room for undocumented/illegal instructions
-	for (int i = 0; i < 151; i++)
-	{
-		InstructionSet[LegalInstructionSet[i].OpCode] = &LegalInstructionSet[i];
-	}
 }
 
 bool Processor::FlagCarry()
@@ -111,8 +282,7 @@ void Processor::Step()
 
 	const Instruction *ins = ReadInstruction();
 
-	static char code[20];
-
+	//char code[20];
 	//Disassemble(code, ins);
 	//cout << code << endl;
 	DecodeInstruction(ins);
@@ -139,6 +309,36 @@ void Processor::Run()
 	} while ((OpCode != BreakOpCode) || !EndOnBreak);
 }
 
+StopReasons Processor::Run(int Cycles)
+{
+	int start = Clock;
+
+	while (Clock - start < Cycles)
+	{
+		word pc = PC;
+
+		if (ResetState)
+		{
+			Step();
+			continue;
+		}
+
+		if (InstructionSet[*RAM.Pointer(PC)] == nullptr)
+			return srIllegal;
+
+		Step();
+
+		if (OpCode == BreakOpCode && EndOnBreak)
+			return srBreak;
+		if (PC == Breakpoint || (Breakpoints && (Breakpoints[PC >> 6] >> (PC & 63)) & 1))
+			return srBreakpoint;
+		if (PC == pc)
+			return srLoop;
+	}
+
+	return srBudget;
+}
+
 bool Processor::IsLastInstruction(const char *Mnemonic)
 {
 	return (strcmp(LastInstruction->Mnemonic, Mnemonic) == 0);
@@ -154,6 +354,66 @@ bool Processor::IsLastInstruction(const char *Mnemonic, Sources Source, Targets
 	return ((strcmp(LastInstruction->Mnemonic, Mnemonic) == 0) && (LastInstruction->Source == Source) && (LastInstruction->Target == Target));
 }
 
+void Processor::Save(Snapshot &Snap)
+{
+	Snapshot::ProcessorState &state = Snap.CPU;
+
+	state.Clock = Clock;
+	state.A = A;
+	state.X = X;
+	state.Y = Y;
+	state.PC = PC;
+	state.S = S;
+	state.P = P;
+	state.EndOnBreak = EndOnBreak;
+
+	state.Source = PointerToOffset(Source);
+	state.Target = PointerToOffset(Target);
+	state.LastInstruction = LastInstruction ? LastInstruction->OpCode : -1;
+	state.Data = Data;
+	state.OpCode = OpCode;
+	state.Address = Address;
+
+	state.ResetState = ResetState;
+	state.InterruptState = InterruptState;
+	state.NonMaskableInterruptState = NonMaskableInterruptState;
+
+	RAM.Save(Snap);
+}
+
+void Processor::Restore(const Snapshot &Snap)
+{
+	const Snapshot::ProcessorState &state = Snap.CPU;
+
+	Clock = state.Clock;
+	A = state.A;
+	X = state.X;
+	Y = state.Y;
+	PC = state.PC;
+	S = state.S;
+	P = state.P;
+	EndOnBreak = state.EndOnBreak;
+
+	Source = OffsetToPointer(state.Source);
+	Target = OffsetToPointer(state.Target);
+	LastInstruction = state.LastInstruction >= 0 ? InstructionSet[state.LastInstruction] : nullptr;
+	Data = state.Data;
+	OpCode = state.OpCode;
+	Address = state.Address;
+
+	ResetState = state.ResetState;
+	InterruptState = state.InterruptState;
+	NonMaskableInterruptState = state.NonMaskableInterruptState;
+
+	RAM.Restore(Snap);
+}
+
+void Processor::HardReset(byte FillByte)
+{
+	PowerOn();
+	RAM.HardReset(FillByte);
+}
+
 #pragma region internal functions
 bool Processor::SignBit(byte Value)
 {
@@ -173,7 +433,7 @@ byte Processor::Add(byte A, byte B)
 byte Processor::ReadByte(word Address)
 {
 	Tick();
-	return RAM[Address];
+	return *RAM.Pointer(Address);
 }
 
 byte Processor::ReadOpCode()
@@ -185,19 +445,22 @@ byte Processor::ReadOpCode()
 word Processor::ReadWord(word Address)
 {
 	Tick(2);
-	return RAM[Address] | (RAM[Add(Address, 1)] << 8);
+	return *RAM.Pointer(Address) | (*RAM.Pointer(Add(Address, 1)) << 8);
 }
 
 void Processor::Push(byte Data)
 {
-	RAM[Add((word)0x100, S--)] = Data;
+	word address = Add((word)0x100, S--);
+
+	*RAM.Pointer(address) = Data;
+	RAM.Stored(address);
 	Tick();
 }
 
 byte Processor::PullByte()
 {
 	Tick();
-	return RAM[Add((word)0x100, ++S)];
+	return *RAM.Pointer(Add((word)0x100, ++S));
 }
 
 bool Processor::ReadFlag(Flags Flag)
@@ -219,6 +482,18 @@ void Processor::WriteTargetFlags()
 	WriteFlag(fNegative, SignBit(*Target));
 }
 
+void Processor::Touch(const byte *Pointer)
+{
+	RAM.Stored((word)(Pointer - RAM.Pointer(0)));
+}
+
+void Processor::WriteBack()
+{
+	// read-modify-write instructions also work on registers (ASL A, INX, etc.)
+	if (LastInstruction->Target == tAddress)
+		Touch(Target);
+}
+
 void Processor::Tick(byte Cycles)
 {
 	// TODO: insert throttling here
@@ -241,6 +516,7 @@ void Processor::Load()
 void Processor::Store()
 {
 	*Source = *Target;
+	Touch(Source);
 }
 
 void Processor::Compare()
@@ -274,6 +550,7 @@ void Processor::RotateLeft()
 	WriteFlag(fCarry, SignBit(*Target));
 	*Target = ((*Target) << 1) | c;
 	Tick(2); // one cycle for modify, one cycle for write
+	WriteBack();
 	WriteTargetFlags();
 }
 
@@ -283,6 +560,7 @@ void Processor::RotateRight()
 	WriteFlag(fCarry, (*Target) & 1);
 	*Target = ((*Target) >> 1) | (c << 7);
 	Tick(2); // one cycle for modify, one cycle for write
+	WriteBack();
 	WriteTargetFlags();
 }
 
@@ -291,6 +569,7 @@ void Processor::ShiftLeft()
 	WriteFlag(fCarry, SignBit(*Target));
 	*Target <<= 1;
 	Tick(2); // one cycle for modify, one cycle for write
+	WriteBack();
 	WriteTargetFlags();
 }
 
@@ -299,6 +578,7 @@ void Processor::ShiftRight()
 	WriteFlag(fCarry, (*Target) & 1);
 	*Target >>= 1;
 	Tick(2); // one cycle for modify, one cycle for write
+	WriteBack();
 	WriteTargetFlags();
 }
 
@@ -306,6 +586,7 @@ void Processor::Increment()
 {
 	(*Target)++;
 	Tick(2); // one cycle for modify, one cycle for write
+	WriteBack();
 	WriteTargetFlags();
 }
 
@@ -313,6 +594,7 @@ void Processor::Decrement()
 {
 	(*Target)--;
 	Tick(2); // one cycle for modify, one cycle for write
+	WriteBack();
 	WriteTargetFlags();
 }
 
@@ -432,6 +714,18 @@ void Processor::Call()
 {
 	PushAddress(PC - 1);
 	Tick(); // discarded data
+
+	const Hook *hook = Hooks != nullptr ? Hooks->Find(Address) : nullptr;
+
+	// the native code stands for the subroutine body, then we return from it
+	if (hook != nullptr && hook->Function(*this, RAM))
+	{
+		Clock += hook->Cycles;
+		Tick(2); // RTS opcode fetch and its discarded read
+		Return();
+		return;
+	}
+
 	Jump();
 }
 
@@ -586,6 +880,36 @@ void Processor::ReturnFromInterrupt()
 
 #pragma endregion
 
+// Source and Target either point to a register or somewhere in RAM
+// offsets 0x0000 - 0xFFFF are RAM addresses, registers come right after
+int Processor::PointerToOffset(const byte *Pointer)
+{
+	byte *registers[6] = {&A, &X, &Y, &S, &P, &Data};
+
+	if (Pointer == nullptr)
+		return -1;
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (Pointer == registers[i])
+			return 0x10000 + i;
+	}
+
+	return (int)(Pointer - RAM.Pointer(0));
+}
+
+byte *Processor::OffsetToPointer(int Offset)
+{
+	byte *registers[6] = {&A, &X, &Y, &S, &P, &Data};
+
+	if (Offset < 0)
+		return nullptr;
+	else if (Offset >= 0x10000)
+		return registers[Offset - 0x10000];
+	else
+		return RAM.Pointer((word)Offset);
+}
+
 const Processor::Instruction *Processor::ReadInstruction()
 {
 	ReadOpCode();
@@ -630,19 +954,19 @@ void Processor::DecodeInstruction(const Instruction *Ins)
 		Source = &S;
 		break;
 	case sAbsolute:
-		Source = &RAM[Address];
+		Source = RAM.Pointer(Address);
 		// if we write data in some way
 		if (Ins->Target != tNone)
 			Tick();
 		break;
 	case sAbsoluteX:
-		Source = &RAM[Add(Address, X)];
+		Source = RAM.Pointer(Add(Address, X));
 		if (!Ins->InternalExecution || (Add((word)(Address & 0xFF), X) >= 0x100))
 			Tick();
 		Tick();
 		break;
 	case sAbsoluteY:
-		Source = &RAM[Add(Address, Y)];
+		Source = RAM.Pointer(Add(Address, Y));
 		if (!Ins->InternalExecution || (Add((word)(Address & 0xFF), Y) >= 0x100))
 			Tick();
 		Tick();
@@ -654,35 +978,35 @@ void Processor::DecodeInstruction(const Instruction *Ins)
 		// JMP ($xxFF) bug (luckily the only instruction to use indirect mode)
 		if ((Address & 0xFF) == 0xFF)
 		{
-			Address = RAM[Address] | (RAM[Address & 0xFF00] << 8);
+			Address = *RAM.Pointer(Address) | (*RAM.Pointer(Address & 0xFF00) << 8);
 			Tick(2);
 		}
 		else
 			Address = ReadWord(Address);
 
-		Source = &RAM[Address];
+		Source = RAM.Pointer(Address);
 		break;
 	case sXIndirect:
-		Source = &RAM[ReadWord(Add(Data, X))];
+		Source = RAM.Pointer(ReadWord(Add(Data, X)));
 		Tick(2);
 		break;
 	case sIndirectY:
 		Address = ReadWord(Data);
-		Source = &RAM[Add(Address, Y)];
+		Source = RAM.Pointer(Add(Address, Y));
 		if (!Ins->InternalExecution || (Add((word)(Address & 0xFF), Y) >= 0x100))
 			Tick();
 		Tick();
 		break;
 	case sZeroPage:
-		Source = &RAM[Data];
+		Source = RAM.Pointer(Data);
 		Tick();
 		break;
 	case sZeroPageX:
-		Source = &RAM[Add(Data, X)];
+		Source = RAM.Pointer(Add(Data, X));
 		Tick(2);
 		break;
 	case sZeroPageY:
-		Source = &RAM[Add(Data, Y)];
+		Source = RAM.Pointer(Add(Data, Y));
 		Tick(2);
 		break;
 	default:
@@ -20,8 +20,7 @@ along with this program.If not, see < http://www.gnu.org/licenses/>.
 
 #include "types.h"
 #include "memory.h"
-
-using namespace std;
+#include "hooks.h"
 
 // TODO: add a namespace?
 
@@ -72,8 +71,23 @@ enum Targets {
 	tAddress		// LSR, ROL, INC, etc.
 };
 
+// why Run(Cycles) returned
+enum StopReasons {
+	srBudget,		// the cycles are spent
+	srBreak,		// BRK met while EndOnBreak is true
+	srBreakpoint,	// PC reached Breakpoint or one of Breakpoints
+	srLoop,			// an instruction jumped to itself, only an interrupt can get us out of there
+	srIllegal		// the opcode at PC isn't implemented, PC points to it
+};
+
+// Clock is a plain int: hosts that keep a processor running for long set it back to 0 between
+// two Run(Cycles) once it got past this and keep their own 64 bits totals, slices stay below it
+const int ClockRebase = 0x40000000;
+
 class Processor
 {
+	friend class Lockstep;	// decodes with the same instruction tables
+
 protected:
 	const word NonMaskableInterruptVector	= 0xFFFA;
 	const word ResetVector					= 0xFFFC;
@@ -90,162 +104,11 @@ protected:
 		void		(Processor::*Function)();	// the Processor function to execute when the instruction is decoded
 	};
 
-	// note: source and target are swapped for store instructions
-	const Instruction	LegalInstructionSet[151] = {
-		{0x61, "ADC",	true,	sXIndirect,		tAccumulator,	&Processor::AddWithCarry},
-		{0x65, "ADC",	true,	sZeroPage,		tAccumulator,	&Processor::AddWithCarry},
-		{0x69, "ADC",	true,	sImmediate,		tAccumulator,	&Processor::AddWithCarry},
-		{0x6D, "ADC",	true,	sAbsolute,		tAccumulator,	&Processor::AddWithCarry},
-		{0x71, "ADC",	true,	sIndirectY,		tAccumulator,	&Processor::AddWithCarry},
-		{0x75, "ADC",	true,	sZeroPageX,		tAccumulator,	&Processor::AddWithCarry},
-		{0x79, "ADC",	true,	sAbsoluteY,		tAccumulator,	&Processor::AddWithCarry},
-		{0x7D, "ADC",	true,	sAbsoluteX,		tAccumulator,	&Processor::AddWithCarry},
-		{0x21, "AND",	true,	sXIndirect,		tAccumulator,	&Processor::And},
-		{0x25, "AND",	true,	sZeroPage,		tAccumulator,	&Processor::And},
-		{0x29, "AND",	true,	sImmediate,		tAccumulator,	&Processor::And},
-		{0x2D, "AND",	true,	sAbsolute,		tAccumulator,	&Processor::And},
-		{0x31, "AND",	true,	sIndirectY,		tAccumulator,	&Processor::And},
-		{0x35, "AND",	true,	sZeroPageX,		tAccumulator,	&Processor::And},
-		{0x39, "AND",	true,	sAbsoluteY,		tAccumulator,	&Processor::And},
-		{0x3D, "AND",	true,	sAbsoluteX,		tAccumulator,	&Processor::And},
-		{0x06, "ASL",	false,	sZeroPage,		tAddress,		&Processor::ShiftLeft},
-		{0x0A, "ASL A",	false,	sImplied,		tAccumulator,	&Processor::ShiftLeft},
-		{0x0E, "ASL",	false,	sAbsolute,		tAddress,		&Processor::ShiftLeft},
-		{0x16, "ASL",	false,	sZeroPageX,		tAddress,		&Processor::ShiftLeft},
-		{0x1E, "ASL",	false,	sAbsoluteX,		tAddress,		&Processor::ShiftLeft},
-		{0x90, "BCC",	false,	sImmediate,		tNone,			&Processor::BranchIfCarryClear},
-		{0xB0, "BCS",	false,	sImmediate,		tNone,			&Processor::BranchIfCarrySet},
-		{0xF0, "BEQ",	false,	sImmediate,		tNone,			&Processor::BranchIfEqual},
-		{0x24, "BIT",	true,	sZeroPage,		tAddress,		&Processor::BitTest},
-		{0x2C, "BIT",	true,	sAbsolute,		tAddress,		&Processor::BitTest},
-		{0x30, "BMI",	false,	sImmediate,		tNone,			&Processor::BranchIfMinus},
-		{0xD0, "BNE",	false,	sImmediate,		tNone,			&Processor::BranchIfNotEqual},
-		{0x10, "BPL",	false,	sImmediate,		tNone,			&Processor::BranchIfPositive},
-		{0x00, "BRK",	false,	sImplied,		tNone,			&Processor::Break},
-		{0x50, "BVC",	false,	sImmediate,		tNone,			&Processor::BranchIfOverflowClear},
-		{0x70, "BVS",	false,	sImmediate,		tNone,			&Processor::BranchIfOverflowSet},
-		{0x18, "CLC",	false,	sImplied,		tNone,			&Processor::ClearCarryFlag},
-		{0xD8, "CLD",	false,	sImplied,		tNone,			&Processor::ClearDecimalFlag},
-		{0x58, "CLI",	false,	sImplied,		tNone,			&Processor::ClearInterruptFlag},
-		{0xB8, "CLV",	false,	sImplied,		tNone,			&Processor::ClearOverflowFlag},
-		{0xC1, "CMP",	true,	sXIndirect,		tAccumulator,	&Processor::Compare},
-		{0xC5, "CMP",	true,	sZeroPage,		tAccumulator,	&Processor::Compare},
-		{0xC9, "CMP",	true,	sImmediate,		tAccumulator,	&Processor::Compare},
-		{0xCD, "CMP",	true,	sAbsolute,		tAccumulator,	&Processor::Compare},
-		{0xD1, "CMP",	true,	sIndirectY,		tAccumulator,	&Processor::Compare},
-		{0xD5, "CMP",	true,	sZeroPageX,		tAccumulator,	&Processor::Compare},
-		{0xD9, "CMP",	true,	sAbsoluteY,		tAccumulator,	&Processor::Compare},
-		{0xDD, "CMP",	true,	sAbsoluteX,		tAccumulator,	&Processor::Compare},
-		{0xE0, "CPX",	true,	sImmediate,		tIndexX,		&Processor::Compare},
-		{0xE4, "CPX",	true,	sZeroPage,		tIndexX,		&Processor::Compare},
-		{0xEC, "CPX",	true,	sAbsolute,		tIndexX,		&Processor::Compare},
-		{0xC0, "CPY",	true,	sImmediate,		tIndexY,		&Processor::Compare},
-		{0xC4, "CPY",	true,	sZeroPage,		tIndexY,		&Processor::Compare},
-		{0xCC, "CPY",	true,	sAbsolute,		tIndexY,		&Processor::Compare},
-		{0xC6, "DEC",	false,	sZeroPage,		tAddress,		&Processor::Decrement},
-		{0xCE, "DEC",	false,	sAbsolute,		tAddress,		&Processor::Decrement},
-		{0xD6, "DEC",	false,	sZeroPageX,		tAddress,		&Processor::Decrement},
-		{0xDE, "DEC",	false,	sAbsoluteX,		tAddress,		&Processor::Decrement},
-		{0xCA, "DEX",	false,	sImplied,		tIndexX,		&Processor::Decrement},
-		{0x88, "DEY",	false,	sImplied,		tIndexY,		&Processor::Decrement},
-		{0x41, "EOR",	true,	sXIndirect,		tAccumulator,	&Processor::Xor},
-		{0x45, "EOR",	true,	sZeroPage,		tAccumulator,	&Processor::Xor},
-		{0x49, "EOR",	true,	sImmediate,		tAccumulator,	&Processor::Xor},
-		{0x4D, "EOR",	true,	sAbsolute,		tAccumulator,	&Processor::Xor},
-		{0x51, "EOR",	true,	sIndirectY,		tAccumulator,	&Processor::Xor},
-		{0x55, "EOR",	true,	sZeroPageX,		tAccumulator,	&Processor::Xor},
-		{0x59, "EOR",	true,	sAbsoluteY,		tAccumulator,	&Processor::Xor},
-		{0x5D, "EOR",	true,	sAbsoluteX,		tAccumulator,	&Processor::Xor},
-		{0xE6, "INC",	false,	sZeroPage,		tAddress,		&Processor::Increment},
-		{0xEE, "INC",	false,	sAbsolute,		tAddress,		&Processor::Increment},
-		{0xF6, "INC",	false,	sZeroPageX,		tAddress,		&Processor::Increment},
-		{0xFE, "INC",	false,	sAbsoluteX,		tAddress,		&Processor::Increment},
-		{0xE8, "INX",	false,	sImplied,		tIndexX,		&Processor::Increment},
-		{0xC8, "INY",	false,	sImplied,		tIndexY,		&Processor::Increment},
-		{0x4C, "JMP",	false,	sAbsolute,		tNone,			&Processor::Jump},
-		{0x6C, "JMP",	false,	sIndirect,		tNone,			&Processor::Jump},
-		{0x20, "JSR",	false,	sAbsolute,		tNone,			&Processor::Call},
-		{0xA1, "LDA",	true,	sXIndirect,		tAccumulator,	&Processor::Load},
-		{0xA5, "LDA",	true,	sZeroPage,		tAccumulator,	&Processor::Load},
-		{0xA9, "LDA",	true,	sImmediate,		tAccumulator,	&Processor::Load},
-		{0xAD, "LDA",	true,	sAbsolute,		tAccumulator,	&Processor::Load},
-		{0xB1, "LDA",	true,	sIndirectY,		tAccumulator,	&Processor::Load},
-		{0xB5, "LDA",	true,	sZeroPageX,		tAccumulator,	&Processor::Load},
-		{0xB9, "LDA",	true,	sAbsoluteY,		tAccumulator,	&Processor::Load},
-		{0xBD, "LDA",	true,	sAbsoluteX,		tAccumulator,	&Processor::Load},
-		{0xA2, "LDX",	true,	sImmediate,		tIndexX,		&Processor::Load},
-		{0xA6, "LDX",	true,	sZeroPage,		tIndexX,		&Processor::Load},
-		{0xAE, "LDX",	true,	sAbsolute,		tIndexX,		&Processor::Load},
-		{0xB6, "LDX",	true,	sZeroPageY,		tIndexX,		&Processor::Load},
-		{0xBE, "LDX",	true,	sAbsoluteY,		tIndexX,		&Processor::Load},
-		{0xA0, "LDY",	true,	sImmediate,		tIndexY,		&Processor::Load},
-		{0xA4, "LDY",	true,	sZeroPage,		tIndexY,		&Processor::Load},
-		{0xAC, "LDY",	true,	sAbsolute,		tIndexY,		&Processor::Load},
-		{0xB4, "LDY",	true,	sZeroPageX,		tIndexY,		&Processor::Load},
-		{0xBC, "LDY",	true,	sAbsoluteX,		tIndexY,		&Processor::Load},
-		{0x46, "LSR",	false,	sZeroPage,		tAddress,		&Processor::ShiftRight},
-		{0x4A, "LSR A",	false,	sImplied,		tAccumulator,	&Processor::ShiftRight},
-		{0x4E, "LSR",	false,	sAbsolute,		tAddress,		&Processor::ShiftRight},
-		{0x56, "LSR",	false,	sZeroPageX,		tAddress,		&Processor::ShiftRight},
-		{0x5E, "LSR",	false,	sAbsoluteX,		tAddress,		&Processor::ShiftRight},
-		{0xEA, "NOP",	false,	sImplied,		tNone,			&Processor::Nop},
-		{0x01, "ORA",	true,	sXIndirect,		tAccumulator,	&Processor::Or},
-		{0x05, "ORA",	true,	sZeroPage,		tAccumulator,	&Processor::Or},
-		{0x09, "ORA",	true,	sImmediate,		tAccumulator,	&Processor::Or},
-		{0x0D, "ORA",	true,	sAbsolute,		tAccumulator,	&Processor::Or},
-		{0x11, "ORA",	true,	sIndirectY,		tAccumulator,	&Processor::Or},
-		{0x15, "ORA",	true,	sZeroPageX,		tAccumulator,	&Processor::Or},
-		{0x19, "ORA",	true,	sAbsoluteY,		tAccumulator,	&Processor::Or},
-		{0x1D, "ORA",	true,	sAbsoluteX,		tAccumulator,	&Processor::Or},
-		{0x48, "PHA",	false,	sImplied,		tAccumulator,	&Processor::Push},
-		{0x08, "PHP",	false,	sImplied,		tStatus,		&Processor::Push},
-		{0x68, "PLA",	false,	sImplied,		tAccumulator,	&Processor::Pull},
-		{0x28, "PLP",	false,	sImplied,		tStatus,		&Processor::Pull},
-		{0x26, "ROL",	false,	sZeroPage,		tAddress,		&Processor::RotateLeft},
-		{0x2A, "ROL A",	false,	sImplied,		tAccumulator,	&Processor::RotateLeft},
-		{0x2E, "ROL",	false,	sAbsolute,		tAddress,		&Processor::RotateLeft},
-		{0x36, "ROL",	false,	sZeroPageX,		tAddress,		&Processor::RotateLeft},
-		{0x3E, "ROL",	false,	sAbsoluteX,		tAddress,		&Processor::RotateLeft},
-		{0x66, "ROR",	false,	sZeroPage,		tAddress,		&Processor::RotateRight},
-		{0x6A, "ROR A",	false,	sImplied,		tAccumulator,	&Processor::RotateRight},
-		{0x6E, "ROR",	false,	sAbsolute,		tAddress,		&Processor::RotateRight},
-		{0x76, "ROR",	false,	sZeroPageX,		tAddress,		&Processor::RotateRight},
-		{0x7E, "ROR",	false,	sAbsoluteX,		tAddress,		&Processor::RotateRight},
-		{0x40, "RTI",	false,	sImplied,		tNone,			&Processor::ReturnFromInterrupt},
-		{0x60, "RTS",	false,	sImplied,		tNone,			&Processor::Return},
-		{0xE1, "SBC",	true,	sXIndirect,		tAccumulator,	&Processor::SubtractWithCarry},
-		{0xE5, "SBC",	true,	sZeroPage,		tAccumulator,	&Processor::SubtractWithCarry},
-		{0xE9, "SBC",	true,	sImmediate,		tAccumulator,	&Processor::SubtractWithCarry},
-		{0xED, "SBC",	true,	sAbsolute,		tAccumulator,	&Processor::SubtractWithCarry},
-		{0xF1, "SBC",	true,	sIndirectY,		tAccumulator,	&Processor::SubtractWithCarry},
-		{0xF5, "SBC",	true,	sZeroPageX,		tAccumulator,	&Processor::SubtractWithCarry},
-		{0xF9, "SBC",	true,	sAbsoluteY,		tAccumulator,	&Processor::SubtractWithCarry},
-		{0xFD, "SBC",	true,	sAbsoluteX,		tAccumulator,	&Processor::SubtractWithCarry},
-		{0x38, "SEC",	false,	sImplied,		tNone,			&Processor::SetCarryFlag},
-		{0xF8, "SED",	false,	sImplied,		tNone,			&Processor::SetDecimalFlag},
-		{0x78, "SEI",	false,	sImplied,		tNone,			&Processor::SetInterruptFlag},
-		{0x81, "STA",	false,	sXIndirect,		tAccumulator,	&Processor::Store},
-		{0x85, "STA",	false,	sZeroPage,		tAccumulator,	&Processor::Store},
-		{0x8D, "STA",	false,	sAbsolute,		tAccumulator,	&Processor::Store},
-		{0x91, "STA",	false,	sIndirectY,		tAccumulator,	&Processor::Store},
-		{0x95, "STA",	false,	sZeroPageX,		tAccumulator,	&Processor::Store},
-		{0x99, "STA",	false,	sAbsoluteY,		tAccumulator,	&Processor::Store},
-		{0x9D, "STA",	false,	sAbsoluteX,		tAccumulator,	&Processor::Store},
-		{0x86, "STX",	false,	sZeroPage,		tIndexX,		&Processor::Store},
-		{0x8E, "STX",	false,	sAbsolute,		tIndexX,		&Processor::Store},
-		{0x96, "STX",	false,	sZeroPageY,		tIndexX,		&Processor::Store},
-		{0x84, "STY",	false,	sZeroPage,		tIndexY,		&Processor::Store},
-		{0x8C, "STY",	false,	sAbsolute,		tIndexY,		&Processor::Store},
-		{0x94, "STY",	false,	sZeroPageX,		tIndexY,		&Processor::Store},
-		{0xAA, "TAX",	false,	sAccumulator,	tIndexX,		&Processor::Load},
-		{0xA8, "TAY",	false,	sAccumulator,	tIndexY,		&Processor::Load},
-		{0xBA, "TSX",	false,	sStackPointer,	tIndexX,		&Processor::Load},
-		{0x8A, "TXA",	false,	sIndexX,		tAccumulator,	&Processor::Load},
-		{0x9A, "TXS",	false,	sIndexX,		tStackPointer,	&Processor::Load},
-		{0x98, "TYA",	false,	sIndexY,		tAccumulator,	&Processor::Load}
-	};
+	// shared by all instances, InstructionSet is filled from LegalInstructionSet before main()
+	static const Instruction	LegalInstructionSet[151];
+	static const Instruction	*InstructionSet[256];
+	static const bool			InstructionSetReady;
 
-	const Instruction	*InstructionSet[256] = {};
 	const Instruction	*LastInstruction;
 
 	Memory	&RAM;			// 64kb of RAM (hopefully)
@@ -271,6 +134,8 @@ protected:
 	bool ReadFlag(Flags Flag);
 	void WriteFlag(Flags Flag, bool Value);
 	void WriteTargetFlags();
+	void Touch(const byte *Pointer);	// reports the write at Pointer to RAM: dirty page, ROM and device pages
+	void WriteBack();					// same for the target of read-modify-write instructions
 	void Tick(byte Cycles = 1);
 #pragma endregion
 
@@ -316,11 +181,16 @@ protected:
 	void SetInterruptFlag();
 	void BitTest();
 #pragma endregion
+	void PowerOn();
 	void Reset();
 	void Interrupt();
 	void NonMaskableInterrupt();
 	void ReturnFromInterrupt();
 
+	int PointerToOffset(const byte *Pointer);
+	byte *OffsetToPointer(int Offset);
+
+	static bool BuildInstructionSet();
 	const Instruction *ReadInstruction();
 	void DecodeInstruction(const Instruction * Ins);
 	void ExecuteInstruction(const Instruction * Ins);
@@ -334,6 +204,9 @@ public:
 	byte	S;		// stack pointer
 	byte	P;		// status flags
 	bool	EndOnBreak;	// if true, Run() will stop on BRK
+	int		Breakpoint;	// address where Run(Cycles) stops, -1 for none
+	const uint64_t	*Breakpoints;	// 1024 words, one bit per address where Run(Cycles) also stops, nullptr for none
+	const HookTable	*Hooks;			// native subroutines run by JSR, nullptr for none
 
 	Processor(Memory *RAM);
 	bool FlagCarry();
@@ -348,6 +221,12 @@ public:
 	void Step();			// execute instruction at PC, deal with IRQ and RST if necessary
 	void Step(int Count);	// execute Count instructions
 	void Run();				// execute instructions until BRK is met (if EndOnBreak == true) or forever
+	// execute instructions until Cycles have elapsed or something stops us
+	// Clock is a plain int, reset it between runs when they add up to more than 2^31 cycles (see ClockRebase)
+	StopReasons Run(int Cycles);
+	void Save(Snapshot &Snap);			// copy the whole machine state (processor + memory) into Snap
+	void Restore(const Snapshot &Snap);	// bring the machine back to the state saved in Snap
+	void HardReset(byte FillByte = 0x00);	// same state as a new Processor on new Memory filled with FillByte
 	// used in tests to verify that the last opcode matches the instruction being tested
 	bool IsLastInstruction(const char *Mnemonic);
 	bool IsLastInstruction(const char *Mnemonic, Sources Source);
@@ -0,0 +1,155 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include <cstdio>
+#include <cinttypes>
+#include "profiler.h"
+
+Profiler::Profiler(Processor &CPU, Memory &RAM, byte Page) : CPU(CPU), RAM(RAM)
+{
+	Base = (word)(Page << 8);
+	LastClock = CPU.Clock;
+	Counter = 0;
+	Reset();
+	RAM.Fill(Base, 0x00, 0x100);
+	RAM.Attach(this, Page);
+}
+
+Profiler::~Profiler(void)
+{
+	RAM.Detach(this);
+}
+
+uint64_t Profiler::Now()
+{
+	// the host rebased Clock to 0 since we last looked
+	if (CPU.Clock < LastClock)
+		LastClock = 0;
+	Counter += (uint64_t)(CPU.Clock - LastClock);
+	LastClock = CPU.Clock;
+
+	return Counter;
+}
+
+void Profiler::Resync()
+{
+	LastClock = CPU.Clock;
+}
+
+void Profiler::Reset()
+{
+	for (Slot &slot : Profile)
+	{
+		slot.Total = 0;
+		slot.Count = 0;
+		slot.Longest = 0;
+		slot.Start = 0;
+		slot.Running = false;
+	}
+}
+
+// raw writes, they don't come back to us
+void Profiler::Store(byte Register, uint64_t Value, int Length)
+{
+	byte *registers = RAM.Pointer(Base);
+
+	for (int i = 0; i < Length; i++)
+		registers[Register + i] = (byte)(Value >> (i * 8));
+	RAM.Touch(Base);
+}
+
+void Profiler::Write(word Address, byte Value)
+{
+	switch (Address & 0xFF)
+	{
+	case prCommand:
+		if (Value & pcLatch)
+			Store(prCounter, Now(), 8);
+		if (Value & pcReset)
+		{
+			Reset();
+			for (int i = 0; i < Slots; i++)
+				Store((byte)(prTotals + i * 8), 0, 8);
+		}
+		break;
+	case prStart:
+		if (Value < Slots)
+		{
+			Profile[Value].Start = Now();
+			Profile[Value].Running = true;
+		}
+		break;
+	case prStop:
+		if (Value < Slots && Profile[Value].Running)
+		{
+			Slot &slot = Profile[Value];
+			uint64_t elapsed = Now() - slot.Start;
+
+			slot.Total += elapsed;
+			slot.Count++;
+			if (elapsed > slot.Longest)
+				slot.Longest = elapsed;
+			slot.Running = false;
+			Store(prElapsed, elapsed < 0xFFFFFFFF ? elapsed : 0xFFFFFFFF, 4);
+			Store((byte)(prTotals + Value * 8), slot.Total, 8);
+		}
+		break;
+	}
+}
+
+size_t Profiler::Report(char *Buffer, size_t Capacity) const
+{
+	size_t length = 0;
+
+	for (int i = 0; i < Slots; i++)
+	{
+		const Slot &slot = Profile[i];
+		char number[4];
+
+		if (slot.Count == 0)
+			continue;
+
+		snprintf(number, sizeof(number), "%d", i);
+
+		int written = snprintf(Buffer + length, Capacity - length, "%-16.32s %10" PRIu64 " brackets %14" PRIu64 " cycles %10" PRIu64 " average %10" PRIu64 " longest\n",
+			slot.Name.empty() ? number : slot.Name.c_str(), slot.Count, slot.Total, slot.Total / slot.Count, slot.Longest);
+
+		if (written < 0 || (size_t)written >= Capacity - length)
+			break;
+		length += written;
+	}
+
+	return length;
+}
+
+bool Profiler::Report(const char *Filename) const
+{
+	char buffer[Slots * 160];
+	size_t length = Report(buffer, sizeof(buffer));
+	bool console = Filename[0] == '-' && Filename[1] == 0;
+	FILE *file = console ? stdout : fopen(Filename, "w");
+
+	if (file == nullptr)
+		return false;
+
+	bool written = fwrite(buffer, 1, length, file) == length;
+
+	if (console)
+		return fflush(file) == 0 && written;
+
+	return fclose(file) == 0 && written;
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "types.h"
+#include "device.h"
+#include "memory.h"
+#include "processor.h"
+
+// profiler registers, offsets from the base address, little endian
+enum ProfilerRegisters : byte {
+	prCommand	= 0,	// ProfilerCommands
+	prCounter	= 1,	// 8 bytes, cycle counter as of the last pcLatch
+	prStart		= 9,	// writing a slot number starts it
+	prStop		= 10,	// writing a slot number stops it and adds the bracket to its total
+	prElapsed	= 11,	// 4 bytes, cycles of the last stopped bracket, saturated
+	prTotals	= 16	// 8 bytes per slot, cycles spent in the slot so far
+};
+
+enum ProfilerCommands : byte {
+	pcLatch		= 1,	// copies the cycle counter into prCounter
+	pcReset		= 2		// clears every slot
+};
+
+// guest visible 64 bits cycle counter and profiling slots
+// the counter follows Processor::Clock, which is a plain int that long lived hosts set back to 0
+// (see ClockRebase): a Clock going backwards counts from 0, the cycles run between the last look
+// and the rebase are lost, Resync() has to be called when the host changes Clock any other way
+class Profiler : public Device
+{
+protected:
+	Processor	&CPU;
+	Memory		&RAM;
+	word		Base;
+	int			LastClock;
+
+	void Store(byte Register, uint64_t Value, int Length);
+
+public:
+	static const int Slots = 8;
+
+	struct Slot
+	{
+		std::string	Name;		// for Report(), the slot number when empty
+		uint64_t	Total;
+		uint64_t	Count;		// brackets
+		uint64_t	Longest;
+		uint64_t	Start;		// counter when started
+		bool		Running;
+	};
+
+	uint64_t	Counter;		// cycles since the profiler was attached
+	Slot		Profile[Slots];
+
+	Profiler(Processor &CPU, Memory &RAM, byte Page);
+	~Profiler(void);
+	void Write(word Address, byte Value) override;
+
+	uint64_t Now();		// brings Counter up to date with the CPU clock
+	void Resync();		// after the host changed CPU.Clock, the cycles in between aren't counted
+	void Reset();		// same as pcReset
+	// one line per slot used: name, brackets, total, average and longest cycles
+	size_t Report(char *Buffer, size_t Capacity) const;
+	bool Report(const char *Filename) const;	// "-" for the standard output
+};
\ No newline at end of file
@@ -0,0 +1,105 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include "types.h"
+
+// machine code known at compile time: "A9 D5"_6502 is a Program<2> holding {0xA9, 0xD5}
+// same syntax as Memory::Write(): pairs of hexadecimal digits, optionally separated by spaces
+// anything else (odd number of digits, space in the middle of a byte, bad digit) doesn't compile
+template <size_t Size>
+struct Program
+{
+	byte Bytes[Size > 0 ? Size : 1];
+
+	static constexpr size_t Length = Size;
+};
+
+template <size_t N>
+struct HexString
+{
+	char Text[N];
+
+	constexpr HexString(const char (&Source)[N])
+	{
+		for (size_t i = 0; i < N; i++)
+			Text[i] = Source[i];
+	}
+};
+
+constexpr byte HexDigit(char Digit)
+{
+	if (Digit >= '0' && Digit <= '9')
+		return Digit - '0';
+	else if (Digit >= 'A' && Digit <= 'F')
+		return Digit - 'A' + 10;
+	else if (Digit >= 'a' && Digit <= 'f')
+		return Digit - 'a' + 10;
+	else
+		throw "invalid hexadecimal digit in a _6502 literal";	// not a constant expression: compilation error
+}
+
+// number of bytes in Text, also checks its syntax
+template <size_t N>
+constexpr size_t HexLength(const HexString<N> &Hex)
+{
+	size_t digits = 0;
+
+	for (size_t i = 0; i < N - 1; i++)
+	{
+		if (Hex.Text[i] == ' ')
+		{
+			if (digits & 1)
+				throw "space in the middle of a byte in a _6502 literal";
+		}
+		else
+		{
+			HexDigit(Hex.Text[i]);
+			digits++;
+		}
+	}
+
+	if (digits & 1)
+		throw "odd number of digits in a _6502 literal";
+
+	return digits / 2;
+}
+
+template <HexString Hex>
+consteval auto operator ""_6502()
+{
+	Program<HexLength(Hex)> program = {};
+	size_t count = 0;
+
+	for (size_t i = 0; Hex.Text[i] != 0; i++)
+	{
+		if (Hex.Text[i] != ' ')
+		{
+			if (count & 1)
+				program.Bytes[count / 2] |= HexDigit(Hex.Text[i]);
+			else
+				program.Bytes[count / 2] = HexDigit(Hex.Text[i]) << 4;
+			count++;
+		}
+	}
+
+	return program;
+}
@@ -0,0 +1,88 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+
+// lock free queue between exactly one producer thread and one consumer thread
+// Size must be a power of 2, Push() and Pop() never block, they fail when the ring is full or empty
+// each side keeps a copy of the other side's cursor so that it only reads the shared one (and
+// pulls its cache line over) when the copy says the ring is full or empty
+template <typename T, size_t Size>
+class Ring
+{
+	static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Ring size must be a power of 2");
+
+protected:
+	alignas(64) std::atomic<size_t>	Head;	// next slot to read, written by the consumer
+	size_t							CachedTail;
+	alignas(64) std::atomic<size_t>	Tail;	// next slot to write, written by the producer
+	size_t							CachedHead;
+	alignas(64) T					Slots[Size];
+
+public:
+	Ring(void) : Head(0), CachedTail(0), Tail(0), CachedHead(0) {}
+	Ring(const Ring &) = delete;
+	Ring &operator = (const Ring &) = delete;
+
+	// producer side
+	bool Push(const T &Value)
+	{
+		size_t tail = Tail.load(std::memory_order_relaxed);
+
+		if (tail - CachedHead == Size)
+		{
+			CachedHead = Head.load(std::memory_order_acquire);
+			if (tail - CachedHead == Size)
+				return false;
+		}
+
+		Slots[tail & (Size - 1)] = Value;
+		Tail.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// consumer side
+	bool Pop(T &Value)
+	{
+		size_t head = Head.load(std::memory_order_relaxed);
+
+		if (head == CachedTail)
+		{
+			CachedTail = Tail.load(std::memory_order_acquire);
+			if (head == CachedTail)
+				return false;
+		}
+
+		Value = Slots[head & (Size - 1)];
+		Head.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// either side, only a hint since the other side keeps going
+	bool Empty() const
+	{
+		return Head.load(std::memory_order_acquire) == Tail.load(std::memory_order_acquire);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,258 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <chrono>
+#include "runthread.h"
+
+using std::min;
+using namespace std::chrono;
+
+RunThread::RunThread(Machine *Instance, int Output, int Slice) :
+	Instance(Instance), Output(Output), Slice(Slice), Running(false), Idle(false), Budget(-1), Cycles(0),
+	CommandBell(0), Waiter(nullptr), WaiterEvent(nullptr), Dropped(0)
+{
+	memset(Breakpoints, 0, sizeof(Breakpoints));
+	Instance->CPU.Breakpoint = Output;
+	Instance->CPU.Breakpoints = Breakpoints;
+	Thread = std::thread(&RunThread::Main, this);
+}
+
+RunThread::~RunThread(void)
+{
+	while (!Send(cQuit))
+		std::this_thread::yield();
+	Thread.join();
+
+	Instance->CPU.Breakpoint = -1;
+	Instance->CPU.Breakpoints = nullptr;
+}
+
+bool RunThread::Send(const Command &Order)
+{
+	if (!CommandRing.Push(Order))
+		return false;
+
+	CommandBell.fetch_add(1, std::memory_order_release);
+	CommandBell.notify_one();
+
+	return true;
+}
+
+bool RunThread::Send(Commands Kind, int Value, word Address)
+{
+	Command order = {};
+
+	order.Kind = Kind;
+	order.Value = Value;
+	order.Address = Address;
+
+	return Send(order);
+}
+
+bool RunThread::Patch(word Address, const byte *Data, size_t Length)
+{
+	Command order = {};
+
+	order.Kind = cPatch;
+	while (Length > 0)
+	{
+		order.Address = Address;
+		order.Length = (byte)min(Length, sizeof(order.Data));
+		memcpy(order.Data, Data, order.Length);
+		if (!Send(order))
+			return false;
+
+		Address += order.Length;
+		Data += order.Length;
+		Length -= order.Length;
+	}
+
+	return true;
+}
+
+bool RunThread::Poll(Event &Next)
+{
+	return EventRing.Pop(Next);
+}
+
+bool RunThread::WaitEvent(int Milliseconds)
+{
+	// the emulation thread never signals anything, we poll with a growing delay instead
+	auto deadline = steady_clock::now() + milliseconds(Milliseconds);
+	microseconds delay(20);
+
+	while (EventRing.Empty())
+	{
+		if (steady_clock::now() >= deadline)
+			return false;
+		std::this_thread::sleep_for(delay);
+		delay = min(delay * 2, microseconds(1000));
+	}
+
+	return true;
+}
+
+bool RunThread::Dispatch()
+{
+	if (!Waiter || !Poll(*WaiterEvent))
+		return false;
+
+	std::coroutine_handle<> waiter = Waiter;
+
+	Waiter = nullptr;
+	waiter.resume();
+
+	return true;
+}
+
+void RunThread::Emit(EventKinds Kind, StopReasons Reason, byte Value)
+{
+	const Processor &cpu = Instance->CPU;
+	Event event;
+
+	event.Kind = Kind;
+	event.Reason = Reason;
+	event.Value = Value;
+	event.A = cpu.A;
+	event.X = cpu.X;
+	event.Y = cpu.Y;
+	event.S = cpu.S;
+	event.P = cpu.P;
+	event.PC = cpu.PC;
+	event.Cycles = Cycles;
+
+	if (!EventRing.Push(event))
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RunThread::Execute(const Command &Order)
+{
+	Processor &cpu = Instance->CPU;
+
+	switch (Order.Kind)
+	{
+	case cRun:
+		Running = true;
+		Idle = false;
+		Budget = Order.Value > 0 ? Order.Value : -1;
+		break;
+	case cPause:
+		Running = false;
+		Emit(ePaused);
+		break;
+	case cStep:
+		for (int i = 0; i < Order.Value; i++)
+		{
+			cpu.Step();
+			if (cpu.PC == Output)
+				Emit(eOutput, srBudget, cpu.A);
+		}
+		Running = false;
+		Emit(ePaused);
+		break;
+	case cIRQ:
+		cpu.SendIRQ();
+		Idle = false;
+		break;
+	case cNMI:
+		cpu.SendNMI();
+		Idle = false;
+		break;
+	case cReset:
+		cpu.SendRST();
+		Idle = false;
+		break;
+	case cPatch:
+		Instance->RAM.CopyIn(Order.Address, Order.Data, min((size_t)Order.Length, sizeof(Order.Data)));
+		break;
+	case cBreakpoint:
+		if (Order.Value)
+			Breakpoints[Order.Address >> 6] |= 1ULL << (Order.Address & 63);
+		else
+			Breakpoints[Order.Address >> 6] &= ~(1ULL << (Order.Address & 63));
+		break;
+	case cQuit:
+		break;
+	}
+}
+
+void RunThread::Main()
+{
+	Processor &cpu = Instance->CPU;
+	Command order;
+
+	while (true)
+	{
+		uint32_t bell = CommandBell.load(std::memory_order_acquire);
+
+		while (CommandRing.Pop(order))
+		{
+			if (order.Kind == cQuit)
+				return;
+			Execute(order);
+		}
+
+		if (!Running || Idle)
+		{
+			CommandBell.wait(bell, std::memory_order_acquire);
+			continue;
+		}
+
+		// cRun 0 runs for ever, Cycles keeps the total
+		if (cpu.Clock >= ClockRebase)
+			cpu.Clock = 0;
+
+		int clock = cpu.Clock;
+		StopReasons reason = cpu.Run(Budget >= 0 ? min(Slice, Budget) : Slice);
+
+		Cycles += cpu.Clock - clock;
+		if (Budget >= 0)
+			Budget = std::max(Budget - (cpu.Clock - clock), 0);
+
+		switch (reason)
+		{
+		case srBudget:
+			if (Budget == 0)
+			{
+				Running = false;
+				Emit(eStopped, srBudget);
+			}
+			break;
+		case srBreakpoint:
+			// the output routine goes on, breakpoints stop the machine
+			if (cpu.PC == Output)
+				Emit(eOutput, srBudget, cpu.A);
+			else
+			{
+				Running = false;
+				Emit(eBreakpoint, srBreakpoint);
+			}
+			break;
+		case srLoop:
+			Idle = true;
+			Emit(eIdle, srLoop);
+			break;
+		case srBreak:
+		case srIllegal:
+			Running = false;
+			Emit(eStopped, reason);
+			break;
+		}
+	}
+}
\ No newline at end of file
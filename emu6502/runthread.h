@@ -0,0 +1,138 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <coroutine>
+#include "types.h"
+#include "ring.h"
+#include "pool.h"
+
+enum Commands : byte {
+	cRun,			// Value: cycles to run before stopping with srBudget, 0 to run until something stops it
+	cPause,			// answered by ePaused
+	cStep,			// Value instructions, answered by ePaused
+	cIRQ,
+	cNMI,
+	cReset,			// same as SendRST(), the reset happens with the next instruction
+	cPatch,			// copies Length bytes of Data to Address
+	cBreakpoint,	// Value 1 sets a breakpoint at Address, 0 clears it
+	cQuit			// sent by the destructor
+};
+
+enum EventKinds : byte {
+	eStopped,		// BRK (EndOnBreak), illegal opcode or cycles of cRun spent, see Reason
+	eBreakpoint,	// PC reached a breakpoint set with cBreakpoint
+	eIdle,			// jump to itself, the thread sleeps until cIRQ, cNMI, cReset or cRun
+	ePaused,		// answer to cPause and cStep
+	eOutput			// the guest called its output routine, Value is A
+};
+
+struct Command
+{
+	Commands	Kind;
+	byte		Length;
+	word		Address;
+	int			Value;
+	byte		Data[24];
+};
+
+// registers are the state of the CPU when the event was sent
+struct Event
+{
+	EventKinds	Kind;
+	StopReasons	Reason;
+	byte		Value;
+	byte		A, X, Y, S, P;
+	word		PC;
+	uint64_t	Cycles;		// run by the thread so far, Processor::Clock is rebased now and then
+};
+
+// runs a machine on its own thread: the host sends commands through one lock free ring and
+// receives events through another, neither side ever waits for the other
+// - commands are read between slices of Slice cycles (Processor::Run(Cycles)) while running,
+//   the thread sleeps on an atomic when it has nothing to do
+// - events are dropped and counted in Dropped when the host doesn't read them fast enough
+// - output routine: when PC reaches it, an eOutput event carries A (e.g. CHROUT at $FFD2),
+//   it takes over Processor::Breakpoint, cBreakpoint uses Processor::Breakpoints
+// the machine must not be touched by the host while the thread runs, use cPatch
+// every public function belongs to a single host thread
+class RunThread
+{
+public:
+	static const size_t	CommandSlots = 256;
+	static const size_t	EventSlots = 4096;
+
+protected:
+	Machine					*Instance;
+	int						Output;
+	int						Slice;
+	uint64_t				Breakpoints[1024];
+	bool					Running;
+	bool					Idle;
+	int						Budget;		// cycles left for cRun, -1 without limit
+	uint64_t				Cycles;		// total, see Event::Cycles
+	Ring<Command, CommandSlots>	CommandRing;
+	Ring<Event, EventSlots>	EventRing;
+	std::atomic<uint32_t>	CommandBell;	// bumped after each command, the thread waits on it
+	std::coroutine_handle<>	Waiter;			// suspended in co_await NextEvent()
+	Event					*WaiterEvent;
+	std::thread				Thread;
+
+	void Main();
+	void Execute(const Command &Order);
+	void Emit(EventKinds Kind, StopReasons Reason = srBudget, byte Value = 0);
+
+public:
+	std::atomic<uint64_t>	Dropped;	// events lost because the event ring was full
+
+	// the CPU starts paused in its current state, Output: address of the output routine, -1 for none
+	// Slice: cycles run between two looks at the command ring, below ClockRebase
+	RunThread(Machine *Instance, int Output = -1, int Slice = 10000);
+	~RunThread(void);
+	RunThread(const RunThread &) = delete;
+	RunThread &operator = (const RunThread &) = delete;
+
+	// false when the command ring is full
+	bool Send(const Command &Order);
+	bool Send(Commands Kind, int Value = 0, word Address = 0);
+	bool Patch(word Address, const byte *Data, size_t Length);	// as many cPatch commands as needed
+	bool Poll(Event &Next);					// false when there is no event
+	bool WaitEvent(int Milliseconds);		// true when an event can be polled
+
+	// co_await NextEvent() gives the next event, the coroutine is resumed by Dispatch()
+	// from the host thread, never by the emulation thread
+	struct Awaiter
+	{
+		RunThread	*Owner;
+		Event		Result;
+
+		bool await_ready() { return Owner->Poll(Result); }
+		void await_suspend(std::coroutine_handle<> Handle) { Owner->Waiter = Handle; Owner->WaiterEvent = &Result; }
+		Event await_resume() { return Result; }
+	};
+
+	Awaiter NextEvent() { return {this, {}}; }
+	bool Dispatch();	// resumes the coroutine waiting for an event if there is one, true if it did
+};
\ No newline at end of file
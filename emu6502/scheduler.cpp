@@ -0,0 +1,283 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+#include "scheduler.h"
+
+using std::lock_guard;
+using std::unique_lock;
+using std::mutex;
+using std::vector;
+using std::micro;
+using namespace std::chrono;
+
+Scheduler::Scheduler(int Quantum) : Pending(false), Quantum(Quantum), Switches(0)
+{
+}
+
+int Scheduler::Add(Machine *Instance, int Input, word Mailbox)
+{
+	Guest guest = {};
+
+	guest.Instance = Instance;
+	guest.Input = Input;
+	guest.Mailbox = Mailbox;
+	guest.Reason = srBudget;
+	Guests.push_back(guest);
+	MakeReady((int)Guests.size() - 1);
+
+	return (int)Guests.size() - 1;
+}
+
+void Scheduler::Send(int Task, Kinds Kind, const byte *Data, size_t Length)
+{
+	{
+		lock_guard<mutex> lock(Lock);
+
+		Events.push_back({Task, Kind, vector<byte>(Data, Data + Length)});
+		Pending.store(true, std::memory_order_release);
+	}
+	Signal.notify_one();
+}
+
+void Scheduler::Deliver(int Task, const byte *Data, size_t Length)
+{
+	Send(Task, kInput, Data, Length);
+}
+
+void Scheduler::SendIRQ(int Task)
+{
+	Send(Task, kInterrupt);
+}
+
+void Scheduler::SendNMI(int Task)
+{
+	Send(Task, kNonMaskableInterrupt);
+}
+
+void Scheduler::Wake(int Task)
+{
+	Send(Task, kWake);
+}
+
+void Scheduler::Drain()
+{
+	vector<Event> events;
+
+	{
+		lock_guard<mutex> lock(Lock);
+
+		events.swap(Events);
+		Pending.store(false, std::memory_order_relaxed);
+	}
+
+	for (Event &event : events)
+	{
+		Guest &guest = Guests[event.Task];
+
+		if (guest.State == tsStopped)
+			continue;
+
+		switch (event.Kind)
+		{
+		case kInput:
+			guest.Queue.insert(guest.Queue.end(), event.Data.begin(), event.Data.end());
+			break;
+		case kInterrupt:
+			guest.Instance->CPU.SendIRQ();
+			break;
+		case kNonMaskableInterrupt:
+			guest.Instance->CPU.SendNMI();
+			break;
+		case kWake:
+			break;
+		}
+
+		// input only matters to machines waiting for it
+		if (guest.State == tsIdle && event.Kind == kInput)
+			continue;
+		if (guest.State != tsReady)
+			MakeReady(event.Task);
+	}
+}
+
+void Scheduler::MakeReady(int Task)
+{
+	Guests[Task].State = tsReady;
+	Guests[Task].ReadySince = steady_clock::now();
+	Ready.push_back(Task);
+}
+
+bool Scheduler::Feed(Guest &Task)
+{
+	if (Task.Queue.empty())
+		return false;
+
+	Task.Instance->RAM[Task.Mailbox] = Task.Queue.front();
+	Task.Queue.pop_front();
+
+	return true;
+}
+
+bool Scheduler::Step()
+{
+	if (Pending.load(std::memory_order_acquire))
+		Drain();
+
+	if (Ready.empty())
+		return false;
+
+	int task = Ready.front();
+	Guest &guest = Guests[task];
+	Processor &cpu = guest.Instance->CPU;
+	TaskStatistics &statistics = guest.Statistics;
+	auto start = steady_clock::now();
+	double latency = duration<double, micro>(start - guest.ReadySince).count();
+	int clock;
+	int left = Quantum;
+	StopReasons reason;
+
+	Ready.pop_front();
+	cpu.Breakpoint = guest.Input;
+	// machines run for ever here, Statistics.Cycles keeps the total
+	if (cpu.Clock >= ClockRebase)
+		cpu.Clock = 0;
+	clock = cpu.Clock;
+
+	// woken up without input (Wake() or an interrupt), it has to wait some more
+	if (guest.Waiting)
+	{
+		if (!Feed(guest))
+		{
+			guest.State = tsBlocked;
+			statistics.Parks++;
+			return true;
+		}
+		guest.Waiting = false;
+	}
+
+	while (true)
+	{
+		reason = cpu.Run(left);
+		left = Quantum - (cpu.Clock - clock);
+
+		if (reason != srBreakpoint)
+			break;
+		if (!Feed(guest))
+		{
+			guest.State = tsBlocked;
+			guest.Waiting = true;
+			break;
+		}
+		reason = srBudget;
+		if (left <= 0)
+			break;
+	}
+
+	auto end = steady_clock::now();
+
+	guest.Reason = reason;
+	statistics.Cycles += (uint64_t)(cpu.Clock - clock);
+	statistics.Slices++;
+	statistics.Latency += latency;
+	if (latency > statistics.MaxLatency)
+		statistics.MaxLatency = latency;
+	statistics.Runnable += duration<double, micro>(end - guest.ReadySince).count();
+	Switches++;
+
+	switch (reason)
+	{
+	case srBudget:
+		MakeReady(task);
+		break;
+	case srLoop:
+		guest.State = tsIdle;
+		statistics.Parks++;
+		break;
+	case srBreakpoint:
+		statistics.Parks++;
+		break;
+	case srBreak:
+	case srIllegal:
+		guest.State = tsStopped;
+		break;
+	}
+
+	return true;
+}
+
+bool Scheduler::Wait(int Milliseconds)
+{
+	unique_lock<mutex> lock(Lock);
+
+	return Signal.wait_for(lock, milliseconds(Milliseconds), [this]() { return !Events.empty(); });
+}
+
+void Scheduler::Run(const std::atomic<bool> &Stop)
+{
+	// the timeout only bounds how long it takes to notice Stop
+	while (!Stop.load(std::memory_order_relaxed))
+	{
+		if (!Step())
+			Wait(10);
+	}
+}
+
+size_t Scheduler::Count() const
+{
+	return Guests.size();
+}
+
+size_t Scheduler::ReadyCount() const
+{
+	return Ready.size();
+}
+
+TaskStates Scheduler::State(int Task) const
+{
+	return Guests[Task].State;
+}
+
+StopReasons Scheduler::Reason(int Task) const
+{
+	return Guests[Task].Reason;
+}
+
+const TaskStatistics &Scheduler::Statistics(int Task) const
+{
+	return Guests[Task].Statistics;
+}
+
+double Scheduler::Fairness() const
+{
+	double sum = 0, squares = 0;
+	int count = 0;
+
+	for (const Guest &guest : Guests)
+	{
+		if (guest.State != tsReady || guest.Statistics.Runnable <= 0)
+			continue;
+
+		double rate = guest.Statistics.Cycles / guest.Statistics.Runnable;
+
+		sum += rate;
+		squares += rate * rate;
+		count++;
+	}
+
+	return count && squares > 0 ? sum * sum / (count * squares) : 1.0;
+}
\ No newline at end of file
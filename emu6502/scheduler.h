@@ -0,0 +1,124 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "types.h"
+#include "pool.h"
+
+enum TaskStates {
+	tsReady,	// waiting for its turn or running
+	tsIdle,		// parked on an instruction jumping to itself until an interrupt or Wake()
+	tsBlocked,	// parked at its input routine until Deliver() gives it something to read
+	tsStopped	// BRK met with EndOnBreak or illegal opcode, see Reason()
+};
+
+struct TaskStatistics
+{
+	uint64_t	Cycles;		// guest cycles run
+	uint64_t	Slices;		// quanta received
+	uint64_t	Parks;		// times it went idle or blocked
+	double		Latency;	// total time spent in the ready queue, in microseconds
+	double		MaxLatency;	// longest single wait in the ready queue
+	double		Runnable;	// total time spent ready or running, in microseconds
+};
+
+// green threads: many machines sharing the host thread that calls Step() or Run(), each one runs
+// for Quantum cycles through Processor::Run(Cycles) then goes to the back of the ready queue
+// machines jumping to themselves (JMP *) are parked until an interrupt, machines reaching their
+// input routine with nothing to read are parked until Deliver() gives them data: parked machines
+// cost nothing, only the ready queue is ever looked at
+// input routine: when PC reaches it, the next byte given to Deliver() is stored at the mailbox
+// address and the routine runs as usual, e.g. GETCHAR: LDA $D000 / RTS with $D000 as mailbox
+// Add(), Step(), Run() and the accessors belong to the scheduler thread, the functions waking
+// machines up can be called from any thread
+class Scheduler
+{
+protected:
+	enum Kinds : byte { kInput, kInterrupt, kNonMaskableInterrupt, kWake };
+
+	struct Event
+	{
+		int					Task;
+		Kinds				Kind;
+		std::vector<byte>	Data;
+	};
+
+	struct Guest
+	{
+		Machine			*Instance;
+		int				Input;		// address of the input routine, -1 for none
+		word			Mailbox;
+		bool			Waiting;	// stopped at the input routine, the mailbox is not filled yet
+		TaskStates		State;
+		StopReasons		Reason;
+		std::deque<byte>	Queue;	// delivered and not read yet
+		std::chrono::steady_clock::time_point	ReadySince;
+		TaskStatistics	Statistics;
+	};
+
+	std::vector<Guest>	Guests;
+	std::deque<int>		Ready;
+
+	// events sent by other threads, handled by the scheduler thread before its next slice
+	std::mutex				Lock;
+	std::condition_variable	Signal;
+	std::vector<Event>		Events;
+	std::atomic<bool>		Pending;
+
+	void Drain();
+	void MakeReady(int Task);
+	bool Feed(Guest &Task);	// stores the next input byte in the mailbox, false when there is none
+	void Send(int Task, Kinds Kind, const byte *Data = nullptr, size_t Length = 0);
+
+public:
+	int			Quantum;	// cycles per slice, below ClockRebase
+	uint64_t	Switches;	// slices run so far
+
+	Scheduler(int Quantum = 10000);
+	Scheduler(const Scheduler &) = delete;
+	Scheduler &operator = (const Scheduler &) = delete;
+
+	// the machine is ready to run from its current state (see Processor::SendRST()), the caller keeps ownership
+	int Add(Machine *Instance, int Input = -1, word Mailbox = 0);
+	void Deliver(int Task, const byte *Data, size_t Length);
+	void SendIRQ(int Task);
+	void SendNMI(int Task);
+	void Wake(int Task);	// back to the ready queue if idle or blocked, without interrupt
+	bool Step();			// one slice of the next ready machine, false when none is ready
+	bool Wait(int Milliseconds);	// sleeps until another thread wakes a machine up, false on timeout
+	void Run(const std::atomic<bool> &Stop);	// Step() until Stop, sleeps while every machine is parked
+	size_t Count() const;
+	size_t ReadyCount() const;
+	TaskStates State(int Task) const;
+	StopReasons Reason(int Task) const;	// why the last slice of the machine ended
+	const TaskStatistics &Statistics(int Task) const;
+	// Jain's index of the cycles per second received by the ready machines while they were
+	// runnable, 1.0 when they all got the same share (parked machines didn't ask for more)
+	double Fairness() const;
+};
\ No newline at end of file
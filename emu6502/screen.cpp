@@ -0,0 +1,178 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "screen.h"
+
+// cursor moves cost up to 8 bytes, shorter gaps are cheaper to print through
+const int MergeGap = 8;
+
+TextScreen::TextScreen(Memory &RAM, word Address) : RAM(RAM)
+{
+	Base = Address;
+	CellsWritten = 0;
+	CellsRendered = 0;
+	Invalidate();
+	RAM.Attach(this, (byte)(Base >> 8), ((Base + Cells - 1) >> 8) - (Base >> 8) + 1);
+}
+
+TextScreen::~TextScreen(void)
+{
+	RAM.Detach(this);
+}
+
+void TextScreen::Write(word Address, byte)
+{
+	int cell = (word)(Address - Base);
+
+	if (cell < Cells)
+	{
+		Dirty[cell >> 6] |= 1ULL << (cell & 63);
+		CellsWritten++;
+	}
+}
+
+char TextScreen::Character(int Cell) const
+{
+	byte value = RAM[(word)(Base + Cell)];
+
+	return value >= 0x20 && value < 0x7F ? (char)value : ' ';
+}
+
+void TextScreen::ClearDirty()
+{
+	memset(Dirty, 0, sizeof(Dirty));
+}
+
+bool TextScreen::IsDirty() const
+{
+	for (uint64_t bits : Dirty)
+		if (bits)
+			return true;
+
+	return false;
+}
+
+void TextScreen::Invalidate()
+{
+	memset(Dirty, 0xFF, sizeof(Dirty));
+	Dirty[15] &= (1ULL << (Cells & 63)) - 1;
+}
+
+size_t TextScreen::Render(char *Buffer, size_t Capacity)
+{
+	char *out = Buffer;
+	char *end = Buffer + Capacity;
+
+	for (int i = 0; i < 16; i++)
+	{
+		while (Dirty[i])
+		{
+			int first = i * 64 + std::countr_zero(Dirty[i]);
+			int row = first / Columns;
+			int last = first;
+
+			// extend the run over the dirty cells of the row, through short clean gaps
+			for (int cell = first + 1; cell < (row + 1) * Columns && cell - last <= MergeGap; cell++)
+				if ((Dirty[cell >> 6] >> (cell & 63)) & 1)
+					last = cell;
+
+			char position[16];
+			int length = snprintf(position, sizeof(position), "\x1B[%d;%dH", row + 1, first % Columns + 1);
+
+			if (end - out < length + last - first + 1)
+				return out - Buffer;
+
+			memcpy(out, position, length);
+			out += length;
+			for (int cell = first; cell <= last; cell++)
+			{
+				*out++ = Character(cell);
+				Dirty[cell >> 6] &= ~(1ULL << (cell & 63));
+			}
+			CellsRendered += last - first + 1;
+		}
+	}
+
+	return out - Buffer;
+}
+
+// write() can return early, loop until everything is out
+static bool WriteAll(int Descriptor, const char *Data, size_t Length)
+{
+	while (Length > 0)
+	{
+#ifdef _WIN32
+		int written = _write(Descriptor, Data, (unsigned int)Length);
+#else
+		ssize_t written = write(Descriptor, Data, Length);
+#endif
+		if (written <= 0)
+			return false;
+
+		Data += written;
+		Length -= written;
+	}
+
+	return true;
+}
+
+bool TextScreen::Render(int Descriptor)
+{
+	if (!IsDirty())
+		return true;
+
+	char buffer[RenderCapacity];
+
+	return WriteAll(Descriptor, buffer, Render(buffer, sizeof(buffer)));
+}
+
+size_t TextScreen::Frame(char *Buffer, size_t Capacity)
+{
+	if (Capacity < FrameCapacity)
+		return 0;
+
+	char *out = Buffer;
+
+	for (int row = 0; row < Rows; row++)
+	{
+		for (int column = 0; column < Columns; column++)
+			*out++ = Character(row * Columns + column);
+		*out++ = '\n';
+	}
+	ClearDirty();
+	CellsRendered += Cells;
+
+	return out - Buffer;
+}
+
+bool TextScreen::Frame(int Descriptor)
+{
+	if (!IsDirty())
+		return true;
+
+	char buffer[FrameCapacity];
+
+	return WriteAll(Descriptor, buffer, Frame(buffer, sizeof(buffer)));
+}
\ No newline at end of file
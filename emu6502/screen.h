@@ -0,0 +1,67 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "types.h"
+#include "device.h"
+#include "memory.h"
+
+// 40x25 text screen, one byte per character cell, row after row
+// writes only flag their cell, nothing is rendered until Render() or Frame() is called,
+// so a headless run pays one bit per character written
+class TextScreen : public Device
+{
+protected:
+	Memory		&RAM;
+	word		Base;
+	uint64_t	Dirty[16];	// one bit per cell, 1000 used
+
+	char Character(int Cell) const;
+	void ClearDirty();
+
+public:
+	static const int Columns = 40;
+	static const int Rows = 25;
+	static const int Cells = Columns * Rows;
+	static constexpr size_t RenderCapacity = 2048;				// enough for any Render()
+	static constexpr size_t FrameCapacity = (Columns + 1) * Rows;	// Frame() output, a line feed after each row
+
+	uint64_t	CellsWritten;
+	uint64_t	CellsRendered;
+
+	// the screen memory starts at Address, every page it touches is attached
+	TextScreen(Memory &RAM, word Address);
+	~TextScreen(void);
+	void Write(word Address, byte Value) override;
+
+	bool IsDirty() const;
+	// flags every cell, after a terminal clear or when the memory changed behind our back
+	// (raw writes, Memory::Restore())
+	void Invalidate();
+	// ANSI cursor addressed updates of the dirty cells, row by row, close runs are merged
+	// stops before a run that doesn't fit, its cells stay dirty
+	size_t Render(char *Buffer, size_t Capacity);
+	bool Render(int Descriptor);	// nothing is written when nothing changed
+	// the whole screen as text, for periodic dumps
+	size_t Frame(char *Buffer, size_t Capacity);
+	bool Frame(int Descriptor);		// nothing is written when nothing changed
+};
\ No newline at end of file
@@ -0,0 +1,676 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#include "service.h"
+#include "hash.h"
+
+using std::vector;
+using std::shared_ptr;
+using std::make_shared;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+using std::atomic;
+using namespace std::chrono;
+
+#pragma region wire format
+static void Put16(vector<byte> &Message, uint16_t Value)
+{
+	Message.push_back((byte)Value);
+	Message.push_back((byte)(Value >> 8));
+}
+
+static void Put32(vector<byte> &Message, uint32_t Value)
+{
+	Put16(Message, (uint16_t)Value);
+	Put16(Message, (uint16_t)(Value >> 16));
+}
+
+static void Put64(vector<byte> &Message, uint64_t Value)
+{
+	Put32(Message, (uint32_t)Value);
+	Put32(Message, (uint32_t)(Value >> 32));
+}
+
+static void Set32(vector<byte> &Message, size_t Offset, uint32_t Value)
+{
+	for (int i = 0; i < 4; i++)
+		Message[Offset + i] = (byte)(Value >> (i * 8));
+}
+
+static uint16_t Get16(const byte *Data)
+{
+	return (uint16_t)(Data[0] | Data[1] << 8);
+}
+
+static uint32_t Get32(const byte *Data)
+{
+	return Get16(Data) | (uint32_t)Get16(Data + 2) << 16;
+}
+
+static uint64_t Get64(const byte *Data)
+{
+	return Get32(Data) | (uint64_t)Get32(Data + 4) << 32;
+}
+
+void Encode(ServiceRequest &Request, vector<byte> &Message)
+{
+	size_t start = Message.size();
+
+	if (Request.ImageHash == 0 && !Request.Image.empty())
+		Request.ImageHash = Hash64(Request.Image.data(), Request.Image.size());
+
+	Put32(Message, 0);		// length, set at the end
+	Put32(Message, Request.Id);
+	Put64(Message, Request.ImageHash);
+	Put64(Message, Request.Budget);
+	Put32(Message, (uint32_t)Request.Entry);
+	Put32(Message, (uint32_t)Request.Stop);
+	Message.push_back(Request.Flags);
+	Message.push_back(Request.Fill);
+	Put16(Message, (uint16_t)Request.Inputs.size());
+	Put16(Message, (uint16_t)Request.Outputs.size());
+	Put16(Message, 0);
+	Put32(Message, (uint32_t)Request.Image.size());
+	Message.insert(Message.end(), Request.Image.begin(), Request.Image.end());
+	for (const Job::Range &input : Request.Inputs)
+	{
+		Put16(Message, input.Address);
+		Put16(Message, (uint16_t)input.Data.size());
+		Message.insert(Message.end(), input.Data.begin(), input.Data.end());
+	}
+	for (const Job::Range &output : Request.Outputs)
+	{
+		Put16(Message, output.Address);
+		Put16(Message, (uint16_t)output.Data.size());
+	}
+
+	Set32(Message, start, (uint32_t)(Message.size() - start));
+}
+
+size_t Decode(const byte *Data, size_t Length, ServiceResponse &Response)
+{
+	if (Length < ServiceResponseHeader)
+		return 0;
+
+	uint32_t size = Get32(Data);
+
+	if (size < ServiceResponseHeader || Length < size)
+		return 0;
+
+	Response.Id = Get32(Data + 4);
+	Response.Status = Data[8];
+	Response.Reason = Data[9];
+	Response.A = Data[10];
+	Response.X = Data[11];
+	Response.Y = Data[12];
+	Response.S = Data[13];
+	Response.P = Data[14];
+	Response.PC = Get16(Data + 16);
+	Response.Cycles = Get64(Data + 20);
+	Response.Digest = Get64(Data + 28);
+	Response.Nanoseconds = Get64(Data + 36);
+	Response.Outputs.assign(Data + ServiceResponseHeader, Data + size);
+
+	return size;
+}
+#pragma endregion
+
+#pragma region sockets
+static void CloseSocket(intptr_t Socket)
+{
+#ifdef _WIN32
+	closesocket((SOCKET)Socket);
+#else
+	close((int)Socket);
+#endif
+}
+
+// true when there is something to read (or the peer hung up), false on timeout or signal
+static bool WaitReadable(intptr_t Socket, int Milliseconds)
+{
+#ifdef _WIN32
+	WSAPOLLFD descriptor = {(SOCKET)Socket, POLLRDNORM, 0};
+
+	return WSAPoll(&descriptor, 1, Milliseconds) > 0;
+#else
+	pollfd descriptor = {(int)Socket, POLLIN, 0};
+
+	return poll(&descriptor, 1, Milliseconds) > 0;
+#endif
+}
+
+static bool SocketAddress(const char *Path, sockaddr_un &Address)
+{
+#ifdef _WIN32
+	static bool started = [] { WSADATA data; return WSAStartup(MAKEWORD(2, 2), &data) == 0; }();
+
+	if (!started)
+		return false;
+#endif
+	memset(&Address, 0, sizeof(Address));
+	if (strlen(Path) >= sizeof(Address.sun_path))
+		return false;
+	Address.sun_family = AF_UNIX;
+	strcpy(Address.sun_path, Path);
+	return true;
+}
+
+// true when nothing is left at Path: nothing was there or it was a socket nobody listens on anymore
+// anything else (a live service, a regular file) is left alone
+static bool RemoveStaleSocket(const char *Path, const sockaddr_un &Address)
+{
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesA(Path);
+
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+		return GetLastError() == ERROR_FILE_NOT_FOUND;
+	// Unix domain sockets are reparse points
+	if (!(attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+		return false;
+#else
+	struct stat status;
+
+	if (lstat(Path, &status) != 0)
+		return errno == ENOENT;
+	if (!S_ISSOCK(status.st_mode))
+		return false;
+#endif
+
+	intptr_t probe = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (probe == -1)
+		return false;
+
+#ifdef _WIN32
+	bool live = connect((SOCKET)probe, (const sockaddr *)&Address, sizeof(Address)) == 0;
+#else
+	bool live = connect((int)probe, (const sockaddr *)&Address, sizeof(Address)) == 0;
+#endif
+	CloseSocket(probe);
+	if (live)
+		return false;
+
+#ifdef _WIN32
+	return DeleteFileA(Path) != 0;
+#else
+	return unlink(Path) == 0;
+#endif
+}
+
+static bool SendAll(intptr_t Socket, const vector<byte> &Data)
+{
+	size_t sent = 0;
+
+	while (sent < Data.size())
+	{
+#ifdef _WIN32
+		int count = send((SOCKET)Socket, (const char *)Data.data() + sent, (int)(Data.size() - sent), 0);
+#elif defined(MSG_NOSIGNAL)
+		ssize_t count = send((int)Socket, Data.data() + sent, Data.size() - sent, MSG_NOSIGNAL);
+#else
+		ssize_t count = send((int)Socket, Data.data() + sent, Data.size() - sent, 0);
+#endif
+		if (count <= 0)
+			return false;
+		sent += count;
+	}
+
+	return true;
+}
+#pragma endregion
+
+Service::Service(int Instances, size_t ImageLimit) : Machines(Instances > 0 ? Instances : 1)
+{
+	this->ImageLimit = ImageLimit > 0 ? ImageLimit : 1;
+	Listener = -1;
+	Active = 0;
+	Statistics.Requests = 0;
+	Statistics.Cycles = 0;
+	Statistics.CacheHits = 0;
+	Statistics.CacheMisses = 0;
+	Statistics.Connections = 0;
+
+	// warm up: every machine built and its 64kb touched before the first request
+	vector<Machine *> warm;
+
+	while (Machine *instance = Machines.Acquire())
+	{
+		instance->RAM.Fill(0x0000, 0x00, 0x10000);
+		warm.push_back(instance);
+	}
+	for (Machine *instance : warm)
+		Machines.Release(instance);
+}
+
+Service::~Service(void)
+{
+	if (Listener != -1)
+		CloseSocket(Listener);
+}
+
+bool Service::IsOpen() const
+{
+	return Machines.IsOpen();
+}
+
+Machine *Service::Acquire()
+{
+	unique_lock<mutex> lock(MachinesLock);
+	Machine *instance;
+
+	MachineReleased.wait(lock, [&]() { return (instance = Machines.Acquire()) != nullptr; });
+	return instance;
+}
+
+void Service::Release(Machine *Instance)
+{
+	{
+		lock_guard<mutex> lock(MachinesLock);
+		Machines.Release(Instance);
+	}
+	MachineReleased.notify_one();
+}
+
+shared_ptr<const Service::CachedImage> Service::FindImage(uint64_t Hash, bool Hex)
+{
+	lock_guard<mutex> lock(ImagesLock);
+	auto found = Images.find(ImageKey(Hash, Hex));
+
+	return found == Images.end() ? nullptr : found->second;
+}
+
+shared_ptr<const Service::CachedImage> Service::AddImage(uint64_t Hash, const byte *Data, size_t Length, bool Hex)
+{
+	// parsed outside of the lock, two connections sending the same new image both parse it
+	shared_ptr<CachedImage> image = make_shared<CachedImage>();
+
+	if (Hex)
+	{
+		image->Hex.reset(new Image());
+		if (!image->Hex->ParseHex((const char *)Data, Length))
+			return nullptr;
+	}
+	else
+	{
+		if (Length > 0x10000)
+			return nullptr;
+		image->Binary.assign(Data, Data + Length);
+	}
+
+	lock_guard<mutex> lock(ImagesLock);
+
+	if (Images.emplace(ImageKey(Hash, Hex), image).second)
+	{
+		ImageOrder.push_back(ImageKey(Hash, Hex));
+		if (ImageOrder.size() > ImageLimit)
+		{
+			// requests still running on the evicted image hold their own reference
+			Images.erase(ImageOrder.front());
+			ImageOrder.pop_front();
+		}
+	}
+
+	return image;
+}
+
+void Service::Respond(vector<byte> &Output, uint32_t Id, ServiceStatuses Status)
+{
+	size_t start = Output.size();
+
+	Output.resize(start + ServiceResponseHeader, 0);
+	Set32(Output, start, ServiceResponseHeader);
+	Set32(Output, start + 4, Id);
+	Output[start + 8] = Status;
+}
+
+long long Service::Handle(const byte *Input, size_t Length, vector<byte> &Output, Machine &Instance)
+{
+	Processor &cpu = Instance.CPU;
+	Memory &ram = Instance.RAM;
+	size_t used = 0;
+
+	while (Length - used >= 4)
+	{
+		const byte *request = Input + used;
+		uint32_t size = Get32(request);
+
+		if (size < ServiceRequestHeader || size > ServiceMaxMessage)
+		{
+			Respond(Output, 0, ssBadRequest);
+			return -1;
+		}
+		if (Length - used < size)
+			break;
+
+		auto start = steady_clock::now();
+		uint32_t id = Get32(request + 4);
+		uint64_t hash = Get64(request + 8);
+		uint64_t budget = Get64(request + 16);
+		int entry = (int)Get32(request + 24);
+		int stop = (int)Get32(request + 28);
+		byte flags = request[32];
+		byte fill = request[33];
+		uint16_t inputs = Get16(request + 34);
+		uint16_t outputs = Get16(request + 36);
+		uint32_t imageLength = Get32(request + 40);
+
+		// every range has to fit in the message
+		const byte *image = request + ServiceRequestHeader;
+		const byte *end = request + size;
+		const byte *ranges = image + imageLength;
+		const byte *outputRanges;
+		size_t outputLength = 0;
+
+		if (imageLength > size - ServiceRequestHeader)
+		{
+			Respond(Output, id, ssBadRequest);
+			return -1;
+		}
+		for (uint16_t i = 0; i < inputs; i++)
+		{
+			if (end - ranges < 4 || end - ranges - 4 < Get16(ranges + 2))
+			{
+				Respond(Output, id, ssBadRequest);
+				return -1;
+			}
+			ranges += 4 + Get16(ranges + 2);
+		}
+		outputRanges = ranges;
+		if (end - ranges != (ptrdiff_t)outputs * 4)
+		{
+			Respond(Output, id, ssBadRequest);
+			return -1;
+		}
+		for (uint16_t i = 0; i < outputs; i++)
+			outputLength += Get16(outputRanges + i * 4 + 2);
+		// the response has to fit in a message too
+		if (outputLength > ServiceMaxMessage - ServiceResponseHeader)
+		{
+			Respond(Output, id, ssBadRequest);
+			return -1;
+		}
+
+		used += size;
+		Statistics.Requests++;
+
+		shared_ptr<const CachedImage> cached;
+
+		if (imageLength > 0)
+		{
+			uint64_t actual = Hash64(image, imageLength);
+
+			if (hash != 0 && hash != actual)
+			{
+				Respond(Output, id, ssBadImage);
+				continue;
+			}
+			if ((cached = FindImage(actual, (flags & sfHex) != 0)))
+				Statistics.CacheHits++;
+			else
+			{
+				Statistics.CacheMisses++;
+				if (!(cached = AddImage(actual, image, imageLength, (flags & sfHex) != 0)))
+				{
+					Respond(Output, id, ssBadImage);
+					continue;
+				}
+			}
+		}
+		else if ((cached = FindImage(hash, (flags & sfHex) != 0)))
+			Statistics.CacheHits++;
+		else
+		{
+			Statistics.CacheMisses++;
+			Respond(Output, id, ssUnknownImage);
+			continue;
+		}
+
+		// same sequence as a job (see RunJob() in jobs.cpp)
+		cpu.HardReset(fill);
+		if (cached->Hex)
+			ram.LoadSegments(*cached->Hex);
+		else
+			ram.CopyIn(0x0000, cached->Binary.data(), cached->Binary.size());
+
+		ranges = image + imageLength;
+		for (uint16_t i = 0; i < inputs; i++)
+		{
+			uint16_t count = Get16(ranges + 2);
+
+			ram.CopyIn(Get16(ranges), ranges + 4, count);
+			ranges += 4 + count;
+		}
+
+		cpu.EndOnBreak = (flags & sfEndOnBreak) != 0;
+		cpu.SendRST();
+		cpu.Step();
+		if (entry >= 0)
+			cpu.PC = (word)entry;
+		cpu.Breakpoint = stop;
+
+		uint64_t cycles;
+		StopReasons reason = RunBudget(cpu, budget, cycles);
+
+		Statistics.Cycles += cycles;
+
+		size_t response = Output.size();
+
+		Respond(Output, id, ssOk);
+		Set32(Output, response, (uint32_t)(ServiceResponseHeader + outputLength));
+		Output[response + 9] = (byte)reason;
+		Output[response + 10] = cpu.A;
+		Output[response + 11] = cpu.X;
+		Output[response + 12] = cpu.Y;
+		Output[response + 13] = cpu.S;
+		Output[response + 14] = cpu.P;
+		Output[response + 16] = (byte)cpu.PC;
+		Output[response + 17] = (byte)(cpu.PC >> 8);
+		for (int i = 0; i < 8; i++)
+			Output[response + 20 + i] = (byte)(cycles >> (i * 8));
+		if (flags & sfDigest)
+		{
+			uint64_t digest = ram.Digest();
+
+			for (int i = 0; i < 8; i++)
+				Output[response + 28 + i] = (byte)(digest >> (i * 8));
+		}
+
+		Output.resize(response + ServiceResponseHeader + outputLength);
+		byte *data = Output.data() + response + ServiceResponseHeader;
+		for (uint16_t i = 0; i < outputs; i++)
+		{
+			uint16_t count = Get16(outputRanges + i * 4 + 2);
+
+			ram.CopyOut(data, Get16(outputRanges + i * 4), count);
+			data += count;
+		}
+
+		uint64_t nanoseconds = duration_cast<std::chrono::nanoseconds>(steady_clock::now() - start).count();
+
+		for (int i = 0; i < 8; i++)
+			Output[response + 36 + i] = (byte)(nanoseconds >> (i * 8));
+	}
+
+	return (long long)used;
+}
+
+bool Service::Listen(const char *Path)
+{
+	sockaddr_un address;
+
+	if (!SocketAddress(Path, address) || !RemoveStaleSocket(Path, address))
+		return false;
+
+	intptr_t listener = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (listener == -1)
+		return false;
+	if (bind(listener, (const sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 128) != 0)
+	{
+		CloseSocket(listener);
+		return false;
+	}
+
+	Listener = listener;
+	return true;
+}
+
+void Service::Connection(intptr_t Socket, const atomic<bool> &Running)
+{
+	vector<byte> input, output;
+	byte chunk[65536];
+
+	while (Running)
+	{
+		if (!WaitReadable(Socket, 100))
+			continue;
+
+#ifdef _WIN32
+		int count = recv((SOCKET)Socket, (char *)chunk, sizeof(chunk), 0);
+#else
+		ssize_t count = recv((int)Socket, chunk, sizeof(chunk), 0);
+#endif
+		if (count <= 0)
+			break;
+		input.insert(input.end(), chunk, chunk + count);
+
+		// a machine is only taken once there is at least one whole request (or a broken one)
+		if (input.size() < 4)
+			continue;
+
+		uint32_t size = Get32(input.data());
+
+		if (size >= ServiceRequestHeader && size <= ServiceMaxMessage && input.size() < size)
+			continue;
+
+		Machine *instance = Acquire();
+		long long used = Handle(input.data(), input.size(), output, *instance);
+
+		Release(instance);
+		if (!SendAll(Socket, output) || used < 0)
+			break;
+		output.clear();
+		input.erase(input.begin(), input.begin() + (size_t)used);
+	}
+
+	CloseSocket(Socket);
+	Active--;
+}
+
+void Service::Serve(const atomic<bool> &Running)
+{
+	if (Listener == -1)
+		return;
+
+	while (Running)
+	{
+		if (!WaitReadable(Listener, 100))
+			continue;
+
+		intptr_t socket = (intptr_t)accept(Listener, nullptr, nullptr);
+
+		if (socket == -1)
+			continue;
+
+		Statistics.Connections++;
+		Active++;
+		std::thread(&Service::Connection, this, socket, std::cref(Running)).detach();
+	}
+
+	// the connections notice Running within their next poll
+	while (Active > 0)
+		std::this_thread::sleep_for(milliseconds(10));
+}
+
+ServiceClient::ServiceClient(void)
+{
+	Socket = -1;
+}
+
+ServiceClient::~ServiceClient(void)
+{
+	if (Socket != -1)
+		CloseSocket(Socket);
+}
+
+bool ServiceClient::Connect(const char *Path)
+{
+	sockaddr_un address;
+
+	if (Socket != -1 || !SocketAddress(Path, address))
+		return false;
+
+	Socket = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+	if (Socket == -1)
+		return false;
+	if (connect(Socket, (const sockaddr *)&address, sizeof(address)) != 0)
+	{
+		CloseSocket(Socket);
+		Socket = -1;
+		return false;
+	}
+
+	return true;
+}
+
+bool ServiceClient::Send(const vector<byte> &Message)
+{
+	return Socket != -1 && SendAll(Socket, Message);
+}
+
+bool ServiceClient::Receive(ServiceResponse &Response)
+{
+	byte chunk[65536];
+
+	while (Socket != -1)
+	{
+		size_t used = Decode(Received.data(), Received.size(), Response);
+
+		if (used > 0)
+		{
+			Received.erase(Received.begin(), Received.begin() + used);
+			return true;
+		}
+
+#ifdef _WIN32
+		int count = recv((SOCKET)Socket, (char *)chunk, sizeof(chunk), 0);
+#else
+		ssize_t count = recv((int)Socket, chunk, sizeof(chunk), 0);
+#endif
+		if (count <= 0)
+			return false;
+		Received.insert(Received.end(), chunk, chunk + count);
+	}
+
+	return false;
+}
\ No newline at end of file
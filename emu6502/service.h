@@ -0,0 +1,170 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "types.h"
+#include "image.h"
+#include "jobs.h"
+#include "pool.h"
+
+// emulator service: short runs sent over a local socket are run on machines allocated and touched
+// once at startup, with the images they use cached by hash
+//
+// wire format, little endian, any number of requests can be sent without waiting for the responses
+// (they come back in the same order)
+//   request:  u32 length (whole message), u32 id, u64 image hash, u64 budget, i32 entry (-1: reset vector),
+//             i32 stop (-1: none), u8 flags (ServiceFlags), u8 fill, u16 inputs, u16 outputs, u16 reserved,
+//             u32 image length, image bytes, inputs (u16 address, u16 length, bytes), outputs (u16 address, u16 length)
+//   response: u32 length, u32 id, u8 status (ServiceStatuses), u8 stop reason, u8 A, X, Y, S, P, u8 reserved,
+//             u16 PC, u16 reserved, u64 cycles, u64 digest, u64 nanoseconds, output bytes one range after the other
+// an image sent inline is cached under its Hash64() and sfHex, later requests can send only the hash
+// with the same sfHex and get ssUnknownImage back if it was evicted meanwhile
+
+enum ServiceFlags : byte {
+	sfHex			= 1,	// the inline image is Intel HEX text, raw bytes loaded at $0000 otherwise
+	sfEndOnBreak	= 2,
+	sfDigest		= 4		// fill the memory digest in the response
+};
+
+enum ServiceStatuses : byte {
+	ssOk,
+	ssUnknownImage,		// no inline image and nothing cached under that hash, send it again
+	ssBadImage,			// the inline image doesn't parse or its hash isn't the one given
+	ssBadRequest		// malformed message, the connection is closed after this response
+};
+
+const size_t ServiceRequestHeader = 44;
+const size_t ServiceResponseHeader = 44;
+const size_t ServiceMaxMessage = 1 << 24;
+
+struct ServiceRequest
+{
+	uint32_t	Id;
+	uint64_t	ImageHash;		// 0: computed from Image
+	std::vector<byte>	Image;	// empty to use the cached image
+	uint64_t	Budget;
+	int			Entry;
+	int			Stop;
+	byte		Flags;
+	byte		Fill;
+	std::vector<Job::Range>	Inputs;
+	std::vector<Job::Range>	Outputs;	// only the size of Data matters
+};
+
+struct ServiceResponse
+{
+	uint32_t	Id;
+	byte		Status;
+	byte		Reason;			// StopReasons
+	byte		A, X, Y, S, P;
+	word		PC;
+	uint64_t	Cycles;
+	uint64_t	Digest;
+	uint64_t	Nanoseconds;	// time spent loading and running
+	std::vector<byte>	Outputs;
+};
+
+// client side encoding, Encode() appends to Message and also fills ImageHash when it was 0
+void Encode(ServiceRequest &Request, std::vector<byte> &Message);
+// number of bytes used from Data, 0 when the response isn't complete yet
+size_t Decode(const byte *Data, size_t Length, ServiceResponse &Response);
+
+struct ServiceStatistics
+{
+	std::atomic<uint64_t>	Requests;
+	std::atomic<uint64_t>	Cycles;
+	std::atomic<uint64_t>	CacheHits;
+	std::atomic<uint64_t>	CacheMisses;	// including the unknown hashes
+	std::atomic<uint64_t>	Connections;
+};
+
+class Service
+{
+protected:
+	struct CachedImage
+	{
+		std::unique_ptr<Image>	Hex;
+		std::vector<byte>		Binary;
+	};
+	typedef std::pair<uint64_t, bool> ImageKey;	// Hash64() of the image, true for Intel HEX text
+
+	Pool						Machines;
+	std::mutex					MachinesLock;
+	std::condition_variable		MachineReleased;
+	std::mutex					ImagesLock;
+	std::map<ImageKey, std::shared_ptr<const CachedImage>>	Images;
+	std::deque<ImageKey>		ImageOrder;		// oldest first, evicted beyond ImageLimit
+	size_t						ImageLimit;
+	intptr_t					Listener;		// socket, -1 until Listen()
+	std::atomic<int>			Active;			// connections being served
+
+	std::shared_ptr<const CachedImage> FindImage(uint64_t Hash, bool Hex);
+	std::shared_ptr<const CachedImage> AddImage(uint64_t Hash, const byte *Data, size_t Length, bool Hex);
+	void Respond(std::vector<byte> &Output, uint32_t Id, ServiceStatuses Status);
+	void Connection(intptr_t Socket, const std::atomic<bool> &Running);
+
+public:
+	ServiceStatistics	Statistics;
+
+	// Instances: machines shared by the connections, ImageLimit: images kept in the cache
+	Service(int Instances, size_t ImageLimit = 256);
+	~Service(void);
+	Service(const Service &) = delete;
+	Service &operator = (const Service &) = delete;
+
+	bool IsOpen() const;
+	Machine *Acquire();		// waits for a machine when they're all in use
+	void Release(Machine *Instance);
+
+	// runs every complete request at the start of Input on Instance and appends the responses to Output
+	// returns the number of bytes used, -1 after a malformed request
+	long long Handle(const byte *Input, size_t Length, std::vector<byte> &Output, Machine &Instance);
+
+	// Unix domain socket, replaces a socket file nobody listens on, false if anything else is at Path
+	bool Listen(const char *Path);
+	void Serve(const std::atomic<bool> &Running);	// one thread per connection, returns once Running is false
+};
+
+// blocking connection to a Service, requests built with Encode() can be sent in batches
+class ServiceClient
+{
+protected:
+	intptr_t			Socket;
+	std::vector<byte>	Received;	// read but not decoded yet
+
+public:
+	ServiceClient(void);
+	~ServiceClient(void);
+	ServiceClient(const ServiceClient &) = delete;
+	ServiceClient &operator = (const ServiceClient &) = delete;
+
+	bool Connect(const char *Path);
+	bool Send(const std::vector<byte> &Message);
+	bool Receive(ServiceResponse &Response);	// false once the service closed the connection
+};
\ No newline at end of file
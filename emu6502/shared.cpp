@@ -0,0 +1,253 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include <new>
+#include "shared.h"
+
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
+
+SharedMachine::SharedMachine(const char *Name) : Segment(Create(Name)), RAM(Segment + SharedMemoryOffset, false), CPU(&RAM)
+{
+	Publish();
+}
+
+byte *SharedMachine::Create(const char *Name)
+{
+	void *segment = nullptr;
+
+	this->Name = Name;
+#ifdef _WIN32
+	Handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, (DWORD)SharedSize, Name);
+	if (Handle != nullptr && GetLastError() != ERROR_ALREADY_EXISTS)
+		segment = MapViewOfFile(Handle, FILE_MAP_ALL_ACCESS, 0, 0, SharedSize);
+
+	Open = segment != nullptr;
+	if (!Open)
+	{
+		if (Handle != nullptr)
+			CloseHandle(Handle);
+		Handle = nullptr;
+		segment = VirtualAlloc(nullptr, SharedSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	}
+#else
+	// fails if the segment exists, it may belong to a live machine (see Remove()), fresh segments are zero filled
+	int descriptor = shm_open(Name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+	if (descriptor != -1)
+	{
+		if (ftruncate(descriptor, SharedSize) == 0)
+			segment = mmap(nullptr, SharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+		close(descriptor);
+		if (segment == MAP_FAILED)
+		{
+			segment = nullptr;
+			shm_unlink(Name);
+		}
+	}
+
+	Open = segment != nullptr;
+	if (!Open)
+		segment = mmap(nullptr, SharedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+
+	SharedHeader *header = new (segment) SharedHeader();
+
+	header->Magic = SharedMagic;
+	header->Version = SharedVersion;
+	return (byte *)segment;
+}
+
+bool SharedMachine::Remove(const char *Name)
+{
+#ifdef _WIN32
+	// the mapping goes away with its last handle, nothing is left behind
+	(void)Name;
+	return true;
+#else
+	return shm_unlink(Name) == 0;
+#endif
+}
+
+SharedMachine::~SharedMachine(void)
+{
+	// RAM doesn't own its storage, it never looks at it again
+#ifdef _WIN32
+	UnmapViewOfFile(Segment);
+	if (Handle != nullptr)
+		CloseHandle(Handle);
+	else
+		VirtualFree(Segment, 0, MEM_RELEASE);
+#else
+	munmap(Segment, SharedSize);
+	if (Open)
+		shm_unlink(Name.c_str());
+#endif
+}
+
+SharedHeader &SharedMachine::Header() const
+{
+	return *(SharedHeader *)Segment;
+}
+
+bool SharedMachine::IsOpen() const
+{
+	return Open;
+}
+
+void SharedMachine::Publish()
+{
+	SharedHeader &header = Header();
+	uint32_t sequence = header.Sequence.load(memory_order_relaxed);
+
+	// seqlock: readers retry when the sequence is odd or changed while they were copying
+	header.Sequence.store(sequence + 1, memory_order_relaxed);
+	std::atomic_thread_fence(memory_order_release);
+	header.Registers.store(CPU.PC | (uint64_t)CPU.A << 16 | (uint64_t)CPU.X << 24 | (uint64_t)CPU.Y << 32 |
+		(uint64_t)CPU.S << 40 | (uint64_t)CPU.P << 48, memory_order_relaxed);
+	header.Clock.store(CPU.Clock, memory_order_relaxed);
+	header.Sequence.store(sequence + 2, memory_order_release);
+}
+
+StopReasons SharedMachine::Run(int Cycles, int Slice)
+{
+	int end = CPU.Clock + Cycles;
+	StopReasons reason = srBudget;
+
+	if (Slice <= 0)
+		Slice = Cycles;
+
+	while (CPU.Clock < end)
+	{
+		reason = CPU.Run(end - CPU.Clock < Slice ? end - CPU.Clock : Slice);
+		Publish();
+		if (reason != srBudget)
+			break;
+	}
+
+	return reason;
+}
+
+SharedView::SharedView(void)
+{
+	Segment = nullptr;
+#ifdef _WIN32
+	Handle = nullptr;
+#endif
+}
+
+SharedView::~SharedView(void)
+{
+	Close();
+}
+
+bool SharedView::Open(const char *Name)
+{
+	void *segment = nullptr;
+
+	Close();
+#ifdef _WIN32
+	Handle = OpenFileMappingA(FILE_MAP_READ, FALSE, Name);
+	if (Handle == nullptr)
+		return false;
+	segment = MapViewOfFile(Handle, FILE_MAP_READ, 0, 0, SharedSize);
+#else
+	int descriptor = shm_open(Name, O_RDONLY, 0);
+
+	if (descriptor == -1)
+		return false;
+	segment = mmap(nullptr, SharedSize, PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (segment == MAP_FAILED)
+		segment = nullptr;
+#endif
+
+	Segment = (const byte *)segment;
+	if (Segment == nullptr || ((const SharedHeader *)Segment)->Magic != SharedMagic || ((const SharedHeader *)Segment)->Version != SharedVersion)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void SharedView::Close()
+{
+#ifdef _WIN32
+	if (Segment != nullptr)
+		UnmapViewOfFile(Segment);
+	if (Handle != nullptr)
+		CloseHandle(Handle);
+	Handle = nullptr;
+#else
+	if (Segment != nullptr)
+		munmap((void *)Segment, SharedSize);
+#endif
+	Segment = nullptr;
+}
+
+bool SharedView::IsOpen() const
+{
+	return Segment != nullptr;
+}
+
+const byte *SharedView::Memory() const
+{
+	return Segment + SharedMemoryOffset;
+}
+
+bool SharedView::Read(SharedRegisters &Registers) const
+{
+	// the mapping is read only, the atomics are only ever loaded from
+	const SharedHeader &header = *(const SharedHeader *)Segment;
+
+	for (int attempt = 0; attempt < 1000; attempt++)
+	{
+		uint32_t before = header.Sequence.load(memory_order_acquire);
+
+		if (before & 1)
+			continue;
+
+		uint64_t registers = header.Registers.load(memory_order_relaxed);
+		int64_t clock = header.Clock.load(memory_order_relaxed);
+
+		std::atomic_thread_fence(memory_order_acquire);
+		if (header.Sequence.load(memory_order_relaxed) != before)
+			continue;
+
+		Registers.Clock = clock;
+		Registers.PC = (word)registers;
+		Registers.A = (byte)(registers >> 16);
+		Registers.X = (byte)(registers >> 24);
+		Registers.Y = (byte)(registers >> 32);
+		Registers.S = (byte)(registers >> 40);
+		Registers.P = (byte)(registers >> 48);
+		Registers.Sequence = before;
+		return true;
+	}
+
+	return false;
+}
\ No newline at end of file
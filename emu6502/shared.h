@@ -0,0 +1,111 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <string>
+#include "types.h"
+#include "memory.h"
+#include "processor.h"
+
+// first page of a shared segment, the 64kb of guest memory follow at SharedMemoryOffset
+// the registers are only as fresh as the last Publish(), memory is live
+struct SharedHeader
+{
+	uint32_t				Magic;		// SharedMagic
+	uint32_t				Version;
+	std::atomic<uint32_t>	Sequence;	// odd while the registers are being written, +2 per Publish()
+	uint32_t				Reserved;
+	std::atomic<uint64_t>	Registers;	// PC | A << 16 | X << 24 | Y << 32 | S << 40 | P << 48
+	std::atomic<int64_t>	Clock;
+};
+
+const uint32_t SharedMagic = 0x32353645;	// "E652"
+const uint32_t SharedVersion = 1;
+const size_t SharedMemoryOffset = 4096;
+const size_t SharedSize = SharedMemoryOffset + 0x10000;
+
+struct SharedRegisters
+{
+	int64_t		Clock;
+	word		PC;
+	byte		A, X, Y, S, P;
+	uint32_t	Sequence;	// changes with every Publish()
+};
+
+// a machine whose memory and registers live in a named shared memory segment (POSIX shm_open(),
+// file mapping on Windows) so that other processes can watch it run through a SharedView
+// the segment is removed when the machine goes away, creating one whose name is taken fails
+// (IsOpen() is false) on every platform, Remove() clears a segment left over by a crashed process
+class SharedMachine
+{
+protected:
+	std::string	Name;
+	byte		*Segment;	// SharedHeader then the guest memory
+	bool		Open;		// false when the segment couldn't be created, Segment is private memory then
+#ifdef _WIN32
+	void		*Handle;
+#endif
+
+	byte *Create(const char *Name);
+	SharedHeader &Header() const;
+
+public:
+	Memory		RAM;		// never replaced by file mappings, Load() copies
+	Processor	CPU;
+
+	SharedMachine(const char *Name);	// "/emu6502-ci-42", a leading / for portability with POSIX
+	~SharedMachine(void);
+	SharedMachine(const SharedMachine &) = delete;
+	SharedMachine &operator = (const SharedMachine &) = delete;
+
+	bool IsOpen() const;	// false when the segment couldn't be created or the name was taken
+	void Publish();		// copies the registers to the segment, only call it from the thread running CPU
+	// Run(Cycles) in slices, publishing after each of them
+	StopReasons Run(int Cycles, int Slice = 10000);
+
+	// removes the segment called Name even if a machine still uses it, only for leftovers
+	static bool Remove(const char *Name);
+};
+
+// read only view of a SharedMachine, from any process
+class SharedView
+{
+protected:
+	const byte	*Segment;
+#ifdef _WIN32
+	void		*Handle;
+#endif
+
+public:
+	SharedView(void);
+	~SharedView(void);
+	SharedView(const SharedView &) = delete;
+	SharedView &operator = (const SharedView &) = delete;
+
+	bool Open(const char *Name);	// false when there is no such segment or it isn't one of ours
+	void Close();
+	bool IsOpen() const;
+	const byte *Memory() const;		// 64kb, changing under our feet while the machine runs
+	// consistent copy of the last published registers, false if the writer kept us out for too long
+	bool Read(SharedRegisters &Registers) const;
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+
+// complete machine state (processor + memory)
+// only plain data in here so a snapshot can be copied around with memcpy, written 
+// to a file or restored into another Processor/Memory pair: internal pointers are
+// stored as offsets (see Processor::PointerToOffset)
+struct Snapshot
+{
+	struct ProcessorState
+	{
+		int		Clock;
+		byte	A;
+		byte	X, Y;
+		word	PC;
+		byte	S;
+		byte	P;
+		bool	EndOnBreak;
+
+		// internal latches
+		int		Source;			// offset of the instruction source
+		int		Target;			// offset of the instruction target
+		int		LastInstruction;// opcode of the last instruction, -1 if none
+		byte	Data;
+		byte	OpCode;
+		word	Address;
+
+		// pending interrupts
+		bool	ResetState;
+		bool	InterruptState;
+		bool	NonMaskableInterruptState;
+	};
+
+	ProcessorState	CPU;
+	uint64_t		Owner;			// identity of the Memory that saved it, 0 forces a full restore (after editing RAM)
+	uint64_t		Generation;		// number given by Memory::Save(), only meaningful along with Owner
+	word			WriteCounter;
+	byte			RAM[0x10000];
+};
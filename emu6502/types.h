@@ -18,5 +18,6 @@ along with this program.If not, see < http://www.gnu.org/licenses/>.
 
 #pragma once
 
+// clashes with std::byte, so pull names from std one by one rather than with using namespace std
 using byte = unsigned char;
 using word = unsigned short;
\ No newline at end of file
@@ -0,0 +1,863 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+// micro benchmarks for the emulator
+// usage: emu6502bench [name], runs every benchmark when no name is given
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include "processor.h"
+#include "memory.h"
+#include "pool.h"
+#include "lockstep.h"
+#include "scheduler.h"
+#include "runthread.h"
+#include "service.h"
+#include "shared.h"
+#include "board.h"
+#include "dma.h"
+#include "block.h"
+#include "screen.h"
+#include "mathdevice.h"
+
+using std::cout;
+using std::endl;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::hex;
+using std::dec;
+using std::ofstream;
+using std::ifstream;
+using std::ios;
+using std::string;
+using std::vector;
+using std::thread;
+using std::micro;
+using namespace std::chrono;
+
+// returns the average duration of one call in microseconds
+template <typename Function>
+double Measure(int Iterations, Function Body)
+{
+	auto start = steady_clock::now();
+
+	for (int i = 0; i < Iterations; i++)
+		Body();
+
+	return duration<double, micro>(steady_clock::now() - start).count() / Iterations;
+}
+
+void WriteImage(const char *Filename, size_t Size)
+{
+	ofstream file(Filename, ios::binary);
+
+	for (size_t i = 0; i < Size; i++)
+		file.put((char)(i * 7));
+}
+
+// ReadFile() used to read binary images with ifstream into the array
+void StreamLoad(const char *Filename, byte *Array)
+{
+	ifstream file(Filename, ios::binary);
+
+	file.read((char *)Array, 0x10000);
+}
+
+void BenchmarkBinaryLoad()
+{
+	const int		iterations = 2000;
+	const size_t	sizes[] = {0x400, 0x1000, 0x4000, 0x10000};
+	const char		*filename = "emu6502bench.bin";
+	Memory			*ram = new Memory();
+	byte			*array = new byte[0x10000];
+
+	cout << "binary image load (us per load)" << endl;
+	cout << setw(8) << "size" << setw(12) << "ifstream" << setw(12) << "ReadFile" << setw(12) << "shared map" << endl;
+
+	for (size_t size : sizes)
+	{
+		WriteImage(filename, size);
+
+		MappedFile image(filename);
+		double stream = Measure(iterations, [&]() { StreamLoad(filename, array); });
+		double read = Measure(iterations, [&]() { ram->ReadFile(filename); });
+		double mapped = Measure(iterations, [&]() { ram->Load(image); });
+
+		cout << setw(8) << size << fixed << setprecision(2) << setw(12) << stream << setw(12) << read << setw(12) << mapped << endl;
+	}
+	cout << endl;
+
+	remove(filename);
+	delete[] array;
+	delete ram;
+}
+
+// banked Intel HEX image, 32 bytes per record with an extended linear address record every 64kb
+size_t WriteHexImage(const char *Filename, int Banks)
+{
+	ofstream file(Filename, ios::binary);
+	char row[80];
+	size_t size = 0;
+
+	for (int bank = 0; bank < Banks; bank++)
+	{
+		size += snprintf(row, sizeof(row), ":02000004%04X%02X\n", bank, (byte)(0x100 - (6 + (bank >> 8) + bank)));
+		file << row;
+
+		for (int address = 0; address < 0x10000; address += 32)
+		{
+			byte checksum = 32 + (address >> 8) + address;
+			char *p = row + snprintf(row, sizeof(row), ":20%04X00", address);
+
+			for (int i = 0; i < 32; i++)
+			{
+				byte value = (byte)(bank + address + i);
+				checksum += value;
+				p += snprintf(p, 3, "%02X", value);
+			}
+			p += snprintf(p, 5, "%02X\n", (byte)-checksum);
+			size += p - row;
+			file << row;
+		}
+	}
+	file << ":00000001FF\n";
+
+	return size + 12;
+}
+
+void BenchmarkHexLoad()
+{
+	const int	iterations = 10;
+	const int	banks = 64;
+	const char	*filename = "emu6502bench.hex";
+	Image		image;
+	LoadError	error;
+	bool		success = true;
+	size_t		size = WriteHexImage(filename, banks);
+
+	Memory		*ram = new Memory();
+
+	double time = Measure(iterations, [&]() { success &= image.ReadHex(filename, &error); });
+
+	cout << "Intel HEX parsing, " << banks << " banks (" << size / 1024 << " kb of text)" << endl;
+	if (!success)
+	{
+		cout << "error line " << error.Line << ", column " << error.Column << ": " << error.Message << endl << endl;
+		remove(filename);
+		return;
+	}
+	cout << fixed << setprecision(0) << time << " us per load, " << size / time << " MB/s" << endl;
+
+	// first call builds the cache next to the file
+	image.ReadHex(filename, &error, "");
+	double cached = Measure(iterations, [&]() { image.ReadHex(filename, &error, ""); ram->Load(image); });
+	cout << cached << " us per load with the cache (" << (image.CacheFile() ? "hit" : "miss") << ")" << endl << endl;
+
+	delete ram;
+	remove(filename);
+	remove((string(filename) + ".cache").c_str());
+}
+
+// Memory::Read() used to format every nibble with a branch
+char *BranchRead(const byte *Array, char *Buffer, word Address, word Size)
+{
+	for (int i = 0; i < Size; i++)
+	{
+		word a = i + Address;
+
+		Buffer[i * 3] = (Array[a] >> 4) + ((Array[a] >> 4) > 9 ? 55 : 48);
+		Buffer[i * 3 + 1] = (Array[a] & 0x0F) + ((Array[a] & 0x0F) > 9 ? 55 : 48);
+		Buffer[i * 3 + 2] = ' ';
+	}
+
+	Buffer[Size * 3] = 0;
+
+	return Buffer;
+}
+
+void BenchmarkDump()
+{
+	const int	iterations = 200;
+	Memory		*ram = new Memory();
+	size_t		capacity = Memory::DumpCapacity(0x10000, dHex);
+	char		*buffer = new char[capacity];
+	size_t		size = 0;
+
+	for (int i = 0; i < 0x10000; i++)
+		(*ram)[i] = (byte)(i * 7);
+
+	// what main.cpp did: 16 bytes at a time through Read()
+	double read = Measure(iterations, [&]() {
+		for (int a = 0; a < 0x10000; a += 16)
+			BranchRead(ram->Pointer(0), buffer + a * 3, a, 16);
+	});
+	double hex = Measure(iterations, [&]() { size = ram->Dump(buffer, capacity, 0x0000, 0x10000, dHex); });
+	double binary = Measure(iterations, [&]() { ram->Dump(buffer, capacity, 0x0000, 0x10000, 0); });
+
+	cout << "full memory dump (us per dump)" << endl;
+	cout << fixed << setprecision(1) << setw(12) << "old Read" << setw(12) << "hex" << setw(12) << "binary" << endl;
+	cout << setw(12) << read << setw(12) << hex << setw(12) << binary << endl;
+	cout << setprecision(0) << size / hex << " MB/s of hex text" << endl << endl;
+
+	delete[] buffer;
+	delete ram;
+}
+
+void BenchmarkPool()
+{
+	const size_t	count = 10000;
+	Processor		**cpus = new Processor *[count];
+	Memory			**rams = new Memory *[count];
+	Machine			**machines = new Machine *[count];
+
+	cout << "creating " << count << " machines (ms)" << endl;
+
+	double heap = Measure(1, [&]() {
+		for (size_t i = 0; i < count; i++)
+		{
+			rams[i] = new Memory();
+			cpus[i] = new Processor(rams[i]);
+		}
+	});
+	double free = Measure(1, [&]() {
+		for (size_t i = 0; i < count; i++)
+		{
+			delete cpus[i];
+			delete rams[i];
+		}
+	});
+
+	Pool *pool = nullptr;
+	double huge = Measure(1, [&]() {
+		pool = new Pool(count, -1, true);
+		for (size_t i = 0; i < count; i++)
+			machines[i] = pool->Acquire();
+	});
+	bool huge_pages = pool->UsesHugePages();
+	delete pool;
+
+	double arena = Measure(1, [&]() {
+		pool = new Pool(count);
+		for (size_t i = 0; i < count; i++)
+			machines[i] = pool->Acquire();
+	});
+	// the first run of each machine writes a little bit of memory
+	for (size_t i = 0; i < count; i++)
+		machines[i]->RAM.Write(0x0200, "A9 D5 8D 00 20"_6502);
+	double recycle = Measure(1, [&]() {
+		for (size_t i = 0; i < count; i++)
+			pool->Release(machines[i]);
+		for (size_t i = 0; i < count; i++)
+			machines[i] = pool->Acquire();
+	});
+
+	cout << fixed << setprecision(1) << setw(12) << "new" << setw(12) << "delete" << setw(12) << "pool" << setw(12) << "huge pool" << setw(12) << "recycle" << endl;
+	cout << setw(12) << heap / 1000 << setw(12) << free / 1000 << setw(12) << arena / 1000 << setw(12) << huge / 1000 << setw(12) << recycle / 1000 << endl;
+	cout << "huge pages: " << (huge_pages ? "granted" : "refused") << endl << endl;
+
+	delete pool;
+	delete[] machines;
+	delete[] rams;
+	delete[] cpus;
+}
+
+// one program run Lockstep::Width times with different data, Processor::Run() on each machine
+// against all of them in lockstep, results in millions of instructions per second
+void BenchmarkLockstep()
+{
+	const int	iterations = 20;
+	const int	width = Lockstep::Width;
+	// 256 * 256 INX loop, every lane does exactly the same
+	const auto	uniform = "A0 00 A2 00 E8 D0 FD C8 D0 F8 00"_6502;
+	// shift and add multiplication repeated 256 times, the lanes split on BCC
+	const auto	divergent = "A0 00 A5 10 85 15 A9 00 85 13 A2 08 46 15 90 03 18 65 11 6A 66 13 CA D0 F3 C8 D0 E6 00"_6502;
+	Pool		pool(width);
+	Machine		*machines[width];
+	Lockstep	lanes;
+
+	for (int i = 0; i < width; i++)
+	{
+		machines[i] = pool.Acquire();
+		machines[i]->CPU.EndOnBreak = true;
+		lanes.Attach(i, &machines[i]->RAM);
+	}
+	lanes.EndOnBreak = true;
+
+	auto start = [&](int Lane) {
+		Processor &cpu = machines[Lane]->CPU;
+
+		cpu.PC = 0x0400;
+		cpu.Clock = 0;
+		machines[Lane]->RAM[0x10] = (byte)(Lane * 37);
+		machines[Lane]->RAM[0x11] = (byte)(Lane * 11);
+	};
+
+	cout << "lockstep execution of " << width << " machines (MIPS)" << endl;
+	cout << fixed << setprecision(1) << setw(12) << "program" << setw(12) << "scalar" << setw(12) << "lockstep" << setw(12) << "lanes" << endl;
+
+	for (int program = 0; program < 2; program++)
+	{
+		uint64_t instructions = 0;
+
+		for (int i = 0; i < width; i++)
+		{
+			if (program == 0)
+				machines[i]->RAM.Write(0x0400, uniform);
+			else
+				machines[i]->RAM.Write(0x0400, divergent);
+		}
+
+		double scalar = Measure(iterations, [&]() {
+			for (int i = 0; i < width; i++)
+			{
+				start(i);
+				machines[i]->CPU.Run(1 << 30);
+			}
+		});
+		double lockstep = Measure(iterations, [&]() {
+			lanes.Groups = 0;
+			lanes.Instructions = 0;
+			for (int i = 0; i < width; i++)
+			{
+				start(i);
+				lanes.Import(i, machines[i]->CPU);
+			}
+			lanes.Run(1 << 30);
+			instructions = lanes.Instructions;
+		});
+
+		cout << setw(12) << (program == 0 ? "uniform" : "divergent") << setw(12) << instructions / scalar << setw(12) << instructions / lockstep
+			<< setw(12) << (double)lanes.Instructions / lanes.Groups << endl;
+	}
+	cout << endl;
+}
+
+// 1000 machines of which 50 do some work while the others wait in JMP *
+// Step() on every machine in turn against the scheduler with different quanta,
+// in millions of cycles run by the busy machines per second
+void BenchmarkScheduler()
+{
+	const int	count = 1000;
+	const int	busy = 50;
+	const int	cycles = 20000000;
+	Pool		pool(count);
+	Machine		*machines[count];
+
+	for (int i = 0; i < count; i++)
+	{
+		machines[i] = pool.Acquire();
+		// INC $0200, JMP $0400 or JMP *
+		if (i % (count / busy) == 0)
+			machines[i]->RAM.Write(0x0400, "EE 00 02 4C 00 04"_6502);
+		else
+			machines[i]->RAM.Write(0x0400, "4C 00 04"_6502);
+	}
+
+	auto work = [&]() {
+		uint64_t total = 0;
+
+		for (int i = 0; i < count; i += count / busy)
+			total += (unsigned)machines[i]->CPU.Clock;
+		return total;
+	};
+	auto restart = [&]() {
+		for (int i = 0; i < count; i++)
+		{
+			machines[i]->CPU.PC = 0x0400;
+			machines[i]->CPU.Clock = 0;
+		}
+	};
+
+	cout << "scheduling " << count << " machines, " << busy << " busy (busy Mcycles per second)" << endl;
+	cout << fixed << setprecision(1) << setw(12) << "quantum" << setw(12) << "Mcycles/s" << setw(12) << "fairness" << setw(12) << "max us" << endl;
+
+	restart();
+	double naive = Measure(1, [&]() {
+		while (work() < (uint64_t)cycles)
+		{
+			for (int i = 0; i < count; i++)
+				machines[i]->CPU.Step();
+		}
+	});
+	cout << setw(12) << "Step()" << setw(12) << work() / naive << endl;
+
+	for (int quantum : {100, 1000, 10000})
+	{
+		Scheduler scheduler(quantum);
+		double latency = 0;
+
+		restart();
+		for (int i = 0; i < count; i++)
+			scheduler.Add(machines[i]);
+		double elapsed = Measure(1, [&]() {
+			while (work() < (uint64_t)cycles)
+				scheduler.Step();
+		});
+		for (int i = 0; i < count; i += count / busy)
+		{
+			if (scheduler.Statistics(i).MaxLatency > latency)
+				latency = scheduler.Statistics(i).MaxLatency;
+		}
+		cout << setw(12) << quantum << setw(12) << work() / elapsed << setw(12) << setprecision(3) << scheduler.Fairness()
+			<< setw(12) << setprecision(1) << latency << endl;
+	}
+	cout << endl;
+}
+
+// round trip of a command through the run thread (cStep answered by ePaused) and speed of a
+// machine on its own thread while the host keeps patching its memory
+void BenchmarkRunThread()
+{
+	const int	iterations = 20000;
+	const int	cycles = 50000000;
+	Pool		pool(1);
+	Machine		*machine = pool.Acquire();
+	Event		event;
+
+	machine->RAM.Write(0x0400, "EE 00 02 4C 00 04"_6502);	// INC $0200, JMP $0400
+	machine->CPU.PC = 0x0400;
+
+	double local = Measure(1, [&]() { machine->CPU.Run(cycles); });
+
+	RunThread *thread = new RunThread(machine);
+	double step = Measure(iterations, [&]() {
+		thread->Send(cStep, 0);
+		while (!thread->Poll(event))
+			std::this_thread::yield();
+	});
+
+	const byte patch[4] = {1, 2, 3, 4};
+	int patches = 0;
+	double threaded = Measure(1, [&]() {
+		thread->Send(cRun, cycles);
+		while (!thread->Poll(event))
+		{
+			thread->Patch(0x0300, patch, sizeof(patch));
+			patches++;
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+	delete thread;
+
+	cout << "run thread" << endl;
+	cout << fixed << setprecision(1) << setw(12) << "round trip" << setw(12) << "same thread" << setw(12) << "run thread" << setw(12) << "patches" << endl;
+	cout << setw(10) << step << "us" << setw(12) << cycles / local << setw(12) << cycles / threaded << setw(12) << patches << endl;
+	cout << "(Mcycles per second)" << endl << endl;
+}
+
+// short runs through the service socket: one request at a time, then batches of pipelined requests
+void BenchmarkService()
+{
+	const char *path = "emu6502bench.sock";
+	const int single = 2000;
+	const int batches = 20;
+	const int batch = 1000;
+	Service service(1);
+	std::atomic<bool> running(true);
+	ServiceClient client;
+	ServiceRequest request = {};
+	ServiceResponse response;
+	vector<byte> message;
+
+	// a 4kb image, 256 cycles of work and 16 bytes read back
+	request.Image.assign(0x1000, 0xEA);
+	request.Budget = 256;
+	request.Entry = 0x0000;
+	request.Stop = -1;
+	request.Outputs.push_back({0x0200, vector<byte>(16)});
+
+	if (!service.Listen(path))
+	{
+		cout << "cannot listen on " << path << endl << endl;
+		return;
+	}
+	thread server([&]() { service.Serve(running); });
+
+	client.Connect(path);
+	Encode(request, message);
+	client.Send(message);
+	client.Receive(response);
+
+	// the image is cached now, later requests only send its hash
+	request.Image.clear();
+	message.clear();
+	Encode(request, message);
+
+	double latency = Measure(single, [&]() {
+		client.Send(message);
+		client.Receive(response);
+	});
+
+	vector<byte> pipelined;
+
+	for (int i = 0; i < batch; i++)
+		pipelined.insert(pipelined.end(), message.begin(), message.end());
+	double pipeline = Measure(batches, [&]() {
+		client.Send(pipelined);
+		for (int i = 0; i < batch; i++)
+			client.Receive(response);
+	});
+
+	running = false;
+	server.join();
+	remove(path);
+
+	cout << "service" << endl;
+	cout << fixed << setprecision(1) << setw(14) << "round trip" << setw(20) << "one at a time" << setw(20) << "pipelined" << endl;
+	cout << setw(12) << latency << "us" << setw(14) << 1e6 / latency << " run/s" << setw(14) << batch * 1e6 / pipeline << " run/s" << endl << endl;
+}
+
+// a machine exported through shared memory against a private one, and the cost of reading its registers
+void BenchmarkShared()
+{
+	const int cycles = 50000000;
+	Pool pool(1);
+	Machine *local = pool.Acquire();
+	SharedMachine shared("/emu6502bench");
+	SharedView view;
+	SharedRegisters registers;
+
+	local->RAM.Write(0x0400, "EE 00 02 4C 00 04"_6502);	// INC $0200, JMP $0400
+	local->CPU.PC = 0x0400;
+	shared.RAM.Write(0x0400, "EE 00 02 4C 00 04"_6502);
+	shared.CPU.PC = 0x0400;
+	view.Open("/emu6502bench");
+
+	double privateRun = Measure(1, [&]() { local->CPU.Run(cycles); });
+	double sharedRun = Measure(1, [&]() { shared.Run(cycles, 10000); });
+	double read = Measure(1000000, [&]() { view.Read(registers); });
+
+	cout << "shared memory export" << endl;
+	cout << fixed << setprecision(1) << setw(12) << "private" << setw(12) << "shared" << setw(16) << "register read" << endl;
+	cout << setw(12) << cycles / privateRun << setw(12) << cycles / sharedRun << setw(14) << read * 1000 << "ns" << endl;
+	cout << "(Mcycles per second, published every 10000 cycles)" << endl << endl;
+}
+
+// four CPUs sharing a page, one host thread each against all of them on one thread
+void BenchmarkBoard()
+{
+	const int cpus = 4;
+	const uint64_t cycles = 10000000;
+	const int quanta[] = {100, 1000, 10000};
+
+	cout << "board of " << cpus << " CPUs (" << thread::hardware_concurrency() << " hardware threads)" << endl;
+	cout << setw(10) << "quantum" << setw(14) << "one thread" << setw(14) << "threads" << endl;
+	for (int quantum : quanta)
+	{
+		double results[2];
+
+		for (int threads = 0; threads < 2; threads++)
+		{
+			Board board(cpus, quantum, threads != 0);
+
+			for (int i = 0; i < cpus; i++)
+			{
+				// INC $0200, INC $0300, JMP $0400
+				board.Core(i).RAM.Write(0x0400, "EE 00 02 EE 00 03 4C 00 04"_6502);
+				board.Core(i).CPU.PC = 0x0400;
+			}
+			board.Share(0x02);
+			results[threads] = Measure(1, [&]() { board.Run(cycles); });
+		}
+
+		cout << setw(10) << quantum << fixed << setprecision(1) << setw(14) << cpus * cycles / results[0] << setw(14) << cpus * cycles / results[1] << endl;
+	}
+	cout << "(Mcycles per second, all CPUs)" << endl << endl;
+}
+
+// copies 4kb with a LDA ($00),Y / STA ($02),Y loop, then with the DMA controller
+void BenchmarkDma()
+{
+	const int iterations = 2000;
+	const char *names[] = {"6502 loop", "DMA"};
+	Memory memory;
+	Processor cpu(&memory);
+	Dma dma(cpu, memory, 0xD0);
+
+	for (int i = 0; i < 0x1000; i++)
+		memory[(word)(0x1000 + i)] = (byte)i;
+	// LDY #0, LDX #$10, LDA ($00),Y, STA ($02),Y, INY, BNE -7, INC $01, INC $03, DEX, BNE -14, BRK
+	memory.Write(0x0400, "A0 00 A2 10 B1 00 91 02 C8 D0 F9 E6 01 E6 03 CA D0 F2"_6502, true);
+	// source $1000, destination $2000, length $1000, start, BRK
+	memory.Write(0x0500, "A9 10 8D 01 D0 A9 20 8D 03 D0 A9 10 8D 05 D0 A9 01 8D 06 D0"_6502, true);
+	cpu.EndOnBreak = true;
+
+	cout << "4kb block copy" << endl;
+	cout << setw(10) << "" << setw(12) << "cycles" << setw(12) << "us" << endl;
+	for (int method = 0; method < 2; method++)
+	{
+		int cycles = 0;
+		double time = Measure(iterations, [&]() {
+			memory[0x0000] = 0x00;
+			memory[0x0001] = 0x10;
+			memory[0x0002] = 0x00;
+			memory[0x0003] = 0x20;
+			cpu.Clock = 0;
+			cpu.PC = method == 0 ? 0x0400 : 0x0500;
+			cpu.Run(1000000);
+			cycles = cpu.Clock;
+		});
+
+		cout << setw(10) << names[method] << setw(12) << cycles << fixed << setprecision(2) << setw(12) << time << endl;
+	}
+	cout << endl;
+}
+
+// 1mb image shared by several devices, 64 sectors per command
+void BenchmarkBlock()
+{
+	const char *filename = "emu6502bench.img";
+	const int devices = 8;
+	const int iterations = 1000;
+
+	WriteImage(filename, 0x100000);
+	{
+		MappedFile image(filename);
+		vector<Memory *> memories;
+		vector<Processor *> cpus;
+		vector<BlockDevice *> disks;
+
+		for (int i = 0; i < devices; i++)
+		{
+			memories.push_back(new Memory());
+			cpus.push_back(new Processor(memories.back()));
+			disks.push_back(new BlockDevice(*cpus.back(), *memories.back(), 0xD1, image));
+		}
+
+		cout << devices << " block devices on one " << image.Length() / 1024 << "kb image" << endl;
+		cout << setw(10) << "" << setw(12) << "MB/s" << endl;
+		for (byte command : {bcRead, bcWrite})
+		{
+			int sector = 0;
+			double time = Measure(iterations, [&]() {
+				for (int i = 0; i < devices; i++)
+				{
+					const byte registers[6] = {(byte)sector, (byte)(sector >> 8), 0x00, 0x10, 64, command};
+
+					memories[i]->CopyIn(0xD100, registers, sizeof(registers));
+				}
+				sector = (sector + 64) % disks[0]->Sectors();
+			});
+
+			cout << setw(10) << (command == bcRead ? "read" : "write") << fixed << setprecision(1) << setw(12) << devices * 64 * BlockDevice::SectorSize / time << endl;
+		}
+
+		for (int i = 0; i < devices; i++)
+		{
+			delete disks[i];
+			delete cpus[i];
+			delete memories[i];
+		}
+	}
+	remove(filename);
+	cout << endl;
+}
+
+// a guest updating its status screen: no screen, a screen nobody looks at, a terminal refreshed at 60Hz
+void BenchmarkScreen()
+{
+	const int cycles = 20000000;
+	const int refresh = 1000000 / 60;
+	const char *names[] = {"no screen", "headless", "60Hz"};
+
+	cout << "text screen" << endl;
+	cout << setw(10) << "" << setw(12) << "Mcycles/s" << setw(14) << "bytes/frame" << endl;
+	for (int mode = 0; mode < 3; mode++)
+	{
+		Memory memory;
+		Processor cpu(&memory);
+		TextScreen *screen = mode > 0 ? new TextScreen(memory, 0x8000) : nullptr;
+		char buffer[TextScreen::RenderCapacity];
+		size_t output = 0;
+		int frames = 0;
+
+		// INC $8000,X, INX, JMP $0400
+		memory.Write(0x0400, "FE 00 80 E8 4C 00 04"_6502);
+		cpu.PC = 0x0400;
+		double time = Measure(1, [&]() {
+			for (int run = 0; run < cycles / refresh; run++)
+			{
+				cpu.Run(refresh);
+				if (mode == 2)
+				{
+					output += screen->Render(buffer, sizeof(buffer));
+					frames++;
+				}
+			}
+		});
+
+		cout << setw(10) << names[mode] << fixed << setprecision(1) << setw(12) << cycles / time << setw(14) << (frames ? output / frames : 0) << endl;
+		delete screen;
+	}
+	cout << endl;
+}
+
+// 16 x 16 multiplication: shift and add routine against the math device
+void BenchmarkMath()
+{
+	const int iterations = 100000;
+	const char *names[] = {"6502", "device"};
+	Memory memory;
+	Processor cpu(&memory);
+	MathDevice math(cpu, memory, 0xD2);
+
+	// $00-$01 x $02-$03 into $04-$07
+	// LDA #0, STA $06, STA $07, LDX #16, loop: LSR $01, ROR $00, BCC skip, LDA $06, CLC, ADC $02, STA $06,
+	// LDA $07, ADC $03, STA $07, skip: ROR $07, ROR $06, ROR $05, ROR $04, DEX, BNE loop, BRK
+	memory.Write(0x0400, "A9 00 85 06 85 07 A2 10 46 01 66 00 90 0D A5 06 18 65 02 85 06 A5 07 65 03 85 07 "
+		"66 07 66 06 66 05 66 04 CA D0 E2"_6502, true);
+	// same operands through the device, product into $04-$07
+	memory.Write(0x0500, "A5 00 8D 00 D2 A5 01 8D 01 D2 A5 02 8D 04 D2 A5 03 8D 05 D2 A9 01 8D 06 D2 "
+		"AD 08 D2 85 04 AD 09 D2 85 05 AD 0A D2 85 06 AD 0B D2 85 07"_6502, true);
+	cpu.EndOnBreak = true;
+
+	cout << "16 x 16 multiplication" << endl;
+	cout << setw(10) << "" << setw(12) << "cycles" << setw(14) << "Mmul/s" << endl;
+	for (int method = 0; method < 2; method++)
+	{
+		int cycles = 0;
+		uint32_t check = 0;
+		word operand = 1;
+		double time = Measure(1, [&]() {
+			for (int i = 0; i < iterations; i++)
+			{
+				operand = (word)(operand * 31421 + 6927);
+				memory[0x0000] = (byte)operand;
+				memory[0x0001] = (byte)(operand >> 8);
+				memory[0x0002] = (byte)(operand >> 3);
+				memory[0x0003] = (byte)(operand >> 11);
+				cpu.Clock = 0;
+				cpu.PC = method == 0 ? 0x0400 : 0x0500;
+				cpu.Run(10000);
+				cycles = cpu.Clock;
+				check += memory[0x0004] | memory[0x0005] << 8 | memory[0x0006] << 16 | memory[0x0007] << 24;
+			}
+		});
+
+		cout << setw(10) << names[method] << setw(12) << cycles << fixed << setprecision(2) << setw(14) << iterations / time
+			<< "  (checksum " << hex << check << dec << ")" << endl;
+	}
+	cout << endl;
+}
+
+// native version of the multiplication routine of BenchmarkHooks()
+static bool MultiplyHook(Processor &CPU, Memory &RAM)
+{
+	uint32_t product = (RAM[0x0000] | RAM[0x0001] << 8) * (RAM[0x0002] | RAM[0x0003] << 8);
+	const byte result[8] = {0, 0, 0, 0, (byte)product, (byte)(product >> 8), (byte)(product >> 16), (byte)(product >> 24)};
+
+	// the routine shifts the multiplier out and leaves X at 0
+	RAM.CopyIn(0x0000, result, 2);
+	RAM.CopyIn(0x0004, result + 4, 4);
+	CPU.X = 0;
+	return true;
+}
+
+// JSR to the shift and add multiplication of BenchmarkMath(), with and without a hook
+void BenchmarkHooks()
+{
+	const int iterations = 100000;
+	const char *names[] = {"6502", "hook"};
+	Memory memory;
+	Processor cpu(&memory);
+	HookTable hooks;
+
+	memory.Write(0x0600, "A9 00 85 06 85 07 A2 10 46 01 66 00 90 0D A5 06 18 65 02 85 06 A5 07 65 03 85 07 "
+		"66 07 66 06 66 05 66 04 CA D0 E2 60"_6502);
+	// JSR $0600, BRK
+	memory.Write(0x0400, "20 00 06"_6502, true);
+	// about what the routine takes
+	hooks.Add(0x0600, MultiplyHook, 790);
+	cpu.EndOnBreak = true;
+
+	cout << "16 x 16 multiplication subroutine" << endl;
+	cout << setw(10) << "" << setw(12) << "cycles" << setw(14) << "Mcalls/s" << endl;
+	for (int method = 0; method < 2; method++)
+	{
+		int cycles = 0;
+		uint32_t check = 0;
+		word operand = 1;
+
+		cpu.Hooks = method == 0 ? nullptr : &hooks;
+		double time = Measure(1, [&]() {
+			for (int i = 0; i < iterations; i++)
+			{
+				operand = (word)(operand * 31421 + 6927);
+				memory[0x0000] = (byte)operand;
+				memory[0x0001] = (byte)(operand >> 8);
+				memory[0x0002] = (byte)(operand >> 3);
+				memory[0x0003] = (byte)(operand >> 11);
+				cpu.Clock = 0;
+				cpu.S = 0xFF;
+				cpu.PC = 0x0400;
+				cpu.Run(10000);
+				cycles = cpu.Clock;
+				check += memory[0x0004] | memory[0x0005] << 8 | memory[0x0006] << 16 | memory[0x0007] << 24;
+			}
+		});
+
+		cout << setw(10) << names[method] << setw(12) << cycles << fixed << setprecision(2) << setw(14) << iterations / time
+			<< "  (checksum " << hex << check << dec << ")" << endl;
+	}
+	cout << endl;
+}
+
+int main(int argc, char **argv)
+{
+	const char *name = argc > 1 ? argv[1] : nullptr;
+
+	if (!name || strcmp(name, "load") == 0)
+		BenchmarkBinaryLoad();
+	if (!name || strcmp(name, "hex") == 0)
+		BenchmarkHexLoad();
+	if (!name || strcmp(name, "dump") == 0)
+		BenchmarkDump();
+	if (!name || strcmp(name, "pool") == 0)
+		BenchmarkPool();
+	if (!name || strcmp(name, "lockstep") == 0)
+		BenchmarkLockstep();
+	if (!name || strcmp(name, "scheduler") == 0)
+		BenchmarkScheduler();
+	if (!name || strcmp(name, "runthread") == 0)
+		BenchmarkRunThread();
+	if (!name || strcmp(name, "service") == 0)
+		BenchmarkService();
+	if (!name || strcmp(name, "shared") == 0)
+		BenchmarkShared();
+	if (!name || strcmp(name, "board") == 0)
+		BenchmarkBoard();
+	if (!name || strcmp(name, "dma") == 0)
+		BenchmarkDma();
+	if (!name || strcmp(name, "block") == 0)
+		BenchmarkBlock();
+	if (!name || strcmp(name, "screen") == 0)
+		BenchmarkScreen();
+	if (!name || strcmp(name, "math") == 0)
+		BenchmarkMath();
+	if (!name || strcmp(name, "hooks") == 0)
+		BenchmarkHooks();
+
+	return 0;
+}
\ No newline at end of file
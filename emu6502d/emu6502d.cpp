@@ -0,0 +1,69 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+// emulator service (see service.h), runs until SIGINT or SIGTERM
+// usage: emu6502d socket [instances] [cached images]
+
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <atomic>
+#include <thread>
+#include "service.h"
+
+static std::atomic<bool> Running(true);
+
+static void Stop(int)
+{
+	Running = false;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: emu6502d socket [instances] [cached images]\n");
+		return 1;
+	}
+
+	int instances = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+	Service service(instances > 0 ? instances : 1, argc > 3 ? atoi(argv[3]) : 256);
+
+	if (!service.IsOpen())
+	{
+		fprintf(stderr, "cannot allocate %d machines\n", instances);
+		return 1;
+	}
+	if (!service.Listen(argv[1]))
+	{
+		fprintf(stderr, "cannot listen on \"%s\" (in use or not a socket)\n", argv[1]);
+		return 1;
+	}
+
+	signal(SIGINT, Stop);
+	signal(SIGTERM, Stop);
+	fprintf(stderr, "listening on %s with %d machines\n", argv[1], instances);
+	service.Serve(Running);
+
+	fprintf(stderr, "%llu connections, %llu requests, %llu cycles, image cache %llu hits %llu misses\n",
+		(unsigned long long)service.Statistics.Connections, (unsigned long long)service.Statistics.Requests,
+		(unsigned long long)service.Statistics.Cycles, (unsigned long long)service.Statistics.CacheHits,
+		(unsigned long long)service.Statistics.CacheMisses);
+
+	return 0;
+}
\ No newline at end of file
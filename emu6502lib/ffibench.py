@@ -0,0 +1,93 @@
+# CPU emulator (https://github.com/ndesprez/cpu_emulator)
+# Copyright(C) 2021 Nicolas Desprez, GPL v3 or later (see LICENSE)
+#
+# cost of crossing the ctypes boundary into libemu6502 for a given amount of work per call
+# usage: python3 ffibench.py path/to/libemu6502.so (or libemu6502.dll)
+
+import ctypes
+import sys
+import time
+
+
+class Registers(ctypes.Structure):
+	_fields_ = [("Clock", ctypes.c_int32), ("PC", ctypes.c_uint16),
+				("A", ctypes.c_uint8), ("X", ctypes.c_uint8), ("Y", ctypes.c_uint8),
+				("S", ctypes.c_uint8), ("P", ctypes.c_uint8), ("Reserved", ctypes.c_uint8)]
+
+
+def load(path):
+	lib = ctypes.CDLL(path)
+	lib.EmuCreatePool.restype = ctypes.c_void_p
+	lib.EmuCreatePool.argtypes = [ctypes.c_uint32]
+	lib.EmuDestroyPool.argtypes = [ctypes.c_void_p]
+	lib.EmuAcquire.restype = ctypes.c_void_p
+	lib.EmuAcquire.argtypes = [ctypes.c_void_p]
+	lib.EmuLoadBinary.argtypes = [ctypes.c_void_p, ctypes.c_uint16, ctypes.c_char_p, ctypes.c_size_t]
+	lib.EmuSetRegisters.argtypes = [ctypes.c_void_p, ctypes.POINTER(Registers)]
+	lib.EmuRun.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.POINTER(Registers)]
+	lib.EmuRunMany.restype = ctypes.c_int64
+	lib.EmuRunMany.argtypes = [ctypes.POINTER(ctypes.c_void_p), ctypes.c_size_t, ctypes.c_int32,
+							   ctypes.POINTER(ctypes.c_int32), ctypes.POINTER(Registers)]
+	lib.EmuRead.argtypes = [ctypes.c_void_p, ctypes.c_uint16, ctypes.c_char_p, ctypes.c_size_t]
+	return lib
+
+
+def main():
+	lib = load(sys.argv[1] if len(sys.argv) > 1 else "./libemu6502.so")
+	if lib.EmuAbiVersion() != 1:
+		sys.exit("unexpected ABI version")
+
+	count = 16
+	pool = lib.EmuCreatePool(count)
+	machines = (ctypes.c_void_p * count)(*[lib.EmuAcquire(pool) for _ in range(count)])
+	loop = bytes([0xEE, 0x00, 0x02, 0x4C, 0x00, 0x04])	# INC $0200, JMP $0400
+	for machine in machines:
+		lib.EmuLoadBinary(machine, 0x0400, loop, len(loop))
+		registers = Registers()
+		lib.EmuRun(machine, 0, ctypes.byref(registers))
+		registers.PC = 0x0400
+		lib.EmuSetRegisters(machine, ctypes.byref(registers))
+
+	total = 20000000
+	registers = Registers()
+	print("%12s %12s %14s %18s" % ("cycles/call", "calls", "Mcycles/s", "us overhead/Mc"))
+	baseline = None
+	for cycles in (20000000, 1000000, 100000, 10000, 1000, 100, 10):
+		calls = max(1, min(total // cycles, 200000))
+		start = time.perf_counter()
+		for _ in range(calls):
+			lib.EmuRun(machines[0], cycles, ctypes.byref(registers))
+		elapsed = time.perf_counter() - start
+		per_million = elapsed / (calls * cycles) * 1e12		# microseconds per million cycles
+		if baseline is None:
+			baseline = per_million
+		print("%12d %12d %14.1f %18.1f" % (cycles, calls, calls * cycles / elapsed / 1e6, per_million - baseline))
+
+	# one crossing for all the machines
+	reasons = (ctypes.c_int32 * count)()
+	states = (Registers * count)()
+	cycles = 100000
+	start = time.perf_counter()
+	ran = 0
+	for _ in range(20):
+		ran += lib.EmuRunMany(machines, count, cycles, reasons, states)
+	elapsed = time.perf_counter() - start
+	print("EmuRunMany: %d machines x %d cycles per call, %.1f Mcycles/s" % (count, cycles, ran / elapsed / 1e6))
+
+	# a 4kb block in one call against one call per byte
+	buffer = ctypes.create_string_buffer(4096)
+	start = time.perf_counter()
+	for _ in range(1000):
+		lib.EmuRead(machines[0], 0, buffer, 4096)
+	block = (time.perf_counter() - start) / 1000
+	start = time.perf_counter()
+	for address in range(4096):
+		lib.EmuRead(machines[0], address, buffer, 1)
+	single = time.perf_counter() - start
+	print("reading 4kb: %.1f us in one call, %.1f us one byte per call" % (block * 1e6, single * 1e6))
+
+	lib.EmuDestroyPool(pool)
+
+
+if __name__ == "__main__":
+	main()
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+CPU emulator (https://github.com/ndesprez/cpu_emulator)
+Copyright(C) 2021 Nicolas Desprez
+
+This program is free software : you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+
+// runs the jobs of a manifest (see jobs.h) on every core and writes one JSON line per job
+// usage: emu6502run manifest [threads]
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "jobs.h"
+
+using std::vector;
+using namespace std::chrono;
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: emu6502run manifest [threads]\n");
+		return 1;
+	}
+
+	vector<Job> jobs;
+	LoadError error;
+
+	if (!ReadManifest(argv[1], jobs, &error))
+	{
+		fprintf(stderr, "cannot read manifest \"%s\"", argv[1]);
+		if (error.Line > 0)
+			fprintf(stderr, " (line %d, column %d)", error.Line, error.Column);
+		fprintf(stderr, ": %s\n", error.Message);
+		return 1;
+	}
+
+	JobRunner runner(argc > 2 ? atoi(argv[2]) : 0);
+	auto start = steady_clock::now();
+
+	runner.Run(jobs, [](const char *Line, size_t Length) { fwrite(Line, 1, Length, stdout); });
+	fflush(stdout);
+
+	double seconds = duration<double>(steady_clock::now() - start).count();
+
+	fprintf(stderr, "%zu jobs in %.3f s, %.0f jobs/s, %.1f MHz\n", jobs.size(), seconds, jobs.size() / seconds, runner.Cycles / seconds / 1e6);
+
+	return 0;
+}
\ No newline at end of file
@@ -17,9 +17,24 @@ along with this progRAM->If not, see < http://www.gnu.org/licenses/>.
 */
 
 #include "pch.h"
+#include <cstring>
 #include "CppUnitTest.h"
 #include "processor.h"
 #include "memory.h"
+#include "pool.h"
+#include "jobs.h"
+#include "lockstep.h"
+#include "scheduler.h"
+#include "runthread.h"
+#include "capi.h"
+#include "service.h"
+#include "shared.h"
+#include "board.h"
+#include "dma.h"
+#include "block.h"
+#include "screen.h"
+#include "mathdevice.h"
+#include "profiler.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -144,7 +159,7 @@ namespace emu6502test
 		// start the test with PHP so we can pull (i.e. reset) the status
 		// register just before we execute the instruction we're testing
 		if(StarWithPHP)
-			RAM->Write("08");
+			RAM->Write("08"_6502);
 	}
 
 	void _method_cleanup()
@@ -168,7 +183,7 @@ namespace emu6502test
 
 		TEST_METHOD(LDA_IMM)
 		{
-			RAM->Write("A9 D5");
+			RAM->Write("A9 D5"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDA", sImmediate);
 			Assert::AreEqual(0xD5, (int)CPU->A);
@@ -179,8 +194,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDA_ABS)
 		{
-			RAM->Write("AD 00 20");
-			RAM->Write(0x2000, "7A");
+			RAM->Write("AD 00 20"_6502);
+			RAM->Write(0x2000, "7A"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDA", sAbsolute);
 			Assert::AreEqual(0x7A, (int)CPU->A);
@@ -191,8 +206,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDA_ABSX)
 		{
-			RAM->Write("A2 20 28 BD 00 20");
-			RAM->Write(0x2020, "DB");
+			RAM->Write("A2 20 28 BD 00 20"_6502);
+			RAM->Write(0x2020, "DB"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDA", sAbsoluteX);
 			Assert::AreEqual(0xDB, (int)CPU->A);
@@ -203,8 +218,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDA_ABSY)
 		{
-			RAM->Write("A0 30 28 B9 00 20");
-			RAM->Write(0x2030, "DC");
+			RAM->Write("A0 30 28 B9 00 20"_6502);
+			RAM->Write(0x2030, "DC"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDA", sAbsoluteY);
 			Assert::AreEqual(0xDC, (int)CPU->A);
@@ -215,8 +230,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDA_ZPG)
 		{
-			RAM->Write("A5 40");
-			RAM->Write(0x0040, "DD");
+			RAM->Write("A5 40"_6502);
+			RAM->Write(0x0040, "DD"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDA", sZeroPage);
 			Assert::AreEqual(0xDD, (int)CPU->A);
@@ -227,8 +242,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDA_ZPGX)
 		{
-			RAM->Write("A2 10 28 B5 40");
-			RAM->Write(0x0050, "DE");
+			RAM->Write("A2 10 28 B5 40"_6502);
+			RAM->Write(0x0050, "DE"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDA", sZeroPageX);
 			Assert::AreEqual(0xDE, (int)CPU->A);
@@ -239,9 +254,9 @@ namespace emu6502test
 
 		TEST_METHOD(LDA_XIND)
 		{
-			RAM->Write("A2 20 28 A1 20");
-			RAM->Write(0x0040, "00 30");
-			RAM->Write(0x3000, "DF");
+			RAM->Write("A2 20 28 A1 20"_6502);
+			RAM->Write(0x0040, "00 30"_6502);
+			RAM->Write(0x3000, "DF"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDA", sXIndirect);
 			Assert::AreEqual(0xDF, (int)CPU->A);
@@ -252,9 +267,9 @@ namespace emu6502test
 
 		TEST_METHOD(LDA_INDY)
 		{
-			RAM->Write("A0 30 28 B1 20");
-			RAM->Write(0x0020, "00 40");
-			RAM->Write(0x4030, "E0");
+			RAM->Write("A0 30 28 B1 20"_6502);
+			RAM->Write(0x0020, "00 40"_6502);
+			RAM->Write(0x4030, "E0"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDA", sIndirectY);
 			Assert::AreEqual(0xE0, (int)CPU->A);
@@ -265,7 +280,7 @@ namespace emu6502test
 
 		TEST_METHOD(LDX_IMM)
 		{
-			RAM->Write("A2 C7");
+			RAM->Write("A2 C7"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDX", sImmediate);
 			Assert::AreEqual(0xC7, (int)CPU->X);
@@ -276,8 +291,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDX_ABS)
 		{
-			RAM->Write("AE 00 20");
-			RAM->Write(0x2000, "C8");
+			RAM->Write("AE 00 20"_6502);
+			RAM->Write(0x2000, "C8"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDX", sAbsolute);
 			Assert::AreEqual(0xC8, (int)CPU->X);
@@ -288,8 +303,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDX_ABSY)
 		{
-			RAM->Write("A0 30 28 BE 00 20");
-			RAM->Write(0x2030, "C9");
+			RAM->Write("A0 30 28 BE 00 20"_6502);
+			RAM->Write(0x2030, "C9"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDX", sAbsoluteY);
 			Assert::AreEqual(0xC9, (int)CPU->X);
@@ -299,8 +314,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDX_ZPG)
 		{
-			RAM->Write("A6 40");
-			RAM->Write(0x0040, "DE");
+			RAM->Write("A6 40"_6502);
+			RAM->Write(0x0040, "DE"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDX", sZeroPage);
 			Assert::AreEqual(0xDE, (int)CPU->X);
@@ -311,8 +326,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDX_ZPGY)
 		{
-			RAM->Write("A0 91 28 B6 80");
-			RAM->Write(0x0011, "DF");
+			RAM->Write("A0 91 28 B6 80"_6502);
+			RAM->Write(0x0011, "DF"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDX", sZeroPageY);
 			Assert::AreEqual(0xDF, (int)CPU->X);
@@ -323,7 +338,7 @@ namespace emu6502test
 
 		TEST_METHOD(LDY_IMM)
 		{
-			RAM->Write("A0 91");
+			RAM->Write("A0 91"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDY", sImmediate);
 			Assert::AreEqual(0x91, (int)CPU->Y);
@@ -334,8 +349,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDY_ABS)
 		{
-			RAM->Write("AC 00 20");
-			RAM->Write(0x2000, "92");
+			RAM->Write("AC 00 20"_6502);
+			RAM->Write(0x2000, "92"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDY", sAbsolute);
 			Assert::AreEqual(0x92, (int)CPU->Y);
@@ -346,8 +361,8 @@ namespace emu6502test
 		
 		TEST_METHOD(LDY_ABSX)
 		{
-			RAM->Write("A2 30 28 BC 00 20");
-			RAM->Write(0x2030, "CA");
+			RAM->Write("A2 30 28 BC 00 20"_6502);
+			RAM->Write(0x2030, "CA"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDY", sAbsoluteX);
 			Assert::AreEqual(0xCA, (int)CPU->Y);
@@ -358,8 +373,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDY_ZPG)
 		{
-			RAM->Write("A4 50");
-			RAM->Write(0x0050, "DF");
+			RAM->Write("A4 50"_6502);
+			RAM->Write(0x0050, "DF"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDY", sZeroPage);
 			Assert::AreEqual(0xDF, (int)CPU->Y);
@@ -370,8 +385,8 @@ namespace emu6502test
 
 		TEST_METHOD(LDY_ZPGX)
 		{
-			RAM->Write("A2 20 28 B4 80");
-			RAM->Write(0x00A0, "E0");
+			RAM->Write("A2 20 28 B4 80"_6502);
+			RAM->Write(0x00A0, "E0"_6502);
 			CPU->Run();
 			AssertLastInstruction("LDY", sZeroPageX);
 			Assert::AreEqual(0xE0, (int)CPU->Y);
@@ -395,7 +410,7 @@ namespace emu6502test
 
 		TEST_METHOD(STA_ABS)
 		{
-			RAM->Write("A9 D5 28 8D 00 20");
+			RAM->Write("A9 D5 28 8D 00 20"_6502);
 			CPU->Run();
 			AssertLastInstruction("STA", sAbsolute);
 			Assert::AreEqual(0xD5, (int)(*RAM)[0x2000]);
@@ -404,7 +419,7 @@ namespace emu6502test
 
 		TEST_METHOD(STA_ABSX)
 		{
-			RAM->Write("A9 D6 A2 C7 28 9D 00 20");
+			RAM->Write("A9 D6 A2 C7 28 9D 00 20"_6502);
 			CPU->Run();
 			AssertLastInstruction("STA", sAbsoluteX);
 			Assert::AreEqual(0xD6, (int)(*RAM)[0x20C7]);
@@ -413,7 +428,7 @@ namespace emu6502test
 
 		TEST_METHOD(STA_ABSY)
 		{
-			RAM->Write("A9 D7 A0 B7 28 99 00 20");
+			RAM->Write("A9 D7 A0 B7 28 99 00 20"_6502);
 			CPU->Run();
 			AssertLastInstruction("STA", sAbsoluteY);
 			Assert::AreEqual(0xD7, (int)(*RAM)[0x20B7]);
@@ -422,7 +437,7 @@ namespace emu6502test
 
 		TEST_METHOD(STA_ZPG)
 		{
-			RAM->Write("A9 D8 28 85 20");
+			RAM->Write("A9 D8 28 85 20"_6502);
 			CPU->Run();
 			AssertLastInstruction("STA", sZeroPage);
 			Assert::AreEqual(0xD8, (int)(*RAM)[0x0020]);
@@ -431,7 +446,7 @@ namespace emu6502test
 
 		TEST_METHOD(STA_ZPGX)
 		{
-			RAM->Write("A9 D9 A2 10 28 95 20");
+			RAM->Write("A9 D9 A2 10 28 95 20"_6502);
 			CPU->Run();
 			AssertLastInstruction("STA", sZeroPageX);
 			Assert::AreEqual(0xD9, (int)(*RAM)[0x0030]);
@@ -440,8 +455,8 @@ namespace emu6502test
 
 		TEST_METHOD(STA_XIND)
 		{
-			RAM->Write("A9 DA A2 10 28 81 20");
-			RAM->Write(0x0030, "16 20");
+			RAM->Write("A9 DA A2 10 28 81 20"_6502);
+			RAM->Write(0x0030, "16 20"_6502);
 			CPU->Run();
 			AssertLastInstruction("STA", sXIndirect);
 			Assert::AreEqual(0xDA, (int)(*RAM)[0x2016]);
@@ -450,8 +465,8 @@ namespace emu6502test
 
 		TEST_METHOD(STA_INDY)
 		{
-			RAM->Write("A9 DB A0 20 28 91 60");
-			RAM->Write(0x0060, "11 30");
+			RAM->Write("A9 DB A0 20 28 91 60"_6502);
+			RAM->Write(0x0060, "11 30"_6502);
 			CPU->Run();
 			AssertLastInstruction("STA", sIndirectY);
 			Assert::AreEqual(0xDB, (int)(*RAM)[0x3031]);
@@ -460,7 +475,7 @@ namespace emu6502test
 
 		TEST_METHOD(STX_ABS)
 		{
-			RAM->Write("A2 75 28 8E 00 21");
+			RAM->Write("A2 75 28 8E 00 21"_6502);
 			CPU->Run();
 			AssertLastInstruction("STX", sAbsolute);
 			Assert::AreEqual(0x75, (int)(*RAM)[0x2100]);
@@ -469,7 +484,7 @@ namespace emu6502test
 
 		TEST_METHOD(STX_ZPG)
 		{
-			RAM->Write("A2 77 28 86 38");
+			RAM->Write("A2 77 28 86 38"_6502);
 			CPU->Run();
 			AssertLastInstruction("STX", sZeroPage);
 			Assert::AreEqual(0x77, (int)(*RAM)[0x0038]);
@@ -478,7 +493,7 @@ namespace emu6502test
 
 		TEST_METHOD(STX_ZPGY)
 		{
-			RAM->Write("A2 76 A0 10 28 96 40");
+			RAM->Write("A2 76 A0 10 28 96 40"_6502);
 			CPU->Run();
 			AssertLastInstruction("STX", sZeroPageY);
 			Assert::AreEqual(0x76, (int)(*RAM)[0x0050]);
@@ -487,7 +502,7 @@ namespace emu6502test
 
 		TEST_METHOD(STY_ABS)
 		{
-			RAM->Write("A0 11 28 8C 10 40");
+			RAM->Write("A0 11 28 8C 10 40"_6502);
 			CPU->Run();
 			AssertLastInstruction("STY", sAbsolute);
 			Assert::AreEqual(0x11, (int)(*RAM)[0x4010]);
@@ -496,7 +511,7 @@ namespace emu6502test
 
 		TEST_METHOD(STY_ZPG)
 		{
-			RAM->Write("A0 12 28 84 45");
+			RAM->Write("A0 12 28 84 45"_6502);
 			CPU->Run();
 			AssertLastInstruction("STY", sZeroPage);
 			Assert::AreEqual(0x12, (int)(*RAM)[0x0045]);
@@ -505,7 +520,7 @@ namespace emu6502test
 
 		TEST_METHOD(STY_ZPGX)
 		{
-			RAM->Write("A0 13 A2 20 28 94 60");
+			RAM->Write("A0 13 A2 20 28 94 60"_6502);
 			CPU->Run();
 			AssertLastInstruction("STY", sZeroPageX);
 			Assert::AreEqual(0x13, (int)(*RAM)[0x0080]);
@@ -527,7 +542,7 @@ namespace emu6502test
 
 		TEST_METHOD(TAX)
 		{
-			RAM->Write("A9 3A A2 FF 28 AA");
+			RAM->Write("A9 3A A2 FF 28 AA"_6502);
 			CPU->Run();
 			AssertLastInstruction("TAX");
 			Assert::AreEqual(0x3A, (int)CPU->X);
@@ -538,7 +553,7 @@ namespace emu6502test
 
 		TEST_METHOD(TAY)
 		{
-			RAM->Write("A9 3B A0 FF 28 A8");
+			RAM->Write("A9 3B A0 FF 28 A8"_6502);
 			CPU->Run();
 			AssertLastInstruction("TAY");
 			Assert::AreEqual(0x3B, (int)CPU->Y);
@@ -549,7 +564,7 @@ namespace emu6502test
 
 		TEST_METHOD(TSX)
 		{
-			RAM->Write("A2 FF 28 BA");
+			RAM->Write("A2 FF 28 BA"_6502);
 			CPU->Run();
 			AssertLastInstruction("TSX");
 			Assert::AreEqual((int)CPU->S, (int)CPU->X);
@@ -560,7 +575,7 @@ namespace emu6502test
 
 		TEST_METHOD(TXA)
 		{
-			RAM->Write("A9 FF A2 D1 28 8A");
+			RAM->Write("A9 FF A2 D1 28 8A"_6502);
 			CPU->Run();
 			AssertLastInstruction("TXA");
 			Assert::AreEqual(0xD1, (int)CPU->A);
@@ -571,7 +586,7 @@ namespace emu6502test
 
 		TEST_METHOD(TXS)
 		{
-			RAM->Write("A2 D3 28 9A");
+			RAM->Write("A2 D3 28 9A"_6502);
 			CPU->Run();
 			AssertLastInstruction("TXS");
 			Assert::AreEqual(0xD3, (int)CPU->S);
@@ -580,7 +595,7 @@ namespace emu6502test
 
 		TEST_METHOD(TYA)
 		{
-			RAM->Write("A9 FF A0 D2 28 98");
+			RAM->Write("A9 FF A0 D2 28 98"_6502);
 			CPU->Run();
 			AssertLastInstruction("TYA");
 			Assert::AreEqual(0xD2, (int)CPU->A);
@@ -605,7 +620,7 @@ namespace emu6502test
 
 		TEST_METHOD(PHA)
 		{
-			RAM->Write("A9 5A 48");
+			RAM->Write("A9 5A 48"_6502);
 			CPU->Run();
 			AssertLastInstruction("PHA");
 			Assert::AreEqual((*RAM)[(word)CPU->S + 0x100 + 1], CPU->A);
@@ -615,7 +630,7 @@ namespace emu6502test
 		TEST_METHOD(PLA)
 		{
 			// we can't pull P here because we need to pull A first
-			RAM->Write("A9 6A 48 A9 01 68");
+			RAM->Write("A9 6A 48 A9 01 68"_6502);
 			CPU->Run();
 			AssertLastInstruction("PLA");
 			Assert::AreEqual(0x6A, (int)CPU->A);
@@ -625,7 +640,7 @@ namespace emu6502test
 
 		TEST_METHOD(PHP)
 		{
-			RAM->Write("08");
+			RAM->Write("08"_6502);
 			CPU->Run();
 			AssertLastInstruction("PHP");
 			Assert::AreEqual((*RAM)[(word)CPU->S + 0x100 + 1], CPU->P);
@@ -634,7 +649,7 @@ namespace emu6502test
 
 		TEST_METHOD(PLP)
 		{
-			RAM->Write("A9 31 48 28"); // LDA #$31 PHA PLP (carry is set)
+			RAM->Write("A9 31 48 28"_6502); // LDA #$31 PHA PLP (carry is set)
 			CPU->Run();
 			AssertLastInstruction("PLP");
 			Assert::AreEqual(0x31, (int)CPU->P);
@@ -658,7 +673,7 @@ namespace emu6502test
 
 		TEST_METHOD(SEC)
 		{
-			RAM->Write("38");
+			RAM->Write("38"_6502);
 			CPU->Run();
 			AssertLastInstruction("SEC");
 			AssertCarry(true);
@@ -667,7 +682,7 @@ namespace emu6502test
 
 		TEST_METHOD(SED)
 		{
-			RAM->Write("F8");
+			RAM->Write("F8"_6502);
 			CPU->Run();
 			AssertLastInstruction("SED");
 			AssertDecimal(true);
@@ -676,7 +691,7 @@ namespace emu6502test
 
 		TEST_METHOD(SEI)
 		{
-			RAM->Write("78");
+			RAM->Write("78"_6502);
 			CPU->Run();
 			AssertLastInstruction("SEI");
 			AssertInterrupt(true);
@@ -685,7 +700,7 @@ namespace emu6502test
 
 		TEST_METHOD(CLC)
 		{
-			RAM->Write("38 18");
+			RAM->Write("38 18"_6502);
 			CPU->Run();
 			AssertLastInstruction("CLC");
 			AssertCarry(false);
@@ -694,7 +709,7 @@ namespace emu6502test
 
 		TEST_METHOD(CLD)
 		{
-			RAM->Write("F8 D8");
+			RAM->Write("F8 D8"_6502);
 			CPU->Run();
 			AssertLastInstruction("CLD");
 			AssertDecimal(false);
@@ -703,7 +718,7 @@ namespace emu6502test
 
 		TEST_METHOD(CLI)
 		{
-			RAM->Write("78 58");
+			RAM->Write("78 58"_6502);
 			CPU->Run();
 			AssertLastInstruction("CLI");
 			AssertInterrupt(false);
@@ -712,7 +727,7 @@ namespace emu6502test
 
 		TEST_METHOD(CLV)
 		{
-			RAM->Write("A9 7F 69 7F B8"); // forces an overflow then clears it
+			RAM->Write("A9 7F 69 7F B8"_6502); // forces an overflow then clears it
 			CPU->Run();
 			AssertLastInstruction("CLV");
 			AssertOverflow(false);
@@ -735,7 +750,7 @@ namespace emu6502test
 
 		TEST_METHOD(AND_IMM)
 		{
-			RAM->Write("A9 55 28 29 0F");
+			RAM->Write("A9 55 28 29 0F"_6502);
 			CPU->Run();
 			AssertLastInstruction("AND", sImmediate);
 			Assert::AreEqual(0x05, (int)CPU->A);
@@ -746,8 +761,8 @@ namespace emu6502test
 
 		TEST_METHOD(AND_ABS)
 		{
-			RAM->Write("A9 66 28 2D 00 20");
-			RAM->Write(0x2000, "F0");
+			RAM->Write("A9 66 28 2D 00 20"_6502);
+			RAM->Write(0x2000, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("AND", sAbsolute);
 			Assert::AreEqual(0x60, (int)CPU->A);
@@ -758,8 +773,8 @@ namespace emu6502test
 
 		TEST_METHOD(AND_ABSX)
 		{
-			RAM->Write("A9 77 A2 10 28 3D 00 20");
-			RAM->Write(0x2010, "0F");
+			RAM->Write("A9 77 A2 10 28 3D 00 20"_6502);
+			RAM->Write(0x2010, "0F"_6502);
 			CPU->Run();
 			AssertLastInstruction("AND", sAbsoluteX);
 			Assert::AreEqual(0x07, (int)CPU->A);
@@ -770,8 +785,8 @@ namespace emu6502test
 
 		TEST_METHOD(AND_ABSY)
 		{
-			RAM->Write("A9 88 A0 20 28 39 00 20");
-			RAM->Write(0x2020, "F0");
+			RAM->Write("A9 88 A0 20 28 39 00 20"_6502);
+			RAM->Write(0x2020, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("AND", sAbsoluteY);
 			Assert::AreEqual(0x80, (int)CPU->A);
@@ -782,8 +797,8 @@ namespace emu6502test
 
 		TEST_METHOD(AND_ZPG)
 		{
-			RAM->Write("A9 99 28 25 48");
-			RAM->Write(0x0048, "0F");
+			RAM->Write("A9 99 28 25 48"_6502);
+			RAM->Write(0x0048, "0F"_6502);
 			CPU->Run();
 			AssertLastInstruction("AND", sZeroPage);
 			Assert::AreEqual(0x09, (int)CPU->A);
@@ -794,8 +809,8 @@ namespace emu6502test
 
 		TEST_METHOD(AND_ZPGX)
 		{
-			RAM->Write("A9 AA A2 10 28 35 58");
-			RAM->Write(0x0068, "55");
+			RAM->Write("A9 AA A2 10 28 35 58"_6502);
+			RAM->Write(0x0068, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("AND", sZeroPageX);
 			Assert::AreEqual(0x00, (int)CPU->A);
@@ -806,9 +821,9 @@ namespace emu6502test
 
 		TEST_METHOD(AND_XIND)
 		{
-			RAM->Write("A9 BB A2 30 28 21 70");
-			RAM->Write(0x00A0, "10 20");
-			RAM->Write(0x2010, "0F");
+			RAM->Write("A9 BB A2 30 28 21 70"_6502);
+			RAM->Write(0x00A0, "10 20"_6502);
+			RAM->Write(0x2010, "0F"_6502);
 			CPU->Run();
 			AssertLastInstruction("AND", sXIndirect);
 			Assert::AreEqual(0x0B, (int)CPU->A);
@@ -819,9 +834,9 @@ namespace emu6502test
 
 		TEST_METHOD(AND_INDY)
 		{
-			RAM->Write("A9 CC A0 18 28 31 35");
-			RAM->Write(0x0035, "10 20");
-			RAM->Write(0x2028, "F0");
+			RAM->Write("A9 CC A0 18 28 31 35"_6502);
+			RAM->Write(0x0035, "10 20"_6502);
+			RAM->Write(0x2028, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("AND", sIndirectY);
 			Assert::AreEqual(0xC0, (int)CPU->A);
@@ -845,7 +860,7 @@ namespace emu6502test
 
 		TEST_METHOD(ORA_IMM)
 		{
-			RAM->Write("A9 05 28 09 A0");
+			RAM->Write("A9 05 28 09 A0"_6502);
 			CPU->Run();
 			AssertLastInstruction("ORA", sImmediate);
 			Assert::AreEqual(0xA5, (int)CPU->A);
@@ -856,8 +871,8 @@ namespace emu6502test
 
 		TEST_METHOD(ORA_ABS)
 		{
-			RAM->Write("A9 06 28 0D 00 20");
-			RAM->Write(0x2000, "B0");
+			RAM->Write("A9 06 28 0D 00 20"_6502);
+			RAM->Write(0x2000, "B0"_6502);
 			CPU->Run();
 			AssertLastInstruction("ORA", sAbsolute);
 			Assert::AreEqual(0xB6, (int)CPU->A);
@@ -868,8 +883,8 @@ namespace emu6502test
 
 		TEST_METHOD(ORA_ABSX)
 		{
-			RAM->Write("A9 07 A2 20 28 1D 00 30");
-			RAM->Write(0x3020, "C0");
+			RAM->Write("A9 07 A2 20 28 1D 00 30"_6502);
+			RAM->Write(0x3020, "C0"_6502);
 			CPU->Run();
 			AssertLastInstruction("ORA", sAbsoluteX);
 			Assert::AreEqual(0xC7, (int)CPU->A);
@@ -880,8 +895,8 @@ namespace emu6502test
 
 		TEST_METHOD(ORA_ABSY)
 		{
-			RAM->Write("A9 08 A0 30 28 19 00 40");
-			RAM->Write(0x4030, "D0");
+			RAM->Write("A9 08 A0 30 28 19 00 40"_6502);
+			RAM->Write(0x4030, "D0"_6502);
 			CPU->Run();
 			AssertLastInstruction("ORA", sAbsoluteY);
 			Assert::AreEqual(0xD8, (int)CPU->A);
@@ -892,8 +907,8 @@ namespace emu6502test
 
 		TEST_METHOD(ORA_ZPG)
 		{
-			RAM->Write("A9 09 28 05 78");
-			RAM->Write(0x0078, "E0");
+			RAM->Write("A9 09 28 05 78"_6502);
+			RAM->Write(0x0078, "E0"_6502);
 			CPU->Run();
 			AssertLastInstruction("ORA", sZeroPage);
 			Assert::AreEqual(0xE9, (int)CPU->A);
@@ -904,8 +919,8 @@ namespace emu6502test
 
 		TEST_METHOD(ORA_ZPGX)
 		{
-			RAM->Write("A9 0A A2 10 28 15 38");
-			RAM->Write(0x0048, "F0");
+			RAM->Write("A9 0A A2 10 28 15 38"_6502);
+			RAM->Write(0x0048, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("ORA", sZeroPageX);
 			Assert::AreEqual(0xFA, (int)CPU->A);
@@ -916,9 +931,9 @@ namespace emu6502test
 
 		TEST_METHOD(ORA_XIND)
 		{
-			RAM->Write("A9 0B A2 38 28 01 40");
-			RAM->Write(0x0078, "10 50");
-			RAM->Write(0x5010, "10");
+			RAM->Write("A9 0B A2 38 28 01 40"_6502);
+			RAM->Write(0x0078, "10 50"_6502);
+			RAM->Write(0x5010, "10"_6502);
 			CPU->Run();
 			AssertLastInstruction("ORA", sXIndirect);
 			Assert::AreEqual(0x1B, (int)CPU->A);
@@ -929,9 +944,9 @@ namespace emu6502test
 
 		TEST_METHOD(ORA_INDY)
 		{
-			RAM->Write("A9 0C A0 20 28 11 60");
-			RAM->Write(0x0060, "00 40");
-			RAM->Write(0x4020, "20");
+			RAM->Write("A9 0C A0 20 28 11 60"_6502);
+			RAM->Write(0x0060, "00 40"_6502);
+			RAM->Write(0x4020, "20"_6502);
 			CPU->Run();
 			AssertLastInstruction("ORA", sIndirectY);
 			Assert::AreEqual(0x2C, (int)CPU->A);
@@ -955,7 +970,7 @@ namespace emu6502test
 
 		TEST_METHOD(EOR_IMM)
 		{
-			RAM->Write("A9 FF 28 49 AA");
+			RAM->Write("A9 FF 28 49 AA"_6502);
 			CPU->Run();
 			AssertLastInstruction("EOR", sImmediate);
 			Assert::AreEqual(0x55, (int)CPU->A);
@@ -966,8 +981,8 @@ namespace emu6502test
 
 		TEST_METHOD(EOR_ABS)
 		{
-			RAM->Write("A9 F0 28 4D 00 20");
-			RAM->Write(0x2000, "38");
+			RAM->Write("A9 F0 28 4D 00 20"_6502);
+			RAM->Write(0x2000, "38"_6502);
 			CPU->Run();
 			AssertLastInstruction("EOR", sAbsolute);
 			Assert::AreEqual(0xC8, (int)CPU->A);
@@ -978,8 +993,8 @@ namespace emu6502test
 
 		TEST_METHOD(EOR_ABSX)
 		{
-			RAM->Write("A9 09 A2 10 28 5D 00 30");
-			RAM->Write(0x3010, "C8");
+			RAM->Write("A9 09 A2 10 28 5D 00 30"_6502);
+			RAM->Write(0x3010, "C8"_6502);
 			CPU->Run();
 			AssertLastInstruction("EOR", sAbsoluteX);
 			Assert::AreEqual(0xC1, (int)CPU->A);
@@ -990,8 +1005,8 @@ namespace emu6502test
 
 		TEST_METHOD(EOR_ABSY)
 		{
-			RAM->Write("A9 90 A0 20 28 59 00 30");
-			RAM->Write(0x3020, "8C");
+			RAM->Write("A9 90 A0 20 28 59 00 30"_6502);
+			RAM->Write(0x3020, "8C"_6502);
 			CPU->Run();
 			AssertLastInstruction("EOR", sAbsoluteY);
 			Assert::AreEqual(0x1C, (int)CPU->A);
@@ -1002,8 +1017,8 @@ namespace emu6502test
 
 		TEST_METHOD(EOR_ZPG)
 		{
-			RAM->Write("A9 5A 28 45 88");
-			RAM->Write(0x0088, "FF");
+			RAM->Write("A9 5A 28 45 88"_6502);
+			RAM->Write(0x0088, "FF"_6502);
 			CPU->Run();
 			AssertLastInstruction("EOR", sZeroPage);
 			Assert::AreEqual(0xA5, (int)CPU->A);
@@ -1014,8 +1029,8 @@ namespace emu6502test
 
 		TEST_METHOD(EOR_ZPGX)
 		{
-			RAM->Write("A9 A5 A2 10 28 55 98");
-			RAM->Write(0x00A8, "F0");
+			RAM->Write("A9 A5 A2 10 28 55 98"_6502);
+			RAM->Write(0x00A8, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("EOR", sZeroPageX);
 			Assert::AreEqual(0x55, (int)CPU->A);
@@ -1026,9 +1041,9 @@ namespace emu6502test
 
 		TEST_METHOD(EOR_XIND)
 		{
-			RAM->Write("A9 FF A2 50 28 41 10");
-			RAM->Write(0x0060, "00 71");
-			RAM->Write(0x7100, "55");
+			RAM->Write("A9 FF A2 50 28 41 10"_6502);
+			RAM->Write(0x0060, "00 71"_6502);
+			RAM->Write(0x7100, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("EOR", sXIndirect);
 			Assert::AreEqual(0xAA, (int)CPU->A);
@@ -1039,9 +1054,9 @@ namespace emu6502test
 
 		TEST_METHOD(EOR_INDY)
 		{
-			RAM->Write("A9 FF A0 20 28 51 20");
-			RAM->Write(0x0020, "00 26");
-			RAM->Write(0x2620, "AA");
+			RAM->Write("A9 FF A0 20 28 51 20"_6502);
+			RAM->Write(0x0020, "00 26"_6502);
+			RAM->Write(0x2620, "AA"_6502);
 			CPU->Run();
 			AssertLastInstruction("EOR", sIndirectY);
 			Assert::AreEqual(0x55, (int)CPU->A);
@@ -1065,7 +1080,7 @@ namespace emu6502test
 
 		TEST_METHOD(ASL_A)
 		{
-			RAM->Write("A9 87 28 18 0A");
+			RAM->Write("A9 87 28 18 0A"_6502);
 			CPU->Run();
 			AssertLastInstruction("ASL A");
 			Assert::AreEqual(0x0E, (int)CPU->A);
@@ -1077,8 +1092,8 @@ namespace emu6502test
 
 		TEST_METHOD(ASL_ABS)
 		{
-			RAM->Write("28 0E 00 20");
-			RAM->Write(0x2000, "55");
+			RAM->Write("28 0E 00 20"_6502);
+			RAM->Write(0x2000, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("ASL", sAbsolute);
 			Assert::AreEqual(0xAA, (int)(*RAM)[0x2000]);
@@ -1090,8 +1105,8 @@ namespace emu6502test
 
 		TEST_METHOD(ASL_ABSX)
 		{
-			RAM->Write("A2 30 28 1E 50 30");
-			RAM->Write(0x3080, "80");
+			RAM->Write("A2 30 28 1E 50 30"_6502);
+			RAM->Write(0x3080, "80"_6502);
 			CPU->Run();
 			AssertLastInstruction("ASL", sAbsoluteX);
 			Assert::AreEqual(0x00, (int)(*RAM)[0x3080]);
@@ -1103,8 +1118,8 @@ namespace emu6502test
 
 		TEST_METHOD(ASL_ZPG)
 		{
-			RAM->Write("28 06 20");
-			RAM->Write(0x0020, "55");
+			RAM->Write("28 06 20"_6502);
+			RAM->Write(0x0020, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("ASL", sZeroPage);
 			Assert::AreEqual(0xAA, (int)(*RAM)[0x0020]);
@@ -1116,8 +1131,8 @@ namespace emu6502test
 
 		TEST_METHOD(ASL_ZPGX)
 		{
-			RAM->Write("A2 30 28 16 30");
-			RAM->Write(0x0060, "C0");
+			RAM->Write("A2 30 28 16 30"_6502);
+			RAM->Write(0x0060, "C0"_6502);
 			CPU->Run();
 			AssertLastInstruction("ASL", sZeroPageX);
 			Assert::AreEqual(0x80, (int)(*RAM)[0x0060]);
@@ -1129,7 +1144,7 @@ namespace emu6502test
 
 		TEST_METHOD(LSR_A)
 		{
-			RAM->Write("A9 87 28 4A");
+			RAM->Write("A9 87 28 4A"_6502);
 			CPU->Run();
 			AssertLastInstruction("LSR A");
 			Assert::AreEqual(0x43, (int)CPU->A);
@@ -1141,8 +1156,8 @@ namespace emu6502test
 
 		TEST_METHOD(LSR_ABS)
 		{
-			RAM->Write("4E 00 20");
-			RAM->Write(0x2000, "55");
+			RAM->Write("4E 00 20"_6502);
+			RAM->Write(0x2000, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("LSR", sAbsolute);
 			Assert::AreEqual(0x2A, (int)(*RAM)[0x2000]);
@@ -1154,8 +1169,8 @@ namespace emu6502test
 
 		TEST_METHOD(LSR_ABSX)
 		{
-			RAM->Write("A2 30 28 5E 50 30");
-			RAM->Write(0x3080, "01");
+			RAM->Write("A2 30 28 5E 50 30"_6502);
+			RAM->Write(0x3080, "01"_6502);
 			CPU->Run();
 			AssertLastInstruction("LSR", sAbsoluteX);
 			Assert::AreEqual(0x00, (int)(*RAM)[0x3080]);
@@ -1167,8 +1182,8 @@ namespace emu6502test
 
 		TEST_METHOD(LSR_ZPG)
 		{
-			RAM->Write("46 20");
-			RAM->Write(0x0020, "FF");
+			RAM->Write("46 20"_6502);
+			RAM->Write(0x0020, "FF"_6502);
 			CPU->Run();
 			AssertLastInstruction("LSR", sZeroPage);
 			Assert::AreEqual(0x7F, (int)(*RAM)[0x0020]);
@@ -1180,8 +1195,8 @@ namespace emu6502test
 
 		TEST_METHOD(LSR_ZPGX)
 		{
-			RAM->Write("A2 30 28 56 30");
-			RAM->Write(0x0060, "C0");
+			RAM->Write("A2 30 28 56 30"_6502);
+			RAM->Write(0x0060, "C0"_6502);
 			CPU->Run();
 			AssertLastInstruction("LSR", sZeroPageX);
 			Assert::AreEqual(0x60, (int)(*RAM)[0x0060]);
@@ -1206,7 +1221,7 @@ namespace emu6502test
 
 		TEST_METHOD(ROL_A)
 		{
-			RAM->Write("A9 87 28 2A");
+			RAM->Write("A9 87 28 2A"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROL A");
 			Assert::AreEqual(0x0E, (int)CPU->A);
@@ -1218,8 +1233,8 @@ namespace emu6502test
 
 		TEST_METHOD(ROL_ABS)
 		{
-			RAM->Write("28 38 2E 00 20");
-			RAM->Write(0x2000, "55");
+			RAM->Write("28 38 2E 00 20"_6502);
+			RAM->Write(0x2000, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROL", sAbsolute);
 			Assert::AreEqual(0xAB, (int)(*RAM)[0x2000]);
@@ -1231,8 +1246,8 @@ namespace emu6502test
 
 		TEST_METHOD(ROL_ABSX)
 		{
-			RAM->Write("A2 30 28 3E 50 30");
-			RAM->Write(0x3080, "80");
+			RAM->Write("A2 30 28 3E 50 30"_6502);
+			RAM->Write(0x3080, "80"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROL", sAbsoluteX);
 			Assert::AreEqual(0x00, (int)(*RAM)[0x3080]);
@@ -1244,8 +1259,8 @@ namespace emu6502test
 
 		TEST_METHOD(ROL_ZPG)
 		{
-			RAM->Write("26 20");
-			RAM->Write(0x0020, "55");
+			RAM->Write("26 20"_6502);
+			RAM->Write(0x0020, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROL", sZeroPage);
 			Assert::AreEqual(0xAA, (int)(*RAM)[0x0020]);
@@ -1257,8 +1272,8 @@ namespace emu6502test
 
 		TEST_METHOD(ROL_ZPGX)
 		{
-			RAM->Write("A2 30 28 36 30");
-			RAM->Write(0x0060, "C4");
+			RAM->Write("A2 30 28 36 30"_6502);
+			RAM->Write(0x0060, "C4"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROL", sZeroPageX);
 			Assert::AreEqual(0x88, (int)(*RAM)[0x0060]);
@@ -1270,7 +1285,7 @@ namespace emu6502test
 
 		TEST_METHOD(ROR_A)
 		{
-			RAM->Write("A9 87 28 6A");
+			RAM->Write("A9 87 28 6A"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROR A");
 			Assert::AreEqual(0x43, (int)CPU->A);
@@ -1282,8 +1297,8 @@ namespace emu6502test
 
 		TEST_METHOD(ROR_ABS)
 		{
-			RAM->Write("6E 00 20");
-			RAM->Write(0x2000, "55");
+			RAM->Write("6E 00 20"_6502);
+			RAM->Write(0x2000, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROR", sAbsolute);
 			Assert::AreEqual(0x2A, (int)(*RAM)[0x2000]);
@@ -1295,8 +1310,8 @@ namespace emu6502test
 
 		TEST_METHOD(ROR_ABSX)
 		{
-			RAM->Write("A2 30 28 38 7E 50 30");
-			RAM->Write(0x3080, "01");
+			RAM->Write("A2 30 28 38 7E 50 30"_6502);
+			RAM->Write(0x3080, "01"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROR", sAbsoluteX);
 			Assert::AreEqual(0x80, (int)(*RAM)[0x3080]);
@@ -1308,8 +1323,8 @@ namespace emu6502test
 
 		TEST_METHOD(ROR_ZPG)
 		{
-			RAM->Write("66 20");
-			RAM->Write(0x0020, "FF");
+			RAM->Write("66 20"_6502);
+			RAM->Write(0x0020, "FF"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROR", sZeroPage);
 			Assert::AreEqual(0x7F, (int)(*RAM)[0x0020]);
@@ -1321,8 +1336,8 @@ namespace emu6502test
 
 		TEST_METHOD(ROR_ZPGX)
 		{
-			RAM->Write("A2 30 28 76 30");
-			RAM->Write(0x0060, "C0");
+			RAM->Write("A2 30 28 76 30"_6502);
+			RAM->Write(0x0060, "C0"_6502);
 			CPU->Run();
 			AssertLastInstruction("ROR", sZeroPageX);
 			Assert::AreEqual(0x60, (int)(*RAM)[0x0060]);
@@ -1347,7 +1362,7 @@ namespace emu6502test
 
 		TEST_METHOD(CMP_IMM)
 		{
-			RAM->Write("A9 60 28 C9 61");
+			RAM->Write("A9 60 28 C9 61"_6502);
 			CPU->Run();
 			AssertLastInstruction("CMP", sImmediate);
 			AssertCarry(false);
@@ -1358,8 +1373,8 @@ namespace emu6502test
 
 		TEST_METHOD(CMP_ABS)
 		{
-			RAM->Write("A9 10 28 CD 00 30");
-			RAM->Write(0x3000, "F0");
+			RAM->Write("A9 10 28 CD 00 30"_6502);
+			RAM->Write(0x3000, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("CMP", sAbsolute);
 			AssertCarry(false);
@@ -1370,8 +1385,8 @@ namespace emu6502test
 
 		TEST_METHOD(CMP_ABSX)
 		{
-			RAM->Write("A9 F0 A2 10 28 DD 00 30");
-			RAM->Write(0x3010, "F0");
+			RAM->Write("A9 F0 A2 10 28 DD 00 30"_6502);
+			RAM->Write(0x3010, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("CMP", sAbsoluteX);
 			AssertCarry(true);
@@ -1382,8 +1397,8 @@ namespace emu6502test
 
 		TEST_METHOD(CMP_ABSY)
 		{
-			RAM->Write("A9 AA A0 20 28 D9 00 40");
-			RAM->Write(0x4020, "55");
+			RAM->Write("A9 AA A0 20 28 D9 00 40"_6502);
+			RAM->Write(0x4020, "55"_6502);
 			CPU->Run();
 			AssertLastInstruction("CMP", sAbsoluteY);
 			AssertCarry(true);
@@ -1394,8 +1409,8 @@ namespace emu6502test
 
 		TEST_METHOD(CMP_ZPG)
 		{
-			RAM->Write("A9 10 28 C5 30");
-			RAM->Write(0x0030, "F0");
+			RAM->Write("A9 10 28 C5 30"_6502);
+			RAM->Write(0x0030, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("CMP", sZeroPage);
 			AssertCarry(false);
@@ -1406,8 +1421,8 @@ namespace emu6502test
 
 		TEST_METHOD(CMP_ZPGX)
 		{
-			RAM->Write("A9 F0 A2 10 28 D5 30");
-			RAM->Write(0x0040, "F0");
+			RAM->Write("A9 F0 A2 10 28 D5 30"_6502);
+			RAM->Write(0x0040, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("CMP", sZeroPageX);
 			AssertCarry(true);
@@ -1418,9 +1433,9 @@ namespace emu6502test
 
 		TEST_METHOD(CMP_XIND)
 		{
-			RAM->Write("A9 40 A2 50 28 C1 40");
-			RAM->Write(0x0090, "00 30");
-			RAM->Write(0x3000, "80");
+			RAM->Write("A9 40 A2 50 28 C1 40"_6502);
+			RAM->Write(0x0090, "00 30"_6502);
+			RAM->Write(0x3000, "80"_6502);
 			CPU->Run();
 			AssertLastInstruction("CMP", sXIndirect);
 			AssertCarry(false);
@@ -1431,9 +1446,9 @@ namespace emu6502test
 
 		TEST_METHOD(CMP_INDY)
 		{
-			RAM->Write("A9 80 A0 20 28 D1 30");
-			RAM->Write(0x0030, "00 30");
-			RAM->Write(0x3020, "40");
+			RAM->Write("A9 80 A0 20 28 D1 30"_6502);
+			RAM->Write(0x0030, "00 30"_6502);
+			RAM->Write(0x3020, "40"_6502);
 			CPU->Run();
 			AssertLastInstruction("CMP", sIndirectY);
 			AssertCarry(true);
@@ -1444,7 +1459,7 @@ namespace emu6502test
 
 		TEST_METHOD(CPX_IMM)
 		{
-			RAM->Write("A2 60 28 E0 61");
+			RAM->Write("A2 60 28 E0 61"_6502);
 			CPU->Run();
 			AssertLastInstruction("CPX", sImmediate);
 			AssertCarry(false);
@@ -1455,8 +1470,8 @@ namespace emu6502test
 
 		TEST_METHOD(CPX_ABS)
 		{
-			RAM->Write("A2 10 28 EC 00 30");
-			RAM->Write(0x3000, "F0");
+			RAM->Write("A2 10 28 EC 00 30"_6502);
+			RAM->Write(0x3000, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("CPX", sAbsolute);
 			AssertCarry(false);
@@ -1467,8 +1482,8 @@ namespace emu6502test
 
 		TEST_METHOD(CPX_ZPG)
 		{
-			RAM->Write("A2 10 28 E4 30");
-			RAM->Write(0x0030, "F0");
+			RAM->Write("A2 10 28 E4 30"_6502);
+			RAM->Write(0x0030, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("CPX", sZeroPage);
 			AssertCarry(false);
@@ -1479,7 +1494,7 @@ namespace emu6502test
 
 		TEST_METHOD(CPY_IMM)
 		{
-			RAM->Write("A0 61 28 C0 60");
+			RAM->Write("A0 61 28 C0 60"_6502);
 			CPU->Run();
 			AssertLastInstruction("CPY", sImmediate);
 			AssertCarry(true);
@@ -1490,8 +1505,8 @@ namespace emu6502test
 
 		TEST_METHOD(CPY_ABS)
 		{
-			RAM->Write("A0 10 28 CC 00 30");
-			RAM->Write(0x3000, "F0");
+			RAM->Write("A0 10 28 CC 00 30"_6502);
+			RAM->Write(0x3000, "F0"_6502);
 			CPU->Run();
 			AssertLastInstruction("CPY", sAbsolute);
 			AssertCarry(false);
@@ -1502,8 +1517,8 @@ namespace emu6502test
 
 		TEST_METHOD(CPY_ZPG)
 		{
-			RAM->Write("A0 10 28 C4 30");
-			RAM->Write(0x0030, "F6");
+			RAM->Write("A0 10 28 C4 30"_6502);
+			RAM->Write(0x0030, "F6"_6502);
 			CPU->Run();
 			AssertLastInstruction("CPY", sZeroPage);
 			AssertCarry(false);
@@ -1527,8 +1542,8 @@ namespace emu6502test
 
 		TEST_METHOD(INC_ABS)
 		{
-			RAM->Write("EE 00 20");
-			RAM->Write(0x2000, "30");
+			RAM->Write("EE 00 20"_6502);
+			RAM->Write(0x2000, "30"_6502);
 			CPU->Run();
 			AssertLastInstruction("INC", sAbsolute);
 			Assert::AreEqual(0x31, (int)(*RAM)[0x2000]);
@@ -1539,8 +1554,8 @@ namespace emu6502test
 
 		TEST_METHOD(INC_ABSX)
 		{
-			RAM->Write("A2 50 28 FE 00 30");
-			RAM->Write(0x3050, "FF");
+			RAM->Write("A2 50 28 FE 00 30"_6502);
+			RAM->Write(0x3050, "FF"_6502);
 			CPU->Run();
 			AssertLastInstruction("INC", sAbsoluteX);
 			Assert::AreEqual(0x00, (int)(*RAM)[0x3050]);
@@ -1551,8 +1566,8 @@ namespace emu6502test
 
 		TEST_METHOD(INC_ZPG)
 		{
-			RAM->Write("E6 20");
-			RAM->Write(0x0020, "7F");
+			RAM->Write("E6 20"_6502);
+			RAM->Write(0x0020, "7F"_6502);
 			CPU->Run();
 			AssertLastInstruction("INC", sZeroPage);
 			Assert::AreEqual(0x80, (int)(*RAM)[0x0020]);
@@ -1563,8 +1578,8 @@ namespace emu6502test
 
 		TEST_METHOD(INC_ZPGX)
 		{
-			RAM->Write("A2 40 28 F6 40");
-			RAM->Write(0x0080, "FE");
+			RAM->Write("A2 40 28 F6 40"_6502);
+			RAM->Write(0x0080, "FE"_6502);
 			CPU->Run();
 			AssertLastInstruction("INC", sZeroPageX);
 			Assert::AreEqual(0xFF, (int)(*RAM)[0x0080]);
@@ -1575,7 +1590,7 @@ namespace emu6502test
 
 		TEST_METHOD(INX)
 		{
-			RAM->Write("A2 0F 28 E8");
+			RAM->Write("A2 0F 28 E8"_6502);
 			CPU->Run();
 			AssertLastInstruction("INX");
 			Assert::AreEqual(0x10, (int)CPU->X);
@@ -1586,7 +1601,7 @@ namespace emu6502test
 
 		TEST_METHOD(INY)
 		{
-			RAM->Write("A0 FF 28 C8");
+			RAM->Write("A0 FF 28 C8"_6502);
 			CPU->Run();
 			AssertLastInstruction("INY");
 			Assert::AreEqual(0x00, (int)CPU->Y);
@@ -1610,8 +1625,8 @@ namespace emu6502test
 
 		TEST_METHOD(DEC_ABS)
 		{
-			RAM->Write("CE 00 20");
-			RAM->Write(0x2000, "30");
+			RAM->Write("CE 00 20"_6502);
+			RAM->Write(0x2000, "30"_6502);
 			CPU->Run();
 			AssertLastInstruction("DEC", sAbsolute);
 			Assert::AreEqual(0x2F, (int)(*RAM)[0x2000]);
@@ -1622,8 +1637,8 @@ namespace emu6502test
 
 		TEST_METHOD(DEC_ABSX)
 		{
-			RAM->Write("A2 50 28 DE 00 30");
-			RAM->Write(0x3050, "00");
+			RAM->Write("A2 50 28 DE 00 30"_6502);
+			RAM->Write(0x3050, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("DEC", sAbsoluteX);
 			Assert::AreEqual(0xFF, (int)(*RAM)[0x3050]);
@@ -1634,8 +1649,8 @@ namespace emu6502test
 
 		TEST_METHOD(DEC_ZPG)
 		{
-			RAM->Write("C6 20");
-			RAM->Write(0x0020, "80");
+			RAM->Write("C6 20"_6502);
+			RAM->Write(0x0020, "80"_6502);
 			CPU->Run();
 			AssertLastInstruction("DEC", sZeroPage);
 			Assert::AreEqual(0x7F, (int)(*RAM)[0x0020]);
@@ -1646,8 +1661,8 @@ namespace emu6502test
 
 		TEST_METHOD(DEC_ZPGX)
 		{
-			RAM->Write("A2 40 28 D6 40");
-			RAM->Write(0x0080, "FF");
+			RAM->Write("A2 40 28 D6 40"_6502);
+			RAM->Write(0x0080, "FF"_6502);
 			CPU->Run();
 			AssertLastInstruction("DEC", sZeroPageX);
 			Assert::AreEqual(0xFE, (int)(*RAM)[0x0080]);
@@ -1658,7 +1673,7 @@ namespace emu6502test
 
 		TEST_METHOD(DEX)
 		{
-			RAM->Write("A2 0F 28 CA");
+			RAM->Write("A2 0F 28 CA"_6502);
 			CPU->Run();
 			AssertLastInstruction("DEX");
 			Assert::AreEqual(0x0E, (int)CPU->X);
@@ -1669,7 +1684,7 @@ namespace emu6502test
 
 		TEST_METHOD(DEY)
 		{
-			RAM->Write("A0 00 28 88");
+			RAM->Write("A0 00 28 88"_6502);
 			CPU->Run();
 			AssertLastInstruction("DEY");
 			Assert::AreEqual(0xFF, (int)CPU->Y);
@@ -1693,7 +1708,7 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_IMM)
 		{
-			RAM->Write("A9 01 28 69 01");
+			RAM->Write("A9 01 28 69 01"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sImmediate);
 			Assert::AreEqual(0x02, (int)CPU->A);
@@ -1706,8 +1721,8 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_ABS)
 		{
-			RAM->Write("A9 FF 28 38 6D 00 20");
-			RAM->Write(0x2000, "FF");
+			RAM->Write("A9 FF 28 38 6D 00 20"_6502);
+			RAM->Write(0x2000, "FF"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sAbsolute);
 			Assert::AreEqual(0xFF, (int)CPU->A);
@@ -1720,8 +1735,8 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_ABSX)
 		{
-			RAM->Write("A9 80 A2 10 28 7D 00 20");
-			RAM->Write(0x2010, "80");
+			RAM->Write("A9 80 A2 10 28 7D 00 20"_6502);
+			RAM->Write(0x2010, "80"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sAbsoluteX);
 			Assert::AreEqual(0x00, (int)CPU->A);
@@ -1734,8 +1749,8 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_ABSY)
 		{
-			RAM->Write("A9 0A A0 20 28 79 00 20");
-			RAM->Write(0x2020, "F6");
+			RAM->Write("A9 0A A0 20 28 79 00 20"_6502);
+			RAM->Write(0x2020, "F6"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sAbsoluteY);
 			Assert::AreEqual(0x00, (int)CPU->A);
@@ -1748,8 +1763,8 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_ZPG)
 		{
-			RAM->Write("A9 20 28 65 48");
-			RAM->Write(0x0048, "40");
+			RAM->Write("A9 20 28 65 48"_6502);
+			RAM->Write(0x0048, "40"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sZeroPage);
 			Assert::AreEqual(0x60, (int)CPU->A);
@@ -1762,8 +1777,8 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_ZPGX)
 		{
-			RAM->Write("A9 F6 A2 10 28 75 58");
-			RAM->Write(0x0068, "F6");
+			RAM->Write("A9 F6 A2 10 28 75 58"_6502);
+			RAM->Write(0x0068, "F6"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sZeroPageX);
 			Assert::AreEqual(0xEC, (int)CPU->A);
@@ -1776,9 +1791,9 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_XIND)
 		{
-			RAM->Write("A9 0F A2 30 28 38 61 70");
-			RAM->Write(0x00A0, "10 20");
-			RAM->Write(0x2010, "0F");
+			RAM->Write("A9 0F A2 30 28 38 61 70"_6502);
+			RAM->Write(0x00A0, "10 20"_6502);
+			RAM->Write(0x2010, "0F"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sXIndirect);
 			Assert::AreEqual(0x1F, (int)CPU->A);
@@ -1791,9 +1806,9 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_INDY)
 		{
-			RAM->Write("A9 7F A0 18 28 38 71 35");
-			RAM->Write(0x0035, "10 20");
-			RAM->Write(0x2028, "7F");
+			RAM->Write("A9 7F A0 18 28 38 71 35"_6502);
+			RAM->Write(0x0035, "10 20"_6502);
+			RAM->Write(0x2028, "7F"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sIndirectY);
 			Assert::AreEqual(0xFF, (int)CPU->A);
@@ -1806,7 +1821,7 @@ namespace emu6502test
 
 		TEST_METHOD(ADC_IMM_BCD)
 		{
-			RAM->Write("F8 A9 50 69 50");
+			RAM->Write("F8 A9 50 69 50"_6502);
 			CPU->Run();
 			AssertLastInstruction("ADC", sImmediate);
 			Assert::AreEqual(0x00, (int)CPU->A);
@@ -1831,7 +1846,7 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_IMM)
 		{
-			RAM->Write("A9 01 28 18 E9 01");
+			RAM->Write("A9 01 28 18 E9 01"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sImmediate);
 			Assert::AreEqual(0xFF, (int)CPU->A);
@@ -1844,8 +1859,8 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_ABS)
 		{
-			RAM->Write("A9 FF 28 38 ED 00 20");
-			RAM->Write(0x2000, "FF");
+			RAM->Write("A9 FF 28 38 ED 00 20"_6502);
+			RAM->Write(0x2000, "FF"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sAbsolute);
 			Assert::AreEqual(0x00, (int)CPU->A);
@@ -1858,8 +1873,8 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_ABSX)
 		{
-			RAM->Write("A9 80 A2 10 28 FD 00 20");
-			RAM->Write(0x2010, "7F");
+			RAM->Write("A9 80 A2 10 28 FD 00 20"_6502);
+			RAM->Write(0x2010, "7F"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sAbsoluteX);
 			Assert::AreEqual(0x00, (int)CPU->A);
@@ -1872,8 +1887,8 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_ABSY)
 		{
-			RAM->Write("A9 0A A0 20 38 F9 00 20");
-			RAM->Write(0x2020, "F6");
+			RAM->Write("A9 0A A0 20 38 F9 00 20"_6502);
+			RAM->Write(0x2020, "F6"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sAbsoluteY);
 			Assert::AreEqual(0x14, (int)CPU->A);
@@ -1886,8 +1901,8 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_ZPG)
 		{
-			RAM->Write("A9 20 28 E5 48");
-			RAM->Write(0x0048, "40");
+			RAM->Write("A9 20 28 E5 48"_6502);
+			RAM->Write(0x0048, "40"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sZeroPage);
 			Assert::AreEqual(0xDF, (int)CPU->A);
@@ -1900,8 +1915,8 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_ZPGX)
 		{
-			RAM->Write("A9 F6 A2 10 38 F5 58");
-			RAM->Write(0x0068, "F6");
+			RAM->Write("A9 F6 A2 10 38 F5 58"_6502);
+			RAM->Write(0x0068, "F6"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sZeroPageX);
 			Assert::AreEqual(0x00, (int)CPU->A);
@@ -1914,9 +1929,9 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_XIND)
 		{
-			RAM->Write("A9 0F A2 30 28 38 E1 70");
-			RAM->Write(0x00A0, "10 20");
-			RAM->Write(0x2010, "1F");
+			RAM->Write("A9 0F A2 30 28 38 E1 70"_6502);
+			RAM->Write(0x00A0, "10 20"_6502);
+			RAM->Write(0x2010, "1F"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sXIndirect);
 			Assert::AreEqual(0xF0, (int)CPU->A);
@@ -1929,9 +1944,9 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_INDY)
 		{
-			RAM->Write("A9 7F A0 18 28 38 F1 35");
-			RAM->Write(0x0035, "10 20");
-			RAM->Write(0x2028, "80");
+			RAM->Write("A9 7F A0 18 28 38 F1 35"_6502);
+			RAM->Write(0x0035, "10 20"_6502);
+			RAM->Write(0x2028, "80"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sIndirectY);
 			Assert::AreEqual(0xFF, (int)CPU->A);
@@ -1944,7 +1959,7 @@ namespace emu6502test
 
 		TEST_METHOD(SBC_IMM_BCD)
 		{
-			RAM->Write("F8 A9 41 38 E9 36");
+			RAM->Write("F8 A9 41 38 E9 36"_6502);
 			CPU->Run();
 			AssertLastInstruction("SBC", sImmediate);
 			Assert::AreEqual(0x05, (int)CPU->A);
@@ -1969,8 +1984,8 @@ namespace emu6502test
 
 		TEST_METHOD(BCC)
 		{
-			RAM->Write("18 90 0F");
-			RAM->Write(0x1013, "00");
+			RAM->Write("18 90 0F"_6502);
+			RAM->Write(0x1013, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("BCC");
 			Assert::AreEqual(0x1013, (int)CPU->PC - 1); // -1 to account for BRK
@@ -1979,8 +1994,8 @@ namespace emu6502test
 
 		TEST_METHOD(BCS)
 		{
-			RAM->Write("38 B0 F0");
-			RAM->Write(0x0FF4, "00");
+			RAM->Write("38 B0 F0"_6502);
+			RAM->Write(0x0FF4, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("BCS");
 			Assert::AreEqual(0x0FF4, (int)CPU->PC - 1);
@@ -1990,8 +2005,8 @@ namespace emu6502test
 
 		TEST_METHOD(BEQ)
 		{
-			RAM->Write("A9 00 F0 7F");
-			RAM->Write(0x1084, "00");
+			RAM->Write("A9 00 F0 7F"_6502);
+			RAM->Write(0x1084, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("BEQ");
 			Assert::AreEqual(0x1084, (int)CPU->PC - 1);
@@ -2001,8 +2016,8 @@ namespace emu6502test
 
 		TEST_METHOD(BNE)
 		{
-			RAM->Write("A9 01 D0 80");
-			RAM->Write(0x0F85, "00");
+			RAM->Write("A9 01 D0 80"_6502);
+			RAM->Write(0x0F85, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("BNE");
 			Assert::AreEqual(0x0F85, (int)CPU->PC - 1);
@@ -2011,8 +2026,8 @@ namespace emu6502test
 
 		TEST_METHOD(BMI)
 		{
-			RAM->Write("A9 FF 30 7F");
-			RAM->Write(0x1084, "00");
+			RAM->Write("A9 FF 30 7F"_6502);
+			RAM->Write(0x1084, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("BMI");
 			Assert::AreEqual(0x1084, (int)CPU->PC - 1);
@@ -2022,8 +2037,8 @@ namespace emu6502test
 
 		TEST_METHOD(BPL)
 		{
-			RAM->Write("A9 01 10 80");
-			RAM->Write(0x0F85, "00");
+			RAM->Write("A9 01 10 80"_6502);
+			RAM->Write(0x0F85, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("BPL");
 			Assert::AreEqual(0x0F85, (int)CPU->PC - 1);
@@ -2032,8 +2047,8 @@ namespace emu6502test
 
 		TEST_METHOD(BVS)
 		{
-			RAM->Write("A9 7F 69 7F 70 7F");
-			RAM->Write(0x1086, "00");
+			RAM->Write("A9 7F 69 7F 70 7F"_6502);
+			RAM->Write(0x1086, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("BVS");
 			Assert::AreEqual(0x1086, (int)CPU->PC - 1);
@@ -2044,8 +2059,8 @@ namespace emu6502test
 
 		TEST_METHOD(BVC)
 		{
-			RAM->Write("50 80");
-			RAM->Write(0x0F83, "00");
+			RAM->Write("50 80"_6502);
+			RAM->Write(0x0F83, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("BVC");
 			Assert::AreEqual(0x0F83, (int)CPU->PC - 1);
@@ -2067,8 +2082,8 @@ namespace emu6502test
 
 		TEST_METHOD(BIT_ABS)
 		{
-			RAM->Write("A9 05 2C 00 20");
-			RAM->Write(0x2000, "FA");
+			RAM->Write("A9 05 2C 00 20"_6502);
+			RAM->Write(0x2000, "FA"_6502);
 			CPU->Run();
 			AssertLastInstruction("BIT", sAbsolute);
 			AssertZero(true);
@@ -2078,8 +2093,8 @@ namespace emu6502test
 
 		TEST_METHOD(BIT_ZPG)
 		{
-			RAM->Write("A9 F8 24 20");
-			RAM->Write(0x0020, "0F");
+			RAM->Write("A9 F8 24 20"_6502);
+			RAM->Write(0x0020, "0F"_6502);
 			CPU->Run();
 			AssertLastInstruction("BIT", sZeroPage);
 			AssertZero(false);
@@ -2102,7 +2117,7 @@ namespace emu6502test
 
 		TEST_METHOD(NOP)
 		{
-			RAM->Write("EA");
+			RAM->Write("EA"_6502);
 			CPU->Run();
 			AssertLastInstruction("NOP");
 			AssertFlagsUnchanged();
@@ -2110,8 +2125,8 @@ namespace emu6502test
 
 		TEST_METHOD(JMP_ABS)
 		{
-			RAM->Write("4C 00 40");
-			RAM->Write(0x4000, "00");
+			RAM->Write("4C 00 40"_6502);
+			RAM->Write(0x4000, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("JMP", sAbsolute);
 			Assert::AreEqual(0x4000, CPU->PC - 1);
@@ -2120,9 +2135,9 @@ namespace emu6502test
 
 		TEST_METHOD(JMP_IND)
 		{
-			RAM->Write("6C 00 40");
-			RAM->Write(0x4000, "00 50");
-			RAM->Write(0x5000, "00");
+			RAM->Write("6C 00 40"_6502);
+			RAM->Write(0x4000, "00 50"_6502);
+			RAM->Write(0x5000, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("JMP", sIndirect);
 			Assert::AreEqual(0x5000, CPU->PC - 1);
@@ -2132,10 +2147,10 @@ namespace emu6502test
 		TEST_METHOD(JMP_IND_BUG)
 		{
 			// instead of reading 0x50 at 0x4000, JMP (0x3FFF) reads 0x60 at 0x3FF00
-			RAM->Write("6C FF 3F");
-			RAM->Write(0x3FFF, "00 50");
-			RAM->Write(0x3F00, "60");
-			RAM->Write(0x6000, "00");
+			RAM->Write("6C FF 3F"_6502);
+			RAM->Write(0x3FFF, "00 50"_6502);
+			RAM->Write(0x3F00, "60"_6502);
+			RAM->Write(0x6000, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("JMP", sIndirect);
 			Assert::AreEqual(0x6000, CPU->PC - 1);
@@ -2144,8 +2159,8 @@ namespace emu6502test
 
 		TEST_METHOD(JSR)
 		{
-			RAM->Write("20 00 30");
-			RAM->Write(0x3000, "00");
+			RAM->Write("20 00 30"_6502);
+			RAM->Write(0x3000, "00"_6502);
 			CPU->Run();
 			AssertLastInstruction("JSR");
 			Assert::AreEqual(0x3000, CPU->PC - 1);
@@ -2157,8 +2172,8 @@ namespace emu6502test
 
 		TEST_METHOD(RTS)
 		{
-			RAM->Write("20 00 30");
-			RAM->Write(0x3000, "60");
+			RAM->Write("20 00 30"_6502);
+			RAM->Write(0x3000, "60"_6502);
 			CPU->Run();
 			AssertLastInstruction("RTS");
 			Assert::AreEqual(0x1004, CPU->PC - 1);
@@ -2167,8 +2182,8 @@ namespace emu6502test
 
 		TEST_METHOD(BRK)
 		{
-			RAM->Write("00");
-			RAM->Write(0xFFFE, "00 80");
+			RAM->Write("00"_6502);
+			RAM->Write(0xFFFE, "00 80"_6502);
 			CPU->EndOnBreak = false;
 			CPU->Step(2);
 			AssertLastInstruction("BRK");
@@ -2178,9 +2193,9 @@ namespace emu6502test
 
 		TEST_METHOD(RTI)
 		{
-			RAM->Write("00 EA");
-			RAM->Write(0xFFFE, "00 80");
-			RAM->Write(0x8000, "EA 40");
+			RAM->Write("00 EA"_6502);
+			RAM->Write(0xFFFE, "00 80"_6502);
+			RAM->Write(0x8000, "EA 40"_6502);
 			CPU->EndOnBreak = false;
 			CPU->Step(4);
 			AssertLastInstruction("RTI");
@@ -2203,7 +2218,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_IMP)
 		{
-			RAM->Write("EA");
+			RAM->Write("EA"_6502);
 			CPU->Step(); // do not execute BRK
 			AssertLastInstruction("NOP");
 			Assert::AreEqual(2, CPU->Clock);
@@ -2211,7 +2226,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_IMM)
 		{
-			RAM->Write("A9 00");
+			RAM->Write("A9 00"_6502);
 			CPU->Step(); 
 			AssertLastInstruction("LDA", sImmediate);
 			Assert::AreEqual(2, CPU->Clock);
@@ -2219,7 +2234,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_ABS)
 		{
-			RAM->Write("AD 00 10");
+			RAM->Write("AD 00 10"_6502);
 			CPU->Step();
 			AssertLastInstruction("LDA", sAbsolute);
 			Assert::AreEqual(4, CPU->Clock);
@@ -2227,7 +2242,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_ABSX)
 		{
-			RAM->Write("A2 10 BD 00 10");
+			RAM->Write("A2 10 BD 00 10"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2237,7 +2252,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_ABSX_CPG)
 		{
-			RAM->Write("A2 10 BD FF 10");
+			RAM->Write("A2 10 BD FF 10"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2247,7 +2262,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_ABSY)
 		{
-			RAM->Write("A0 10 B9 00 10");
+			RAM->Write("A0 10 B9 00 10"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2257,7 +2272,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_ABSY_CPG)
 		{
-			RAM->Write("A0 10 B9 FF 10");
+			RAM->Write("A0 10 B9 FF 10"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2267,7 +2282,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_ZPG)
 		{
-			RAM->Write("A5 20");
+			RAM->Write("A5 20"_6502);
 			CPU->Step();
 			AssertLastInstruction("LDA", sZeroPage);
 			Assert::AreEqual(3, CPU->Clock);
@@ -2275,7 +2290,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_ZPGX)
 		{
-			RAM->Write("A2 10 B5 20");
+			RAM->Write("A2 10 B5 20"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2285,7 +2300,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_ZPGY)
 		{
-			RAM->Write("A0 10 B6 20");
+			RAM->Write("A0 10 B6 20"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2295,9 +2310,9 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_XIND)
 		{
-			RAM->Write("A2 20 A1 20");
-			RAM->Write(0x0040, "00 30");
-			RAM->Write(0x3000, "DF");
+			RAM->Write("A2 20 A1 20"_6502);
+			RAM->Write(0x0040, "00 30"_6502);
+			RAM->Write(0x3000, "DF"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2307,9 +2322,9 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_INDY)
 		{
-			RAM->Write("A0 30 B1 20");
-			RAM->Write(0x0020, "00 40");
-			RAM->Write(0x4030, "E0");
+			RAM->Write("A0 30 B1 20"_6502);
+			RAM->Write(0x0020, "00 40"_6502);
+			RAM->Write(0x4030, "E0"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2319,9 +2334,9 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_INDY_CPG)
 		{
-			RAM->Write("A0 30 B1 20");
-			RAM->Write(0x0020, "FF 40");
-			RAM->Write(0x412F, "E0");
+			RAM->Write("A0 30 B1 20"_6502);
+			RAM->Write(0x0020, "FF 40"_6502);
+			RAM->Write(0x412F, "E0"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2331,7 +2346,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_STO_ABS)
 		{
-			RAM->Write("8D 00 10");
+			RAM->Write("8D 00 10"_6502);
 			CPU->Step();
 			AssertLastInstruction("STA", sAbsolute);
 			Assert::AreEqual(4, CPU->Clock);
@@ -2339,7 +2354,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_STO_ABSX)
 		{
-			RAM->Write("A2 10 9D 00 10");
+			RAM->Write("A2 10 9D 00 10"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2349,7 +2364,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_STO_ABSY)
 		{
-			RAM->Write("A0 10 99 00 10");
+			RAM->Write("A0 10 99 00 10"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2359,7 +2374,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_STO_ZPG)
 		{
-			RAM->Write("85 10");
+			RAM->Write("85 10"_6502);
 			CPU->Step();
 			AssertLastInstruction("STA", sZeroPage);
 			Assert::AreEqual(3, CPU->Clock);
@@ -2367,7 +2382,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_STO_ZPGX)
 		{
-			RAM->Write("A2 10 95 20");
+			RAM->Write("A2 10 95 20"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2377,7 +2392,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_STO_ZPGY)
 		{
-			RAM->Write("A0 10 96 20");
+			RAM->Write("A0 10 96 20"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2387,8 +2402,8 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_STO_XIND)
 		{
-			RAM->Write("A2 20 81 20");
-			RAM->Write(0x0040, "00 30");
+			RAM->Write("A2 20 81 20"_6502);
+			RAM->Write(0x0040, "00 30"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2398,8 +2413,8 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_STO_INDY)
 		{
-			RAM->Write("A0 30 91 20");
-			RAM->Write(0x0020, "00 40");
+			RAM->Write("A0 30 91 20"_6502);
+			RAM->Write(0x0020, "00 40"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2409,7 +2424,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_RMW_ABS)
 		{
-			RAM->Write("0E 00 10");
+			RAM->Write("0E 00 10"_6502);
 			CPU->Step();
 			AssertLastInstruction("ASL", sAbsolute);
 			Assert::AreEqual(6, CPU->Clock);
@@ -2417,7 +2432,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_RMW_ABSX)
 		{
-			RAM->Write("A2 20 1E 00 20");
+			RAM->Write("A2 20 1E 00 20"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2427,7 +2442,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_RMW_ZPG)
 		{
-			RAM->Write("06 10");
+			RAM->Write("06 10"_6502);
 			CPU->Step();
 			AssertLastInstruction("ASL", sZeroPage);
 			Assert::AreEqual(5, CPU->Clock);
@@ -2435,7 +2450,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_RMW_ZPGX)
 		{
-			RAM->Write("A2 10 16 20");
+			RAM->Write("A2 10 16 20"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2445,7 +2460,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_PUSH)
 		{
-			RAM->Write("48");
+			RAM->Write("48"_6502);
 			CPU->Step();
 			AssertLastInstruction("PHA");
 			Assert::AreEqual(3, CPU->Clock);
@@ -2453,7 +2468,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_PULL)
 		{
-			RAM->Write("68");
+			RAM->Write("68"_6502);
 			CPU->Step();
 			AssertLastInstruction("PLA");
 			Assert::AreEqual(4, CPU->Clock);
@@ -2461,7 +2476,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_JMP_ABS)
 		{
-			RAM->Write("4C 00 10");
+			RAM->Write("4C 00 10"_6502);
 			CPU->Step();
 			AssertLastInstruction("JMP", sAbsolute);
 			Assert::AreEqual(3, CPU->Clock);
@@ -2469,8 +2484,8 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_JMP_IND)
 		{
-			RAM->Write("6C 00 40");
-			RAM->Write(0x4000, "00 50");
+			RAM->Write("6C 00 40"_6502);
+			RAM->Write(0x4000, "00 50"_6502);
 			CPU->Step();
 			AssertLastInstruction("JMP", sIndirect);
 			Assert::AreEqual(5, CPU->Clock);
@@ -2478,7 +2493,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_JSR)
 		{
-			RAM->Write("20 00 10");
+			RAM->Write("20 00 10"_6502);
 			CPU->Step();
 			AssertLastInstruction("JSR");
 			Assert::AreEqual(6, CPU->Clock);
@@ -2486,8 +2501,8 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_RTS)
 		{
-			RAM->Write("20 00 30");
-			RAM->Write(0x3000, "60");
+			RAM->Write("20 00 30"_6502);
+			RAM->Write(0x3000, "60"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2497,7 +2512,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_BRK)
 		{
-			RAM->Write("00");
+			RAM->Write("00"_6502);
 			CPU->EndOnBreak = false; // to avoid a NULL LastInstruction
 			CPU->Step();
 			AssertLastInstruction("BRK");
@@ -2506,9 +2521,9 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_RTI)
 		{
-			RAM->Write("00 EA");
-			RAM->Write(0xFFFE, "00 80");
-			RAM->Write(0x8000, "EA 40");
+			RAM->Write("00 EA"_6502);
+			RAM->Write(0xFFFE, "00 80"_6502);
+			RAM->Write(0x8000, "EA 40"_6502);
 			CPU->EndOnBreak = false;
 			CPU->Step(2);
 			CPU->Clock = 0;
@@ -2519,7 +2534,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_BRC_KO)
 		{
-			RAM->Write("18 B0 10");
+			RAM->Write("18 B0 10"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2529,7 +2544,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_BRC_OK)
 		{
-			RAM->Write("18 90 10");
+			RAM->Write("18 90 10"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2539,7 +2554,7 @@ namespace emu6502test
 
 		TEST_METHOD(CYC_BRC_CPG)
 		{
-			RAM->Write("18 90 F0");
+			RAM->Write("18 90 F0"_6502);
 			CPU->Step();
 			CPU->Clock = 0;
 			CPU->Step();
@@ -2547,4 +2562,2330 @@ namespace emu6502test
 			Assert::AreEqual(4, CPU->Clock);
 		}
 	};
+
+	TEST_CLASS(State)
+	{
+	public:
+		TEST_METHOD_INITIALIZE(createCPU)
+		{
+			_method_initialize();
+		}
+
+		TEST_METHOD_CLEANUP(deleteCPU)
+		{
+			_method_cleanup();
+		}
+
+		TEST_METHOD(SNAP_RESTORE)
+		{
+			Snapshot *snap = new Snapshot();
+			RAM->Write("A9 12 8D 00 20 A2 34 8E 00 20"_6502);
+			CPU->Step(2);
+			byte value = (*RAM)[0x2000];
+			int clock = CPU->Clock;
+			CPU->Save(*snap);
+			CPU->Step(3);
+			CPU->Restore(*snap);
+			Assert::AreEqual(0x1003, (int)CPU->PC);
+			Assert::AreEqual(clock, CPU->Clock);
+			Assert::AreEqual(0x12, (int)CPU->A);
+			Assert::AreEqual((int)value, (int)(*RAM)[0x2000]);
+			AssertLastInstruction("LDA", sImmediate);
+			CPU->Run();
+			Assert::AreEqual(0x34, (int)(*RAM)[0x2000]);
+			delete snap;
+		}
+
+		TEST_METHOD(SNAP_OTHER_MACHINE)
+		{
+			Snapshot *snap = new Snapshot();
+			Memory *ram = new Memory();
+			Processor *cpu = new Processor(ram);
+			RAM->Write("A2 20 A9 55 9D 00 20 E8 9D 00 20"_6502);
+			CPU->Step(4);
+			CPU->Save(*snap);
+			cpu->Restore(*snap);
+			cpu->Run();
+			Assert::IsTrue(cpu->IsLastInstruction("STA", sAbsoluteX), MessageMismatch);
+			Assert::AreEqual(0x21, (int)cpu->X);
+			Assert::AreEqual(0x55, (int)(*ram)[0x2020]);
+			Assert::AreEqual(0x55, (int)(*ram)[0x2021]);
+			delete cpu;
+			delete ram;
+			delete snap;
+		}
+	};
+
+	TEST_CLASS(DirtyPages)
+	{
+	public:
+		TEST_METHOD_INITIALIZE(createCPU)
+		{
+			_method_initialize();
+		}
+
+		TEST_METHOD_CLEANUP(deleteCPU)
+		{
+			_method_cleanup();
+		}
+
+		TEST_METHOD(DIRTY_STORE)
+		{
+			uint64_t pages[4];
+			RAM->Write("A9 01 8D 00 20 8D FF C0"_6502);
+			RAM->ClearDirtyPages();
+			CPU->Run();
+			RAM->ReadDirtyPages(pages);
+			// PHP writes to the stack in page 1
+			Assert::AreEqual((uint64_t)0x0000000100000002, pages[0]);
+			Assert::AreEqual((uint64_t)0, pages[1]);
+			Assert::AreEqual((uint64_t)1, pages[3]);
+		}
+
+		TEST_METHOD(DIRTY_RMW)
+		{
+			uint64_t pages[4];
+			RAM->Write("E8 0A EE 00 90 4E 00 91"_6502);
+			RAM->ClearDirtyPages();
+			CPU->Run();
+			RAM->ReadDirtyPages(pages);
+			Assert::AreEqual((uint64_t)2, pages[0]);
+			Assert::AreEqual((uint64_t)0, pages[1]);
+			Assert::AreEqual((uint64_t)3 << 16, pages[2]);
+			Assert::AreEqual((uint64_t)0, pages[3]);
+		}
+
+		TEST_METHOD(DIRTY_CLEAR)
+		{
+			uint64_t pages[4];
+			RAM->Write(0x4000, "12"_6502);
+			RAM->ClearDirtyPages();
+			RAM->ReadDirtyPages(pages);
+			Assert::AreEqual((uint64_t)0, pages[0] | pages[1] | pages[2] | pages[3]);
+		}
+
+		TEST_METHOD(DIRTY_RESTORE)
+		{
+			Snapshot *snap = new Snapshot();
+			RAM->Write("A9 77 8D 00 50 EE 00 60"_6502);
+			RAM->Write(0x6000, "10"_6502);
+			CPU->Save(*snap);
+			CPU->Run();
+			Assert::AreEqual(0x11, (int)(*RAM)[0x6000]);
+			// only pages 1, 0x50 and 0x60 are copied back
+			CPU->Restore(*snap);
+			Assert::AreEqual(0x10, (int)(*RAM)[0x6000]);
+			Assert::AreEqual((int)snap->RAM[0x5000], (int)(*RAM)[0x5000]);
+			Assert::AreEqual(0, memcmp(snap->RAM, RAM->Pointer(0), 0x10000));
+			delete snap;
+		}
+
+		TEST_METHOD(DIRTY_RESTORE_FOREIGN)
+		{
+			Snapshot *snap = new Snapshot();
+			Memory *ram = new Memory();
+			RAM->Write(0x6000, "10"_6502);
+			CPU->Save(*snap);
+			// edited after Save(): clearing the owner forces the full copy
+			snap->RAM[0x7000] = 0x42;
+			snap->Owner = 0;
+			CPU->Restore(*snap);
+			Assert::AreEqual(0x42, (int)(*RAM)[0x7000]);
+			// another instance saving with the same generation number, as a file from another process could
+			(*ram)[0x7000] = 0x24;
+			uint64_t generation = snap->Generation;
+			ram->Save(*snap);
+			snap->Generation = generation;
+			CPU->Restore(*snap);
+			Assert::AreEqual(0x24, (int)(*RAM)[0x7000]);
+			Assert::AreEqual(0x00, (int)(*RAM)[0x6000]);
+			delete ram;
+			delete snap;
+		}
+	};
+
+	TEST_CLASS(Digest)
+	{
+	public:
+		TEST_METHOD_INITIALIZE(createCPU)
+		{
+			_method_initialize();
+		}
+
+		TEST_METHOD_CLEANUP(deleteCPU)
+		{
+			_method_cleanup();
+		}
+
+		TEST_METHOD(DIGEST_SAME_CONTENT)
+		{
+			Snapshot *snap = new Snapshot();
+			Memory *ram = new Memory();
+			CPU->Save(*snap);
+			ram->Restore(*snap);
+			Assert::IsTrue(RAM->Digest() == ram->Digest());
+			Assert::IsTrue(RAM->PageDigest(0x10) == ram->PageDigest(0x10));
+			delete ram;
+			delete snap;
+		}
+
+		TEST_METHOD(DIGEST_CHANGE)
+		{
+			byte stack[0x100];
+			RAM->Write("A9 01 8D 00 20"_6502);
+			RAM->Write(0x2000, "00"_6502);
+			RAM->CopyOut(stack, 0x0100, 0x100);
+			uint64_t before = RAM->Digest();
+			uint64_t page = RAM->PageDigest(0x20);
+			CPU->Run();
+			Assert::IsFalse(before == RAM->Digest());
+			Assert::IsFalse(page == RAM->PageDigest(0x20));
+			// PHP changed the stack page too, the root only comes back once both pages are restored
+			RAM->Write(0x2000, "00"_6502);
+			Assert::IsTrue(page == RAM->PageDigest(0x20));
+			RAM->CopyIn(0x0100, stack, 0x100);
+			Assert::IsTrue(before == RAM->Digest());
+		}
+	};
+
+	TEST_CLASS(Files)
+	{
+	public:
+		TEST_METHOD_INITIALIZE(createCPU)
+		{
+			_method_initialize();
+		}
+
+		TEST_METHOD_CLEANUP(deleteCPU)
+		{
+			_method_cleanup();
+		}
+
+		TEST_METHOD(LOAD_BINARY_TAIL)
+		{
+			const char *filename = "emu6502test.bin";
+			FILE *file = fopen(filename, "wb");
+			for (int i = 0; i < 0x1234; i++)
+				fputc(0x11, file);
+			fclose(file);
+
+			// the bytes past the end of the file keep the fill value, up to the end of the host page and beyond
+			RAM->HardReset(0x77);
+			Assert::IsTrue(RAM->ReadFile(filename));
+			Assert::AreEqual(0x11, (int)(*RAM)[0x1233]);
+			Assert::AreEqual(0x77, (int)(*RAM)[0x1234]);
+			Assert::AreEqual(0x77, (int)(*RAM)[0x1FFF]);
+			Assert::AreEqual(0x77, (int)(*RAM)[0xFFFF]);
+			remove(filename);
+		}
+
+		TEST_METHOD(LOAD_BINARY)
+		{
+			const char *filename = "emu6502test.bin";
+			FILE *file = fopen(filename, "wb");
+			for (int i = 0; i < 0x1234; i++)
+				fputc(i & 0xFF, file);
+			fclose(file);
+
+			RAM->ClearDirtyPages();
+			Assert::IsTrue(RAM->ReadFile(filename));
+			Assert::AreEqual(0x33, (int)(*RAM)[0x1233]);
+			Assert::AreEqual(0x00, (int)(*RAM)[0x1000]);
+			// mapped pages are private to this instance
+			(*RAM)[0x0010] = 0xAA;
+			Memory *ram = new Memory();
+			Assert::IsTrue(ram->ReadFile(filename));
+			Assert::AreEqual(0x10, (int)(*ram)[0x0010]);
+			delete ram;
+			remove(filename);
+		}
+	
+
+		TEST_METHOD(LOAD_HEX)
+		{
+			const char *filename = "emu6502test.HEX";
+			FILE *file = fopen(filename, "wb");
+			fputs(":0300300002337A1E\r\n:020000040001F9\r\n:02100000ABCD76\r\n:00000001FF\r\n", file);
+			fclose(file);
+
+			Assert::IsTrue(RAM->ReadFile(filename));
+			Assert::AreEqual(0x02, (int)(*RAM)[0x0030]);
+			Assert::AreEqual(0x7A, (int)(*RAM)[0x0032]);
+			Assert::AreEqual(0xFF, (int)(*RAM)[0x0033]);
+			Assert::AreEqual(0xFF, (int)(*RAM)[0x1000]);
+			remove(filename);
+		}
+
+		TEST_METHOD(HEX_EXTENDED_ADDRESS)
+		{
+			Image image;
+			const char text[] = ":0300300002337A1E\n:020000040001F9\n:02100000ABCD76\n:020000021000EC\n:01FFFF00EE13\n:00000001FF\n";
+			Assert::IsTrue(image.ParseHex(text, strlen(text)));
+			Assert::AreEqual((size_t)2, image.BankCount());
+			Assert::AreEqual(0xAB, (int)image.FindBank(1)->Data[0x1000]);
+			Assert::AreEqual(0xEE, (int)image.FindBank(1)->Data[0xFFFF]);
+			Assert::AreEqual((size_t)3, image.Segments.size());
+			Assert::IsTrue(image.FindBank(2) == nullptr);
+		}
+
+		TEST_METHOD(HEX_ERRORS)
+		{
+			Image image;
+			LoadError error;
+			const char checksum[] = ":0300300002337A1E\n\n:0300300002337A1F\n";
+			const char digit[] = ":0300300002G37A1E\n:00000001FF\n";
+			const char missing[] = ":0300300002337A1E\n";
+
+			Assert::IsFalse(image.ParseHex(checksum, strlen(checksum), &error));
+			Assert::AreEqual(3, error.Line);
+			Assert::AreEqual(16, error.Column);
+			Assert::IsFalse(image.ParseHex(digit, strlen(digit), &error));
+			Assert::AreEqual(1, error.Line);
+			Assert::AreEqual(12, error.Column);
+			Assert::IsFalse(image.ParseHex(missing, strlen(missing), &error));
+			Assert::AreEqual(2, error.Line);
+		}
+	
+
+		TEST_METHOD(HEX_CACHE)
+		{
+			const char *filename = "emu6502test_cache.hex";
+			FILE *file = fopen(filename, "wb");
+			fputs(":0300300002337A1E\n:020000040001F9\n:02100000ABCD76\n:00000001FF\n", file);
+			fclose(file);
+
+			Image *image = new Image();
+			Assert::IsTrue(image->ReadHex(filename, nullptr, ""));
+			Assert::IsTrue(image->CacheFile() == nullptr);
+			delete image;
+
+			image = new Image();
+			Assert::IsTrue(image->ReadHex(filename, nullptr, ""));
+			Assert::IsFalse(image->CacheFile() == nullptr);
+			Assert::AreEqual((size_t)2, image->Segments.size());
+			Assert::AreEqual(0xAB, (int)image->FindBank(1)->Data[0x1000]);
+			Assert::IsTrue(RAM->Load(*image));
+			Assert::AreEqual(0x7A, (int)(*RAM)[0x0032]);
+			(*RAM)[0x0032] = 0x12;
+			Assert::AreEqual(0x7A, (int)image->FindBank(0)->Data[0x0032]);
+			delete image;
+
+			// the cache is rebuilt when the source changes
+			file = fopen(filename, "wb");
+			fputs(":0300300002337B1D\n:00000001FF\n", file);
+			fclose(file);
+			image = new Image();
+			Assert::IsTrue(image->ReadHex(filename, nullptr, ""));
+			Assert::IsTrue(image->CacheFile() == nullptr);
+			Assert::AreEqual(0x7B, (int)image->FindBank(0)->Data[0x0032]);
+			delete image;
+
+			remove(filename);
+			remove("emu6502test_cache.hex.cache");
+		}
+	};
+
+	TEST_CLASS(Literal)
+	{
+	public:
+		TEST_METHOD_INITIALIZE(createCPU)
+		{
+			_method_initialize();
+		}
+
+		TEST_METHOD_CLEANUP(deleteCPU)
+		{
+			_method_cleanup();
+		}
+
+		TEST_METHOD(LIT_BYTES)
+		{
+			constexpr auto code = "A9D5 8d 00 20"_6502;
+			static_assert(code.Length == 5, "wrong literal length");
+			static_assert(code.Bytes[1] == 0xD5, "wrong literal value");
+			static_assert(code.Bytes[2] == 0x8D, "wrong literal value");
+			static_assert(""_6502.Length == 0, "wrong literal length");
+		}
+
+		TEST_METHOD(LIT_SAME_AS_TEXT)
+		{
+			RAM->Write(0x3000, "A9 D5 8D 00 20", true);
+			RAM->Write(0x4000, "A9 D5 8D 00 20"_6502, true);
+			Assert::AreEqual(0, memcmp(RAM->Pointer(0x3000), RAM->Pointer(0x4000), 6));
+			Assert::AreEqual(0x4005, (int)RAM->WriteCounter);
+		}
+
+		TEST_METHOD(LIT_WRAP_AROUND)
+		{
+			RAM->Write(0xFFFF, "12 34"_6502);
+			Assert::AreEqual(0x12, (int)(*RAM)[0xFFFF]);
+			Assert::AreEqual(0x34, (int)(*RAM)[0x0000]);
+			Assert::AreEqual(0x0001, (int)RAM->WriteCounter);
+		}
+	};
+
+	TEST_CLASS(Bulk)
+	{
+	public:
+		TEST_METHOD_INITIALIZE(createCPU)
+		{
+			_method_initialize();
+		}
+
+		TEST_METHOD_CLEANUP(deleteCPU)
+		{
+			_method_cleanup();
+		}
+
+		TEST_METHOD(BULK_COPY)
+		{
+			byte in[0x300], out[0x300];
+
+			for (int i = 0; i < 0x300; i++)
+				in[i] = (byte)(i * 7);
+
+			RAM->ClearDirtyPages();
+			RAM->CopyIn(0x2080, in, sizeof(in));
+			RAM->CopyOut(out, 0x2080, sizeof(out));
+			Assert::AreEqual(0, memcmp(in, out, sizeof(in)));
+			Assert::AreEqual(0x0E, (int)(*RAM)[0x2082]);
+
+			uint64_t pages[4];
+			RAM->ReadDirtyPages(pages);
+			Assert::AreEqual(0xFULL, pages[0] >> 0x20);
+		}
+
+		TEST_METHOD(BULK_WRAP_AROUND)
+		{
+			byte in[4] = { 1, 2, 3, 4 }, out[4];
+
+			RAM->CopyIn(0xFFFE, in);
+			Assert::AreEqual(0x03, (int)(*RAM)[0x0000]);
+			RAM->CopyOut(out, 0xFFFE);
+			Assert::AreEqual(0, memcmp(in, out, sizeof(in)));
+		}
+
+		TEST_METHOD(BULK_FILL)
+		{
+			RAM->ClearDirtyPages();
+			RAM->Fill(0xFF00, 0xEA, 0x200);
+
+			const Memory &memory = *RAM;
+			Assert::AreEqual(0xEA, (int)memory[0xFFFF]);
+			Assert::AreEqual(0xEA, (int)memory[0x00FF]);
+			Assert::AreEqual(0x00, (int)memory[0x0100]);
+
+			uint64_t pages[4];
+			RAM->ReadDirtyPages(pages);
+			Assert::AreEqual(1ULL, pages[0]);
+			Assert::AreEqual(1ULL << 63, pages[3]);
+		}
+
+		TEST_METHOD(BULK_VIEW)
+		{
+			RAM->Write(0x3000, "A9 D5"_6502);
+			auto view = ((const Memory *)RAM)->View(0x3000, 2);
+			Assert::AreEqual((size_t)2, view.size());
+			Assert::AreEqual(0xD5, (int)view[1]);
+			Assert::IsTrue(RAM->View(0xFFFF, 2).empty());
+
+			RAM->ClearDirtyPages();
+			auto span = RAM->Span(0x4000, 0x100);
+			span[0x80] = 0x42;
+			Assert::AreEqual(0x42, (int)(*RAM)[0x4080]);
+
+			uint64_t pages[4];
+			RAM->ReadDirtyPages(pages);
+			Assert::AreEqual(1ULL, pages[1]);
+		}
+	};
+
+	TEST_CLASS(Dump)
+	{
+	public:
+		TEST_METHOD_INITIALIZE(createCPU)
+		{
+			_method_initialize();
+		}
+
+		TEST_METHOD_CLEANUP(deleteCPU)
+		{
+			_method_cleanup();
+		}
+
+		TEST_METHOD(DUMP_HEX)
+		{
+			char buffer[200];
+
+			RAM->Write(0x0300, "A9 D5 8D 00 20"_6502);
+			size_t size = RAM->Dump(buffer, sizeof(buffer), 0x0300, 18, dHex);
+			Assert::AreEqual((size_t)(54 + 12), size);
+			Assert::AreEqual(0, memcmp(buffer, "0300: A9 D5 8D 00 20 00 00 00 00 00 00 00 00 00 00 00\n0310: 00 00\n", size));
+			Assert::AreEqual("A9 D5 8D ", RAM->Read(buffer, 0x0300, 3));
+		}
+
+		TEST_METHOD(DUMP_WRAP_AROUND)
+		{
+			char buffer[200];
+
+			RAM->Write(0xFFFE, "12 34 56"_6502);
+			size_t size = RAM->Dump(buffer, sizeof(buffer), 0xFFFE, 3, dHex);
+			Assert::AreEqual(0, memcmp(buffer, "FFFE: 12 34\n0000: 56\n", size));
+			Assert::AreEqual((size_t)3, RAM->Dump(buffer, sizeof(buffer), 0xFFFE, 3, 0));
+			Assert::AreEqual(0x56, (int)(byte)buffer[2]);
+			Assert::AreEqual("12 34 56 ", RAM->Read(buffer, 0xFFFE, 3));
+		}
+
+		TEST_METHOD(DUMP_CAPACITY)
+		{
+			char buffer[100];
+
+			// only whole lines are written
+			Assert::AreEqual((size_t)54, RAM->Dump(buffer, sizeof(buffer), 0x0000, 0x100, dHex));
+			Assert::IsTrue(Memory::DumpCapacity(0x10000, dHex) >= 0x1000 * 54);
+		}
+
+		TEST_METHOD(DUMP_SKIP)
+		{
+			char *buffer = new char[Memory::DumpCapacity(0x10000, dHex)];
+
+			RAM->Fill(0x0000, 0xFF, 0x10000);
+			RAM->ClearDirtyPages();
+			RAM->Write(0x2010, "EA"_6502, false);
+			RAM->Write(0x4000, "FF"_6502, false);
+
+			// page $20 and $40 are dirty, only $20 doesn't hold the fill byte only
+			size_t size = RAM->Dump(buffer, Memory::DumpCapacity(0x10000, dHex), 0x0000, 0x10000, dHex | dSkipClean);
+			Assert::AreEqual((size_t)(32 * 54), size);
+			size = RAM->Dump(buffer, Memory::DumpCapacity(0x10000, dHex), 0x0000, 0x10000, dHex | dSkipClean | dSkipFilled, 0xFF);
+			Assert::AreEqual((size_t)(16 * 54), size);
+			Assert::AreEqual(0, memcmp(buffer + 54, "2010: EA FF", 11));
+			delete[] buffer;
+		}
+	};
+
+	TEST_CLASS(Pools)
+	{
+	public:
+		TEST_METHOD(POOL_ACQUIRE)
+		{
+			Pool pool(3);
+			Assert::IsTrue(pool.IsOpen());
+
+			Machine *a = pool.Acquire();
+			Machine *b = pool.Acquire();
+			Machine *c = pool.Acquire();
+			Assert::IsTrue(pool.Acquire() == nullptr);
+			Assert::AreEqual((size_t)0, pool.Available());
+
+			// 64 byte aligned objects, page aligned memory
+			Assert::AreEqual((size_t)0, (size_t)a % 64);
+			Assert::AreEqual((size_t)0, (size_t)b->RAM.Pointer(0) % 0x10000);
+			Assert::IsTrue(a != b && b != c && a->RAM.Pointer(0) != c->RAM.Pointer(0));
+		}
+
+		TEST_METHOD(POOL_RECYCLE)
+		{
+			Pool pool(1);
+			Machine *machine = pool.Acquire();
+
+			machine->RAM[0xFFFC] = 0x00;
+			machine->RAM[0xFFFD] = 0x10;
+			machine->RAM.Write(0x1000, "A9 D5 8D 00 20"_6502);
+			machine->CPU.EndOnBreak = true;
+			machine->CPU.SendRST();
+			machine->CPU.Step();
+			machine->CPU.Run();
+			Assert::AreEqual(0xD5, (int)machine->RAM[0x2000]);
+
+			pool.Release(machine);
+			Assert::AreEqual((size_t)1, pool.Available());
+			Assert::IsTrue(pool.Acquire() == machine);
+			Assert::AreEqual(0x00, (int)machine->RAM[0x2000]);
+			Assert::AreEqual(0x00, (int)machine->CPU.A);
+			Assert::AreEqual(0x0000, (int)machine->CPU.PC);
+		}
+	};
+
+	TEST_CLASS(HardReset)
+	{
+	public:
+		TEST_METHOD_INITIALIZE(createCPU)
+		{
+			_method_initialize();
+		}
+
+		TEST_METHOD_CLEANUP(deleteCPU)
+		{
+			_method_cleanup();
+		}
+
+		TEST_METHOD(RESET_MEMORY)
+		{
+			Memory *fresh = new Memory();
+
+			RAM->Write("A9 D5 8D 00 20 A2 03"_6502);
+			CPU->Run();
+			CPU->HardReset();
+
+			Assert::AreEqual(0x00, (int)CPU->A);
+			Assert::AreEqual(0x00, (int)CPU->X);
+			Assert::AreEqual(0x0000, (int)CPU->PC);
+			Assert::AreEqual(0, memcmp(RAM->Pointer(0), fresh->Pointer(0), 0x10000));
+			Assert::IsTrue(RAM->Digest() == fresh->Digest());
+
+			uint64_t pages[4];
+			RAM->ReadDirtyPages(pages);
+			Assert::AreEqual(0ULL, pages[0] | pages[1] | pages[2] | pages[3]);
+			delete fresh;
+		}
+
+		TEST_METHOD(RESET_FILL)
+		{
+			RAM->Write(0x3000, "EA"_6502);
+			CPU->HardReset(0xFF);
+			Assert::AreEqual(0xFF, (int)(*RAM)[0x3000]);
+			Assert::AreEqual(0xFF, (int)(*RAM)[0x3001]);
+			Assert::AreEqual(0xFF, (int)(*RAM)[0x8000]);
+
+			RAM->Write(0x3000, "EA"_6502);
+			CPU->HardReset(0xFF);
+			Assert::AreEqual(0xFF, (int)(*RAM)[0x3000]);
+			CPU->HardReset(0x00);
+			Assert::AreEqual(0x00, (int)(*RAM)[0x8000]);
+		}
+
+		TEST_METHOD(RESET_MAPPED)
+		{
+			const char *filename = "emu6502test.bin";
+			FILE *file = fopen(filename, "wb");
+			for (int i = 0; i < 0x2000; i++)
+				fputc(0x55, file);
+			fclose(file);
+
+			Assert::IsTrue(RAM->ReadFile(filename));
+			Assert::AreEqual(0x55, (int)(*RAM)[0x1FFF]);
+			CPU->HardReset();
+			Assert::AreEqual(0x00, (int)(*RAM)[0x1FFF]);
+			Assert::AreEqual(0x00, (int)(*RAM)[0x0000]);
+			// the remapped pages aren't written to but they count as changed for the digest
+			Memory fresh;
+			Assert::IsTrue(RAM->Digest() == fresh.Digest());
+			// with a fill byte they are written over
+			Assert::IsTrue(RAM->ReadFile(filename));
+			CPU->HardReset(0x33);
+			Assert::AreEqual(0x33, (int)(*RAM)[0x1FFF]);
+			Assert::AreEqual(0x33, (int)(*RAM)[0xFFFF]);
+			remove(filename);
+		}
+	};
+
+	TEST_CLASS(Jobs)
+	{
+	public:
+		TEST_METHOD(JOB_MANIFEST)
+		{
+			const char text[] = "# comment\n\nid=a image=x.bin entry=0400 budget=500 input=0200:A9D5 output=0300:10 stop=0450 fill=FF\r\nimage=y.hex\n";
+			std::vector<Job> jobs;
+
+			Assert::IsTrue(ParseManifest(text, sizeof(text) - 1, jobs));
+			Assert::AreEqual((size_t)2, jobs.size());
+			Assert::AreEqual(0x0400, jobs[0].Entry);
+			Assert::AreEqual(0x0450, jobs[0].Stop);
+			Assert::AreEqual((uint64_t)500, jobs[0].Budget);
+			Assert::AreEqual(0xFF, (int)jobs[0].Fill);
+			Assert::AreEqual((size_t)2, jobs[0].Inputs[0].Data.size());
+			Assert::AreEqual(0xD5, (int)jobs[0].Inputs[0].Data[1]);
+			Assert::AreEqual((size_t)0x10, jobs[0].Outputs[0].Data.size());
+			Assert::AreEqual(-1, jobs[1].Entry);
+			Assert::IsTrue(jobs[1].Id == "1");
+		}
+
+		TEST_METHOD(JOB_MANIFEST_ERRORS)
+		{
+			std::vector<Job> jobs;
+			LoadError error;
+
+			Assert::IsFalse(ParseManifest("image=a.bin\nimage=b.bin entry=10000\n", 36, jobs, &error));
+			Assert::AreEqual(2, error.Line);
+			Assert::AreEqual(13, error.Column);
+			Assert::IsFalse(ParseManifest("entry=0400\n", 11, jobs, &error));
+			Assert::IsFalse(ParseManifest("image=a.bin input=0200:ABC\n", 27, jobs, &error));
+			Assert::IsFalse(ParseManifest("image=a.bin speed=2\n", 20, jobs, &error));
+		}
+
+		TEST_METHOD(JOB_RUN)
+		{
+			const char *filename = "emu6502test.bin";
+			FILE *file = fopen(filename, "wb");
+			// LDA $0200, ASL A, STA $0300, BRK at $0400
+			const auto code = "AD 00 02 0A 8D 00 03 00"_6502;
+			for (int i = 0; i < 0x400; i++)
+				fputc(0, file);
+			fwrite(code.Bytes, 1, code.Length, file);
+			fclose(file);
+
+			std::vector<Job> jobs;
+			std::string manifest;
+			for (int i = 0; i < 100; i++)
+			{
+				char line[100];
+				snprintf(line, sizeof(line), "id=j%d image=%s entry=0400 input=0200:%02X output=0300:1\n", i, filename, i);
+				manifest += line;
+			}
+			Assert::IsTrue(ParseManifest(manifest.data(), manifest.size(), jobs));
+
+			std::vector<std::string> lines;
+			JobRunner runner(4);
+			runner.Run(jobs, [&](const char *Line, size_t Length) { lines.push_back(std::string(Line, Length)); });
+
+			Assert::AreEqual((size_t)100, lines.size());
+			int found = 0;
+			for (const std::string &line : lines)
+			{
+				if (line.find("\"id\":\"j33\"") != std::string::npos)
+				{
+					Assert::IsTrue(line.find("\"stop\":\"break\"") != std::string::npos);
+					Assert::IsTrue(line.find("\"outputs\":{\"0300\":\"42\"}") != std::string::npos);
+					found++;
+				}
+			}
+			Assert::AreEqual(1, found);
+			Assert::IsTrue(runner.Cycles > 100 * 10);
+			remove(filename);
+		}
+
+		TEST_METHOD(JOB_RUN_HEX_FILL)
+		{
+			const char *filename = "emu6502test_fill.hex";
+			FILE *file = fopen(filename, "wb");
+			// LDA $0500, STA $0300, BRK at $0400, $0500 isn't in the image
+			fputs(":07040000AD00058D000300B3\n:00000001FF\n", file);
+			fclose(file);
+
+			std::vector<Job> jobs;
+			const char manifest[] = "id=a image=emu6502test_fill.hex entry=0400 output=0300:1 fill=77\n";
+			Assert::IsTrue(ParseManifest(manifest, sizeof(manifest) - 1, jobs));
+
+			std::vector<std::string> lines;
+			JobRunner runner(1);
+			runner.Run(jobs, [&](const char *Line, size_t Length) { lines.push_back(std::string(Line, Length)); });
+
+			Assert::AreEqual((size_t)1, lines.size());
+			Assert::IsTrue(lines[0].find("\"outputs\":{\"0300\":\"77\"}") != std::string::npos);
+			remove(filename);
+		}
+	};
+
+	TEST_CLASS(Lockstep)
+	{
+	public:
+		// runs every reference machine with Processor::Run(Cycles) and checks that the lanes ended up the same
+		void AssertSameAsProcessor(::Lockstep &Lanes, Machine *Reference[], StopReasons Reasons[], int Count)
+		{
+			for (int i = 0; i < Count; i++)
+			{
+				Processor &cpu = Reference[i]->CPU;
+				uint64_t expected[4], actual[4];
+
+				Assert::AreEqual((int)Reasons[i], (int)Lanes.Reason[i]);
+				Assert::AreEqual((int)cpu.A, (int)Lanes.A[i]);
+				Assert::AreEqual((int)cpu.X, (int)Lanes.X[i]);
+				Assert::AreEqual((int)cpu.Y, (int)Lanes.Y[i]);
+				Assert::AreEqual((int)cpu.S, (int)Lanes.S[i]);
+				Assert::AreEqual((int)cpu.P, (int)Lanes.P[i]);
+				Assert::AreEqual((int)cpu.PC, (int)Lanes.PC[i]);
+				Assert::AreEqual(cpu.Clock, Lanes.Clock[i]);
+				Assert::IsTrue(Reference[i]->RAM.Digest() == Lanes.Lane(i)->Digest());
+				Reference[i]->RAM.ReadDirtyPages(expected);
+				Lanes.Lane(i)->ReadDirtyPages(actual);
+				Assert::AreEqual(0, memcmp(expected, actual, sizeof(expected)));
+			}
+		}
+
+		TEST_METHOD(LOCKSTEP_PROGRAM)
+		{
+			// $12/$13 = $10 * $11 (shift and add), then BCD sum of both bytes in a subroutine,
+			// stored at ($20),Y
+			const auto code =
+				"A9 00 85 13 A2 08 46 10 90 03 18 65 11 6A 66 13 CA D0 F3 85 12 20 30 04 A4 14 91 20 48 68 00"_6502;
+			const auto subroutine = "F8 18 A5 12 65 13 D8 60"_6502;
+			Pool pool(2 * ::Lockstep::Width);
+			::Lockstep lanes;
+			Machine *reference[::Lockstep::Width];
+			StopReasons reasons[::Lockstep::Width];
+
+			lanes.EndOnBreak = true;
+			for (int i = 0; i < ::Lockstep::Width; i++)
+			{
+				Machine *lane = pool.Acquire();
+				reference[i] = pool.Acquire();
+
+				for (Machine *machine : {lane, reference[i]})
+				{
+					machine->RAM.Write(0x0400, code);
+					machine->RAM.Write(0x0430, subroutine);
+					machine->RAM[0x10] = (byte)(i * 17);
+					machine->RAM[0x11] = (byte)(255 - i * 13);
+					machine->RAM[0x14] = (byte)i;
+					machine->RAM[0x21] = 0x03;
+					machine->CPU.PC = 0x0400;
+					machine->CPU.S = 0xFF;
+					machine->CPU.EndOnBreak = true;
+				}
+				lanes.Attach(i, &lane->RAM);
+				Assert::IsTrue(lanes.Import(i, lane->CPU));
+				reasons[i] = reference[i]->CPU.Run(100000);
+			}
+
+			lanes.Run(100000);
+			AssertSameAsProcessor(lanes, reference, reasons, ::Lockstep::Width);
+			for (int i = 0; i < ::Lockstep::Width; i++)
+				Assert::AreEqual((int)srBreak, (int)lanes.Reason[i]);
+			// the lanes split on BCC and came back together
+			Assert::IsTrue(lanes.Groups < lanes.Instructions);
+			Assert::IsTrue(lanes.Groups > lanes.Instructions / ::Lockstep::Width);
+		}
+
+		TEST_METHOD(LOCKSTEP_RANDOM)
+		{
+			// random code shared by all the lanes, random zero page, stack and registers in each lane
+			// every byte is a legal opcode so that the lanes don't stop on the first illegal one
+			Pool pool(2 * ::Lockstep::Width);
+			std::vector<byte> legal;
+			Machine *reference[::Lockstep::Width];
+			Machine *machines[::Lockstep::Width];
+			StopReasons reasons[::Lockstep::Width];
+			std::vector<byte> code(0x10000);
+			uint32_t seed = 6502;
+			auto random = [&]() { seed = seed * 1664525 + 1013904223; return (byte)(seed >> 24); };
+
+			for (int i = 0; i < ::Lockstep::Width; i++)
+			{
+				machines[i] = pool.Acquire();
+				reference[i] = pool.Acquire();
+			}
+			for (int i = 0; i < 256; i++)
+			{
+				machines[0]->RAM[0x0400] = (byte)i;
+				machines[0]->CPU.PC = 0x0400;
+				if (machines[0]->CPU.Run(1) != srIllegal)
+					legal.push_back((byte)i);
+			}
+			Assert::AreEqual((size_t)151, legal.size());
+
+			for (int round = 0; round < 50; round++)
+			{
+				::Lockstep lanes;
+				lanes.EndOnBreak = round & 1;
+				lanes.Breakpoint = round % 3 ? -1 : 0x0400 + random();
+
+				for (byte &value : code)
+					value = legal[random() % legal.size()];
+				for (int i = 0; i < ::Lockstep::Width; i++)
+				{
+					byte registers[6];
+
+					for (byte &value : registers)
+						value = random();
+					for (int j = 0; j < 0x200; j++)
+						code[j] = legal[random() % legal.size()];
+					for (Machine *machine : {machines[i], reference[i]})
+					{
+						machine->RAM.CopyIn(0x0000, code.data(), code.size());
+						machine->RAM.ClearDirtyPages();
+						machine->CPU.A = registers[0];
+						machine->CPU.X = registers[1];
+						machine->CPU.Y = registers[2];
+						machine->CPU.S = registers[3];
+						machine->CPU.P = registers[4];
+						machine->CPU.PC = 0x0400 + registers[5];
+						machine->CPU.Clock = 0;
+						machine->CPU.EndOnBreak = lanes.EndOnBreak;
+						machine->CPU.Breakpoint = lanes.Breakpoint;
+					}
+					lanes.Attach(i, &machines[i]->RAM);
+					Assert::IsTrue(lanes.Import(i, machines[i]->CPU));
+					reasons[i] = reference[i]->CPU.Run(2000);
+				}
+
+				lanes.Run(2000);
+				AssertSameAsProcessor(lanes, reference, reasons, ::Lockstep::Width);
+			}
+		}
+
+		TEST_METHOD(LOCKSTEP_UNUSED_LANES)
+		{
+			Memory memory;
+			::Lockstep lanes;
+			Processor cpu(&memory);
+
+			// INX, BNE -1: loops 256 times, then LDA #$D5 and an illegal opcode
+			memory.Write(0x1000, "E8 D0 FD A9 D5 02"_6502);
+			memory[0xFFFC] = 0x00;
+			memory[0xFFFD] = 0x10;
+			lanes.Attach(3, &memory);
+			lanes.Reset(3);
+			lanes.Run(100000);
+
+			Assert::AreEqual((int)srIllegal, (int)lanes.Reason[3]);
+			Assert::AreEqual((uint64_t)(256 * 2 + 1), lanes.Groups);
+			Assert::AreEqual(lanes.Groups, lanes.Instructions);
+			lanes.Export(3, cpu);
+			Assert::AreEqual(0xD5, (int)cpu.A);
+			Assert::AreEqual(0x1005, (int)cpu.PC);
+			Assert::AreEqual(256 * (4 + 3) - 1 + 2, cpu.Clock);
+		}
+
+		TEST_METHOD(LOCKSTEP_BREAKPOINTS_HOOKS)
+		{
+			// JSR $0500 (hooked: A = $42 instead of $11), INX, then a bit in Breakpoints
+			uint64_t breakpoints[1024] = {};
+			HookTable hooks;
+			Memory memory[2], reference;
+			Processor cpu(&reference);
+			::Lockstep lanes;
+
+			breakpoints[0x0404 >> 6] |= 1ull << (0x0404 & 63);
+			hooks.Add(0x0500, [](Processor &CPU, Memory &) { CPU.A = 0x42; return true; }, 10);
+			for (Memory *ram : {&memory[0], &memory[1], &reference})
+			{
+				ram->Write(0x0400, "20 00 05 E8 EA 00"_6502);
+				ram->Write(0x0500, "A9 11 60"_6502);
+			}
+			cpu.PC = 0x0400;
+			cpu.S = 0xFF;
+			cpu.Breakpoints = breakpoints;
+			cpu.Hooks = &hooks;
+			lanes.Breakpoints = breakpoints;
+			lanes.Hooks = &hooks;
+			for (int i = 0; i < 2; i++)
+			{
+				lanes.Attach(i, &memory[i]);
+				Assert::IsTrue(lanes.Import(i, cpu));
+			}
+
+			Assert::AreEqual((int)srBreakpoint, (int)cpu.Run(1000));
+			lanes.Run(1000);
+			for (int i = 0; i < 2; i++)
+			{
+				Assert::AreEqual((int)srBreakpoint, (int)lanes.Reason[i]);
+				Assert::AreEqual(0x42, (int)lanes.A[i]);
+				Assert::AreEqual(0x0404, (int)lanes.PC[i]);
+				Assert::AreEqual(cpu.Clock, lanes.Clock[i]);
+			}
+			Assert::AreEqual(0x42, (int)cpu.A);
+		}
+
+		TEST_METHOD(LOCKSTEP_IMPORT_PENDING)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			::Lockstep lanes;
+
+			lanes.Attach(0, &memory);
+			cpu.SendIRQ();
+			Assert::IsFalse(lanes.Import(0, cpu));
+			cpu.Step();
+			Assert::IsTrue(lanes.Import(0, cpu));
+			cpu.SendNMI();
+			Assert::IsFalse(lanes.Import(0, cpu));
+		}
+	};
+
+	TEST_CLASS(Schedulers)
+	{
+	public:
+		TEST_METHOD(SCHEDULER_ROUND_ROBIN)
+		{
+			Pool pool(3);
+			Scheduler scheduler(1000);
+
+			// INC $0200, JMP $0400
+			for (int i = 0; i < 3; i++)
+			{
+				Machine *machine = pool.Acquire();
+
+				machine->RAM.Write(0x0400, "EE 00 02 4C 00 04"_6502);
+				machine->CPU.PC = 0x0400;
+				Assert::AreEqual(i, scheduler.Add(machine));
+			}
+
+			for (int i = 0; i < 30; i++)
+				Assert::IsTrue(scheduler.Step());
+
+			Assert::AreEqual((uint64_t)30, scheduler.Switches);
+			Assert::AreEqual((size_t)3, scheduler.ReadyCount());
+			for (int i = 0; i < 3; i++)
+			{
+				const TaskStatistics &statistics = scheduler.Statistics(i);
+
+				Assert::AreEqual((int)tsReady, (int)scheduler.State(i));
+				Assert::AreEqual((uint64_t)10, statistics.Slices);
+				// slices end with the instruction crossing the quantum, 6 cycles at most
+				Assert::IsTrue(statistics.Cycles >= 10 * 1000 && statistics.Cycles < 10 * 1006);
+				Assert::AreEqual((uint64_t)0, statistics.Parks);
+			}
+			Assert::IsTrue(scheduler.Fairness() > 0.5);
+		}
+
+		TEST_METHOD(SCHEDULER_CLOCK_REBASE)
+		{
+			Pool pool(1);
+			Scheduler scheduler(1000);
+			Machine *machine = pool.Acquire();
+
+			// INC $0200, JMP $0400, a clock about to overflow
+			machine->RAM.Write(0x0400, "EE 00 02 4C 00 04"_6502);
+			machine->CPU.PC = 0x0400;
+			machine->CPU.Clock = 0x7FFFFFF0;
+			scheduler.Add(machine);
+
+			Assert::IsTrue(scheduler.Step());
+			Assert::IsTrue(scheduler.Step());
+			Assert::IsTrue(machine->CPU.Clock >= 2 * 1000 && machine->CPU.Clock < 2 * 1006);
+			Assert::AreEqual((uint64_t)machine->CPU.Clock, scheduler.Statistics(0).Cycles);
+		}
+
+		TEST_METHOD(SCHEDULER_IDLE)
+		{
+			Pool pool(1);
+			Scheduler scheduler;
+			Machine *machine = pool.Acquire();
+
+			// LDA #$01, STA $0200, JMP *, the interrupt handler does INC $0201, RTI
+			machine->RAM.Write(0x0400, "A9 01 8D 00 02 4C 05 04"_6502);
+			machine->RAM.Write(0x0500, "EE 01 02 40"_6502);
+			machine->RAM[0xFFFE] = 0x00;
+			machine->RAM[0xFFFF] = 0x05;
+			machine->CPU.PC = 0x0400;
+			scheduler.Add(machine);
+
+			Assert::IsTrue(scheduler.Step());
+			Assert::AreEqual((int)tsIdle, (int)scheduler.State(0));
+			Assert::AreEqual((int)srLoop, (int)scheduler.Reason(0));
+			Assert::AreEqual(0x01, (int)machine->RAM[0x0200]);
+			Assert::IsFalse(scheduler.Step());
+
+			scheduler.SendIRQ(0);
+			Assert::IsTrue(scheduler.Wait(0));
+			Assert::IsTrue(scheduler.Step());
+			Assert::AreEqual((int)tsIdle, (int)scheduler.State(0));
+			Assert::AreEqual(0x01, (int)machine->RAM[0x0201]);
+			Assert::AreEqual((uint64_t)2, scheduler.Statistics(0).Parks);
+			Assert::IsFalse(scheduler.Wait(0));
+		}
+
+		TEST_METHOD(SCHEDULER_INPUT)
+		{
+			Pool pool(1);
+			Scheduler scheduler;
+			Machine *machine = pool.Acquire();
+
+			// reads 3 bytes with JSR $F000 and stores them at $0300, $F000 is LDA $D000, RTS
+			machine->RAM.Write(0x0400, "A2 00 20 00 F0 9D 00 03 E8 E0 03 D0 F5 00"_6502);
+			machine->RAM.Write(0xF000, "AD 00 D0 60"_6502);
+			machine->CPU.PC = 0x0400;
+			machine->CPU.EndOnBreak = true;
+			scheduler.Add(machine, 0xF000, 0xD000);
+
+			Assert::IsTrue(scheduler.Step());
+			Assert::AreEqual((int)tsBlocked, (int)scheduler.State(0));
+			Assert::IsFalse(scheduler.Step());
+
+			scheduler.Deliver(0, (const byte *)"AB", 2);
+			Assert::IsTrue(scheduler.Step());
+			Assert::AreEqual((int)tsBlocked, (int)scheduler.State(0));
+			Assert::AreEqual((int)'A', (int)machine->RAM[0x0300]);
+			Assert::AreEqual((int)'B', (int)machine->RAM[0x0301]);
+
+			// nothing to read yet
+			scheduler.Wake(0);
+			Assert::IsTrue(scheduler.Step());
+			Assert::AreEqual((int)tsBlocked, (int)scheduler.State(0));
+
+			scheduler.Deliver(0, (const byte *)"C", 1);
+			Assert::IsTrue(scheduler.Step());
+			Assert::AreEqual((int)tsStopped, (int)scheduler.State(0));
+			Assert::AreEqual((int)srBreak, (int)scheduler.Reason(0));
+			Assert::AreEqual((int)'C', (int)machine->RAM[0x0302]);
+			Assert::AreEqual((uint64_t)3, scheduler.Statistics(0).Parks);
+			Assert::IsFalse(scheduler.Step());
+		}
+	};
+
+	// fire and forget coroutine for the co_await test
+	struct Detached
+	{
+		struct promise_type
+		{
+			Detached get_return_object() { return {}; }
+			std::suspend_never initial_suspend() { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() {}
+		};
+	};
+
+	Detached CollectOutput(RunThread &Thread, std::string &Output, Event &Last, bool &Done)
+	{
+		while (true)
+		{
+			Event event = co_await Thread.NextEvent();
+
+			if (event.Kind != eOutput)
+			{
+				Last = event;
+				Done = true;
+				co_return;
+			}
+			Output += (char)event.Value;
+		}
+	}
+
+	TEST_CLASS(RunThreads)
+	{
+	public:
+		// waits up to a second for the next event
+		Event NextEvent(RunThread &Thread)
+		{
+			Event event = {};
+
+			Assert::IsTrue(Thread.WaitEvent(1000));
+			Assert::IsTrue(Thread.Poll(event));
+			return event;
+		}
+
+		TEST_METHOD(RING_ORDER)
+		{
+			Ring<int, 64> *ring = new Ring<int, 64>();
+			const int count = 100000;
+			std::thread producer([&]() {
+				for (int i = 0; i < count; i++)
+				{
+					while (!ring->Push(i))
+						std::this_thread::yield();
+				}
+			});
+			int value, expected = 0;
+
+			while (expected < count)
+			{
+				if (ring->Pop(value))
+					Assert::AreEqual(expected++, value);
+				else
+					std::this_thread::yield();
+			}
+			producer.join();
+			Assert::IsFalse(ring->Pop(value));
+			delete ring;
+		}
+
+		TEST_METHOD(RUNTHREAD_OUTPUT)
+		{
+			Pool pool(1);
+			Machine *machine = pool.Acquire();
+
+			// prints "HI" through the output routine at $FFD2 (RTS)
+			machine->RAM.Write(0x0400, "A9 48 20 D2 FF A9 49 20 D2 FF 00"_6502);
+			machine->RAM.Write(0xFFD2, "60"_6502);
+			machine->CPU.PC = 0x0400;
+			machine->CPU.EndOnBreak = true;
+			RunThread thread(machine, 0xFFD2);
+
+			Assert::IsFalse(thread.WaitEvent(0));
+			Assert::IsTrue(thread.Send(cRun));
+			Event event = NextEvent(thread);
+			Assert::AreEqual((int)eOutput, (int)event.Kind);
+			Assert::AreEqual((int)'H', (int)event.Value);
+			event = NextEvent(thread);
+			Assert::AreEqual((int)'I', (int)event.Value);
+			event = NextEvent(thread);
+			Assert::AreEqual((int)eStopped, (int)event.Kind);
+			Assert::AreEqual((int)srBreak, (int)event.Reason);
+			Assert::AreEqual(0x040B, (int)event.PC);
+			Assert::AreEqual((uint64_t)0, thread.Dropped.load());
+		}
+
+		TEST_METHOD(RUNTHREAD_COMMANDS)
+		{
+			Pool pool(1);
+			Machine *machine = pool.Acquire();
+
+			machine->RAM.Write(0x0400, "4C 00 04"_6502);	// JMP *
+			machine->CPU.PC = 0x0400;
+			machine->CPU.EndOnBreak = true;
+			RunThread thread(machine);
+
+			Assert::IsTrue(thread.Send(cRun));
+			Event event = NextEvent(thread);
+			Assert::AreEqual((int)eIdle, (int)event.Kind);
+			Assert::AreEqual(0x0400, (int)event.PC);
+
+			// interrupt handler at $0500: LDA #$D5, LDX #$01, BRK
+			const auto handler = "A9 D5 A2 01 00"_6502;
+			const byte vector[] = {0x00, 0x05};
+			Assert::IsTrue(thread.Patch(0x0500, handler.Bytes, handler.Length));
+			Assert::IsTrue(thread.Patch(0xFFFE, vector, 2));
+			Assert::IsTrue(thread.Send(cBreakpoint, 1, 0x0502));
+			Assert::IsTrue(thread.Send(cIRQ));
+			event = NextEvent(thread);
+			Assert::AreEqual((int)eBreakpoint, (int)event.Kind);
+			Assert::AreEqual(0x0502, (int)event.PC);
+			Assert::AreEqual(0xD5, (int)event.A);
+
+			Assert::IsTrue(thread.Send(cStep, 1));
+			event = NextEvent(thread);
+			Assert::AreEqual((int)ePaused, (int)event.Kind);
+			Assert::AreEqual(0x01, (int)event.X);
+
+			Assert::IsTrue(thread.Send(cRun));
+			event = NextEvent(thread);
+			Assert::AreEqual((int)eStopped, (int)event.Kind);
+			Assert::AreEqual((int)srBreak, (int)event.Reason);
+		}
+
+		TEST_METHOD(RUNTHREAD_BUDGET)
+		{
+			Pool pool(1);
+			Machine *machine = pool.Acquire();
+
+			machine->RAM.Write(0x0400, "EE 00 02 4C 00 04"_6502);	// INC $0200, JMP $0400
+			machine->CPU.PC = 0x0400;
+			RunThread thread(machine, -1, 100);
+
+			Assert::IsTrue(thread.Send(cRun, 1000));
+			Event event = NextEvent(thread);
+			Assert::AreEqual((int)eStopped, (int)event.Kind);
+			Assert::AreEqual((int)srBudget, (int)event.Reason);
+			Assert::IsTrue(event.Cycles >= 1000 && event.Cycles < 1010);
+		}
+
+		TEST_METHOD(RUNTHREAD_CLOCK_REBASE)
+		{
+			Pool pool(1);
+			Machine *machine = pool.Acquire();
+
+			// INC $0200, JMP $0400, a clock about to overflow
+			machine->RAM.Write(0x0400, "EE 00 02 4C 00 04"_6502);
+			machine->CPU.PC = 0x0400;
+			machine->CPU.Clock = 0x7FFFFFF0;
+			RunThread thread(machine, -1, 100);
+
+			Assert::IsTrue(thread.Send(cRun, 1000));
+			Event event = NextEvent(thread);
+			Assert::AreEqual((int)srBudget, (int)event.Reason);
+			Assert::IsTrue(event.Cycles >= 1000 && event.Cycles < 1010);
+			Assert::IsTrue(machine->CPU.Clock < 1010);
+		}
+
+		TEST_METHOD(RUNTHREAD_COROUTINE)
+		{
+			Pool pool(1);
+			Machine *machine = pool.Acquire();
+			std::string output;
+			Event last = {};
+			bool done = false;
+
+			// prints "6502" then stops
+			machine->RAM.Write(0x0400, "A2 00 BD 10 04 F0 06 20 D2 FF E8 D0 F5 00"_6502);
+			machine->RAM.Write(0x0410, "36 35 30 32 00"_6502);
+			machine->RAM.Write(0xFFD2, "60"_6502);
+			machine->CPU.PC = 0x0400;
+			machine->CPU.EndOnBreak = true;
+			RunThread thread(machine, 0xFFD2);
+
+			CollectOutput(thread, output, last, done);
+			Assert::IsTrue(thread.Send(cRun));
+			for (int i = 0; i < 100 && !done; i++)
+			{
+				thread.WaitEvent(100);
+				while (thread.Dispatch())
+					;
+			}
+			Assert::IsTrue(done);
+			Assert::AreEqual((int)eStopped, (int)last.Kind);
+			Assert::IsTrue(output == "6502");
+		}
+	};
+
+	TEST_CLASS(CApi)
+	{
+	public:
+		TEST_METHOD(CAPI_POOL)
+		{
+			EmuPool *pool = EmuCreatePool(3);
+			EmuMachine *machines[3];
+
+			Assert::AreEqual(EMU_ABI_VERSION, EmuAbiVersion());
+			for (int i = 0; i < 3; i++)
+				Assert::IsFalse((machines[i] = EmuAcquire(pool)) == nullptr);
+			Assert::IsTrue(EmuAcquire(pool) == nullptr);
+
+			// released out of order, the other handles stay valid
+			EmuFill(machines[2], 0x0200, 0x55, 16);
+			EmuRelease(machines[0]);
+			byte value;
+			EmuRead(machines[2], 0x0200, &value, 1);
+			Assert::AreEqual((byte)0x55, value);
+			Assert::IsFalse((machines[0] = EmuAcquire(pool)) == nullptr);
+			EmuRead(machines[0], 0x0200, &value, 1);
+			Assert::AreEqual((byte)0x00, value);
+
+			// machines still acquired go away with the pool
+			EmuDestroyPool(pool);
+		}
+
+		TEST_METHOD(CAPI_RUN)
+		{
+			EmuPool *pool = EmuCreatePool(2);
+			EmuMachine *machines[2] = {EmuAcquire(pool), EmuAcquire(pool)};
+			const byte code[] = {0xA9, 0xD5, 0x8D, 0x00, 0x03, 0xE8, 0x00};	// LDA #$D5, STA $0300, INX, BRK
+			EmuRegisters registers[2];
+			int32_t reasons[2];
+
+			for (EmuMachine *machine : machines)
+			{
+				Assert::AreEqual(1, EmuLoadBinary(machine, 0x0400, code, sizeof(code)));
+				EmuGetRegisters(machine, &registers[0]);
+				registers[0].PC = 0x0400;
+				registers[0].X = 0x41;
+				EmuSetRegisters(machine, &registers[0]);
+				EmuSetStops(machine, 1, -1);
+			}
+			EmuSetStops(machines[1], 1, 0x0405);
+			int32_t start = registers[0].Clock;
+
+			int64_t cycles = EmuRunMany(machines, 2, 1000, reasons, registers);
+			Assert::AreEqual(cycles, (int64_t)registers[0].Clock - start + registers[1].Clock - start);
+			Assert::AreEqual((int32_t)esBreak, reasons[0]);
+			Assert::AreEqual((int32_t)esBreakpoint, reasons[1]);
+			Assert::AreEqual((word)0x0405, registers[1].PC);
+			Assert::AreEqual((byte)0xD5, registers[0].A);
+			Assert::AreEqual((byte)0x42, registers[0].X);
+			Assert::AreEqual((byte)0x41, registers[1].X);
+			Assert::AreEqual((int32_t)esError, EmuRun(machines[0], -1, nullptr));
+
+			// gather two ranges in one call, the second one wraps around
+			const EmuRange ranges[2] = {{0x0300, 0, 1}, {0xFFFF, 0, 2}};
+			const byte wrapped[2] = {0x11, 0x22};
+			byte buffer[3];
+			EmuWrite(machines[0], 0xFFFF, wrapped, 1);
+			EmuWrite(machines[0], 0x0000, wrapped + 1, 1);
+			Assert::AreEqual((size_t)3, EmuReadRanges(machines[0], ranges, 2, buffer));
+			Assert::AreEqual((byte)0xD5, buffer[0]);
+			Assert::AreEqual((byte)0x11, buffer[1]);
+			Assert::AreEqual((byte)0x22, buffer[2]);
+
+			const byte patch[3] = {1, 2, 3};
+			Assert::AreEqual((size_t)3, EmuWriteRanges(machines[1], ranges, 2, patch));
+			EmuRead(machines[1], 0x0000, buffer, 1);
+			Assert::AreEqual((byte)3, buffer[0]);
+			EmuDestroyPool(pool);
+		}
+
+		TEST_METHOD(CAPI_LOAD)
+		{
+			EmuPool *pool = EmuCreatePool(1);
+			EmuMachine *machine = EmuAcquire(pool);
+			const char hex[] = ":03040000A9D5E893\n:00000001FF\n";
+			const char broken[] = ":03040000A9D5E893\n:0000X001FF\n";
+			EmuLoadError error = {};
+			byte loaded[3];
+
+			Assert::AreEqual(1, EmuLoadHex(machine, hex, sizeof(hex) - 1, &error));
+			EmuRead(machine, 0x0400, loaded, 3);
+			Assert::AreEqual((byte)0xA9, loaded[0]);
+			Assert::AreEqual((byte)0xE8, loaded[2]);
+			Assert::AreEqual(0, EmuLoadHex(machine, broken, sizeof(broken) - 1, &error));
+			Assert::AreEqual(2, (int)error.Line);
+			Assert::IsFalse(error.Message == nullptr);
+			Assert::AreEqual(0, EmuLoadFile(machine, "does not exist.bin", nullptr));
+			EmuDestroyPool(pool);
+		}
+	};
+
+	TEST_CLASS(Services)
+	{
+	public:
+		// LDA #$D5, STA $0300, INX, BRK at $0010
+		ServiceRequest Program(uint32_t Id)
+		{
+			ServiceRequest request = {};
+
+			request.Id = Id;
+			request.Image.assign(0x10, 0xEA);
+			const byte code[] = {0xA9, 0xD5, 0x8D, 0x00, 0x03, 0xE8, 0x00};
+			request.Image.insert(request.Image.end(), code, code + sizeof(code));
+			request.Budget = 1000;
+			request.Entry = 0x0010;
+			request.Stop = -1;
+			request.Flags = sfEndOnBreak | sfDigest;
+			request.Inputs.push_back({0x0301, {0x77}});
+			request.Outputs.push_back({0x0300, std::vector<byte>(2)});
+			return request;
+		}
+
+		TEST_METHOD(SERVICE_PIPELINE)
+		{
+			Service service(1);
+			Machine *instance = service.Acquire();
+			std::vector<byte> input, output;
+			ServiceRequest first = Program(1);
+			ServiceRequest cached = Program(2);
+			ServiceRequest unknown = Program(3);
+			ServiceRequest hex = {};
+
+			Encode(first, input);
+			cached.ImageHash = first.ImageHash;
+			cached.Image.clear();
+			Encode(cached, input);
+			unknown.ImageHash = 0x1234;
+			unknown.Image.clear();
+			Encode(unknown, input);
+			// LDX #$41, BRK at $0400
+			const char text[] = ":03040000A2410016\n:00000001FF\n";
+			hex.Id = 4;
+			hex.Image.assign(text, text + sizeof(text) - 1);
+			hex.Budget = 1000;
+			hex.Entry = 0x0400;
+			hex.Stop = 0x0402;
+			hex.Flags = sfHex;
+			Encode(hex, input);
+
+			// the last byte is missing, the hex request waits for the next call
+			long long used = service.Handle(input.data(), input.size() - 1, output, *instance);
+
+			Assert::AreEqual((long long)(input.size() - hex.Image.size() - ServiceRequestHeader), used);
+			Assert::AreEqual((long long)input.size() - used, service.Handle(input.data() + used, input.size() - used, output, *instance));
+
+			ServiceResponse response, again;
+			size_t offset = Decode(output.data(), output.size(), response);
+
+			Assert::AreEqual((uint32_t)1, response.Id);
+			Assert::AreEqual((byte)ssOk, response.Status);
+			Assert::AreEqual((byte)srBreak, response.Reason);
+			Assert::AreEqual((byte)0xD5, response.A);
+			Assert::AreEqual((byte)0x01, response.X);
+			Assert::AreEqual((size_t)2, response.Outputs.size());
+			Assert::AreEqual((byte)0xD5, response.Outputs[0]);
+			Assert::AreEqual((byte)0x77, response.Outputs[1]);
+			Assert::IsFalse(response.Digest == 0);
+
+			// same run from the cached image
+			Assert::AreEqual((size_t)0, Decode(output.data() + offset, ServiceResponseHeader - 1, again));
+			offset += Decode(output.data() + offset, output.size() - offset, again);
+			Assert::AreEqual((uint32_t)2, again.Id);
+			Assert::AreEqual((byte)ssOk, again.Status);
+			Assert::AreEqual(response.Digest, again.Digest);
+			Assert::AreEqual(response.Cycles, again.Cycles);
+
+			offset += Decode(output.data() + offset, output.size() - offset, response);
+			Assert::AreEqual((uint32_t)3, response.Id);
+			Assert::AreEqual((byte)ssUnknownImage, response.Status);
+			Assert::AreEqual((size_t)0, response.Outputs.size());
+
+			offset += Decode(output.data() + offset, output.size() - offset, response);
+			Assert::AreEqual((uint32_t)4, response.Id);
+			Assert::AreEqual((byte)ssOk, response.Status);
+			Assert::AreEqual((byte)srBreakpoint, response.Reason);
+			Assert::AreEqual((word)0x0402, response.PC);
+			Assert::AreEqual((byte)0x41, response.X);
+			Assert::AreEqual(output.size(), offset);
+			Assert::AreEqual((uint64_t)3, service.Statistics.CacheMisses.load());
+			service.Release(instance);
+		}
+
+		TEST_METHOD(SERVICE_IMAGE_FORMAT)
+		{
+			Service service(1);
+			Machine *instance = service.Acquire();
+			std::vector<byte> input, output;
+			ServiceRequest hex = {}, binary;
+			ServiceResponse response;
+
+			// LDX #$41, BRK at $0400
+			const char text[] = ":03040000A2410016\n:00000001FF\n";
+			hex.Id = 1;
+			hex.Image.assign(text, text + sizeof(text) - 1);
+			hex.Budget = 1000;
+			hex.Entry = 0x0400;
+			hex.Stop = 0x0402;
+			hex.Flags = sfHex;
+			Encode(hex, input);
+			// the same bytes by hash as a raw image: a different image
+			binary = hex;
+			binary.Id = 2;
+			binary.Image.clear();
+			binary.Flags = 0;
+			Encode(binary, input);
+
+			Assert::AreEqual((long long)input.size(), service.Handle(input.data(), input.size(), output, *instance));
+			size_t offset = Decode(output.data(), output.size(), response);
+			Assert::AreEqual((byte)ssOk, response.Status);
+			Assert::AreEqual((byte)0x41, response.X);
+			Decode(output.data() + offset, output.size() - offset, response);
+			Assert::AreEqual((uint32_t)2, response.Id);
+			Assert::AreEqual((byte)ssUnknownImage, response.Status);
+			service.Release(instance);
+		}
+
+		TEST_METHOD(SERVICE_MALFORMED)
+		{
+			Service service(1);
+			Machine *instance = service.Acquire();
+			std::vector<byte> input, output;
+			ServiceRequest request = Program(7);
+			ServiceResponse response;
+
+			// an input range running past the end of the message
+			Encode(request, input);
+			input[ServiceRequestHeader + request.Image.size() + 2] = 0xFF;
+			Assert::AreEqual(-1LL, service.Handle(input.data(), input.size(), output, *instance));
+			Assert::AreEqual(ServiceResponseHeader, Decode(output.data(), output.size(), response));
+			Assert::AreEqual((uint32_t)7, response.Id);
+			Assert::AreEqual((byte)ssBadRequest, response.Status);
+
+			// an image that doesn't match its hash
+			input.clear();
+			output.clear();
+			request.ImageHash = 1;
+			Encode(request, input);
+			Assert::AreEqual((long long)input.size(), service.Handle(input.data(), input.size(), output, *instance));
+			Decode(output.data(), output.size(), response);
+			Assert::AreEqual((byte)ssBadImage, response.Status);
+
+			// 300 outputs of 64kb: a small request asking for a response larger than a message
+			input.clear();
+			output.clear();
+			request = Program(8);
+			request.Outputs.assign(300, {0x0000, std::vector<byte>(1)});
+			Encode(request, input);
+			for (size_t i = 0; i < 300; i++)
+				input[input.size() - i * 4 - 2] = input[input.size() - i * 4 - 1] = 0xFF;
+			Assert::AreEqual(-1LL, service.Handle(input.data(), input.size(), output, *instance));
+			Decode(output.data(), output.size(), response);
+			Assert::AreEqual((uint32_t)8, response.Id);
+			Assert::AreEqual((byte)ssBadRequest, response.Status);
+			service.Release(instance);
+		}
+
+		TEST_METHOD(SERVICE_SOCKET)
+		{
+			const char *path = "emu6502test.sock";
+			Service service(2);
+			std::atomic<bool> running(true);
+
+			Assert::IsTrue(service.Listen(path));
+			std::thread server([&]() { service.Serve(running); });
+
+			ServiceClient client;
+			std::vector<byte> batch;
+			ServiceResponse response;
+
+			Assert::IsTrue(client.Connect(path));
+			for (uint32_t id = 0; id < 100; id++)
+			{
+				ServiceRequest request = Program(id);
+
+				request.Inputs[0].Data[0] = (byte)id;
+				Encode(request, batch);
+			}
+			Assert::IsTrue(client.Send(batch));
+			for (uint32_t id = 0; id < 100; id++)
+			{
+				Assert::IsTrue(client.Receive(response));
+				Assert::AreEqual(id, response.Id);
+				Assert::AreEqual((byte)ssOk, response.Status);
+				Assert::AreEqual((byte)id, response.Outputs[1]);
+			}
+
+			running = false;
+			server.join();
+			Assert::AreEqual((uint64_t)100, service.Statistics.Requests.load());
+			Assert::AreEqual((uint64_t)1, service.Statistics.CacheMisses.load());
+			remove(path);
+		}
+
+		TEST_METHOD(SERVICE_LISTEN_PATH)
+		{
+			const char *path = "emu6502test.sock";
+
+			// a regular file is never deleted
+			FILE *file = fopen(path, "wb");
+			fputc(0x42, file);
+			fclose(file);
+			{
+				Service service(1);
+				Assert::IsFalse(service.Listen(path));
+			}
+			file = fopen(path, "rb");
+			Assert::IsTrue(file != nullptr);
+			Assert::AreEqual(0x42, fgetc(file));
+			fclose(file);
+			remove(path);
+
+			// a live socket is kept, the one left behind once its service is gone is replaced
+			{
+				Service first(1), second(1);
+				Assert::IsTrue(first.Listen(path));
+				Assert::IsFalse(second.Listen(path));
+			}
+			Service third(1);
+			Assert::IsTrue(third.Listen(path));
+			remove(path);
+		}
+	};
+
+	TEST_CLASS(SharedMachines)
+	{
+	public:
+		TEST_METHOD(SHARED_EXPORT)
+		{
+			// left over by a crashed run
+			SharedMachine::Remove("/emu6502test-export");
+
+			SharedMachine *machine = new SharedMachine("/emu6502test-export");
+			SharedView view;
+			SharedRegisters registers;
+
+			Assert::IsTrue(machine->IsOpen());
+			// the name is taken, the live segment is left alone
+			{
+				SharedMachine twin("/emu6502test-export");
+				Assert::IsFalse(twin.IsOpen());
+			}
+			Assert::IsTrue(view.Open("/emu6502test-export"));
+			Assert::IsTrue(view.Read(registers));
+
+			// LDA #$D5, STA $0300, INX, BRK
+			machine->RAM.Write(0x0400, "A9 D5 8D 00 03 E8"_6502, true);
+			machine->CPU.PC = 0x0400;
+			machine->CPU.EndOnBreak = true;
+			Assert::AreEqual((byte)0xA9, view.Memory()[0x0400]);
+			Assert::AreEqual((int)srBreak, (int)machine->Run(1000, 2));
+
+			SharedRegisters after;
+
+			Assert::IsTrue(view.Read(after));
+			Assert::IsTrue(after.Sequence > registers.Sequence);
+			Assert::AreEqual((int64_t)machine->CPU.Clock, after.Clock);
+			Assert::AreEqual(machine->CPU.PC, after.PC);
+			Assert::AreEqual((byte)0xD5, after.A);
+			Assert::AreEqual((byte)0x01, after.X);
+			Assert::AreEqual((byte)0xD5, view.Memory()[0x0300]);
+
+			// loading a binary file copies it into the segment instead of mapping it over
+			const char *filename = "shared.bin";
+			FILE *file = fopen(filename, "wb");
+			for (int i = 0; i < 0x1000; i++)
+				fputc(i & 0xFF, file);
+			fclose(file);
+			Assert::IsTrue(machine->RAM.ReadFile(filename));
+			Assert::AreEqual((byte)0x34, view.Memory()[0x0234]);
+			remove(filename);
+
+			// the segment goes away with the machine
+			delete machine;
+			SharedView gone;
+			Assert::IsFalse(gone.Open("/emu6502test-export"));
+		}
+
+		TEST_METHOD(SHARED_SEQLOCK)
+		{
+			SharedMachine::Remove("/emu6502test-seqlock");
+
+			SharedMachine machine("/emu6502test-seqlock");
+			SharedView view;
+			std::atomic<bool> done(false);
+
+			// INX, INY, JMP $0400: published between instructions, X is Y or Y + 1 depending on PC
+			machine.RAM.Write(0x0400, "E8 C8 4C 00 04"_6502);
+			machine.CPU.PC = 0x0400;
+			Assert::IsTrue(view.Open("/emu6502test-seqlock"));
+
+			std::thread runner([&]() {
+				machine.Run(2000000, 1);
+				done = true;
+			});
+
+			int reads = 0;
+			while (!done)
+			{
+				SharedRegisters registers;
+
+				if (!view.Read(registers))
+					continue;
+				reads++;
+				Assert::AreEqual((byte)(registers.Y + (registers.PC == 0x0401 ? 1 : 0)), registers.X);
+			}
+			runner.join();
+			Assert::IsTrue(reads > 0);
+		}
+	};
+
+	TEST_CLASS(Boards)
+	{
+	public:
+		TEST_METHOD(BOARD_MAILBOX)
+		{
+			Board board(2, 100);
+
+			Assert::IsTrue(board.IsOpen());
+			// CPU 0: LDA #$2A, STA $0210, then spins; CPU 1: waits for $0210, copies it to $0300, BRK
+			board.Core(0).RAM.Write(0x0400, "A9 2A 8D 10 02 4C 05 04"_6502);
+			board.Core(1).RAM.Write(0x0400, "AD 10 02 F0 FB 8D 00 03"_6502, true);
+			for (int i = 0; i < 2; i++)
+			{
+				board.Core(i).CPU.PC = 0x0400;
+				board.Core(i).CPU.EndOnBreak = true;
+			}
+			board.Share(0x02);
+
+			Assert::IsTrue(board.Run(100000));
+			Assert::IsFalse(board.IsStopped(0));
+			Assert::IsTrue(board.IsStopped(1));
+			Assert::AreEqual((int)srBreak, (int)board.Reason(1));
+			Assert::AreEqual((byte)0x2A, board.Core(1).RAM[0x0300]);
+			// private pages stay private
+			Assert::AreEqual((byte)0x00, board.Core(0).RAM[0x0300]);
+			// the write lands at the end of the first quantum, CPU 1 sees it in the second one
+			Assert::IsTrue(board.Cycles(1) > 100 && board.Cycles(1) < 300);
+			// the cores keep their own clock running across the quanta
+			Assert::AreEqual(board.Cycles(1), (uint64_t)board.Core(1).CPU.Clock);
+			Assert::AreEqual((uint64_t)100000, board.Time);
+		}
+
+		TEST_METHOD(BOARD_SHARED_COUNTER)
+		{
+			Board board(2, 100);
+
+			// INC $0200, INC $0210,X, BRK: both CPUs increment the same counter and one of their own
+			for (int i = 0; i < 2; i++)
+			{
+				board.Core(i).RAM.Write(0x0400, "EE 00 02 FE 10 02"_6502, true);
+				board.Core(i).CPU.PC = 0x0400;
+				board.Core(i).CPU.X = (byte)i;
+				board.Core(i).CPU.EndOnBreak = true;
+			}
+			board.Share(0x02);
+
+			Assert::IsFalse(board.Run(1000));
+			for (int i = 0; i < 2; i++)
+			{
+				// accesses aren't serialised, both read 0 and the last one wins
+				Assert::AreEqual((byte)0x01, board.Core(i).RAM[0x0200]);
+				// one writer per byte loses nothing
+				Assert::AreEqual((byte)0x01, board.Core(i).RAM[0x0210]);
+				Assert::AreEqual((byte)0x01, board.Core(i).RAM[0x0211]);
+			}
+		}
+
+		TEST_METHOD(BOARD_CLOCK_REBASE)
+		{
+			Board board(2, 1000, false);
+
+			// INC $0300, JMP $0400 on clocks about to overflow
+			for (int i = 0; i < 2; i++)
+			{
+				board.Core(i).RAM.Write(0x0400, "EE 00 03 4C 00 04"_6502);
+				board.Core(i).CPU.PC = 0x0400;
+				board.Core(i).CPU.Clock = 0x7FFFFFF0;
+			}
+
+			Assert::IsTrue(board.Run(10000));
+			for (int i = 0; i < 2; i++)
+			{
+				Assert::IsTrue(board.Cycles(i) >= 10000 && board.Cycles(i) < 10006);
+				Assert::IsTrue(board.Core(i).CPU.Clock < 10006);
+			}
+		}
+
+		// every CPU hammers the same shared bytes and mixes them into private memory
+		void RunContention(bool Threads, uint64_t Digests[4], uint64_t Cycles[4], uint64_t Shared[4])
+		{
+			Board board(4, 997, Threads);
+
+			for (int i = 0; i < 4; i++)
+			{
+				// INC $0200, INC $0210,X, LDA $0200, ADC $0210,X, STA $0220, STA $0300,X, JMP $0400
+				board.Core(i).RAM.Write(0x0400, "EE 00 02 FE 10 02 AD 00 02 7D 10 02 8D 20 02 9D 00 03 4C 00 04"_6502);
+				board.Core(i).CPU.PC = 0x0400;
+				board.Core(i).CPU.X = (byte)i;
+			}
+			board.Share(0x02);
+			for (int run = 0; run < 10; run++)
+				board.Run(20000);
+			for (int i = 0; i < 4; i++)
+			{
+				Digests[i] = board.Core(i).RAM.Digest();
+				Cycles[i] = board.Cycles(i);
+				Shared[i] = board.Core(i).RAM.PageDigest(0x02);
+			}
+		}
+
+		TEST_METHOD(BOARD_DETERMINISTIC)
+		{
+			uint64_t digests[3][4], cycles[3][4], shared[4];
+
+			RunContention(false, digests[0], cycles[0], shared);
+			RunContention(true, digests[1], cycles[1], shared);
+			RunContention(true, digests[2], cycles[2], shared);
+			for (int i = 0; i < 4; i++)
+			{
+				Assert::AreEqual(digests[0][i], digests[1][i]);
+				Assert::AreEqual(digests[0][i], digests[2][i]);
+				Assert::AreEqual(cycles[0][i], cycles[1][i]);
+			}
+			// same shared page everywhere, different private ones
+			for (int i = 1; i < 4; i++)
+				Assert::AreEqual(shared[0], shared[i]);
+			Assert::AreNotEqual(digests[0][0], digests[0][1]);
+		}
+	};
+
+	// keeps every write it gets
+	class RecordingDevice : public Device
+	{
+	public:
+		std::vector<word> Addresses;
+		std::vector<byte> Values;
+
+		void Write(word Address, byte Value) override
+		{
+			Addresses.push_back(Address);
+			Values.push_back(Value);
+		}
+	};
+
+	TEST_CLASS(Devices)
+	{
+	public:
+		TEST_METHOD(PAGES_ROM)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			const byte data[2] = {0x11, 0x22};
+
+			memory[0xE000] = 0x5A;
+			memory.SetPages(0xE0, 2, ptROM);
+			Assert::AreEqual((int)ptROM, (int)memory.GetPage(0xE1));
+			Assert::AreEqual((int)ptRAM, (int)memory.GetPage(0xE2));
+			// LDA #$A5, STA $E000, INC $E000, STA $E200, BRK
+			memory.Write(0x0400, "A9 A5 8D 00 E0 EE 00 E0 8D 00 E2"_6502, true);
+			cpu.PC = 0x0400;
+			cpu.EndOnBreak = true;
+			Assert::AreEqual((int)srBreak, (int)cpu.Run(1000));
+			Assert::AreEqual((byte)0x5A, memory[0xE000]);
+			Assert::AreEqual((byte)0xA5, memory[0xE200]);
+			// bulk copies skip the ROM pages but not the RAM around them
+			memory.CopyIn(0xDFFF, data, 2);
+			Assert::AreEqual((byte)0x11, memory[0xDFFF]);
+			Assert::AreEqual((byte)0x5A, memory[0xE000]);
+			// raw accesses still go through, like a ROM image being loaded
+			memory[0xE000] = 0x77;
+			Assert::AreEqual((byte)0x77, memory[0xE000]);
+			memory.SetPages(0xE0, 2, ptRAM);
+			memory.Fill(0xE000, 0x33, 1);
+			Assert::AreEqual((byte)0x33, memory[0xE000]);
+		}
+
+		TEST_METHOD(PAGES_DEVICE)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			RecordingDevice device;
+			const byte data[3] = {1, 2, 3};
+
+			memory.Attach(&device, 0xC0);
+			// LDA #$42, STA $C010, INC $C010, STA $C110, BRK
+			memory.Write(0x0400, "A9 42 8D 10 C0 EE 10 C0 8D 10 C1"_6502, true);
+			cpu.PC = 0x0400;
+			cpu.EndOnBreak = true;
+			Assert::AreEqual((int)srBreak, (int)cpu.Run(1000));
+			Assert::AreEqual((size_t)2, device.Addresses.size());
+			Assert::AreEqual((word)0xC010, device.Addresses[0]);
+			Assert::AreEqual((byte)0x42, device.Values[0]);
+			Assert::AreEqual((byte)0x43, device.Values[1]);
+			// a copy over the page boundary only reports the bytes in the device page
+			memory.CopyIn(0xC0FE, data, 3);
+			Assert::AreEqual((size_t)4, device.Addresses.size());
+			Assert::AreEqual((word)0xC0FF, device.Addresses[3]);
+			Assert::AreEqual((byte)2, device.Values[3]);
+			memory.Detach(&device);
+			memory.Fill(0xC000, 0, 0x100);
+			Assert::AreEqual((size_t)4, device.Addresses.size());
+			Assert::AreEqual((int)ptRAM, (int)memory.GetPage(0xC0));
+		}
+
+		TEST_METHOD(PAGES_COPY)
+		{
+			Memory memory;
+
+			for (int i = 0; i < 0x300; i++)
+				memory[(word)(0x1000 + i)] = (byte)i;
+			// overlapping both ways, then wrapping around $FFFF
+			memory.Copy(0x1001, 0x1000, 0x2FF);
+			Assert::AreEqual((byte)0x00, memory[0x1001]);
+			Assert::AreEqual((byte)0xFE, memory[0x12FF]);
+			memory.Copy(0x1000, 0x1001, 0x2FF);
+			Assert::AreEqual((byte)0x00, memory[0x1000]);
+			Assert::AreEqual((byte)0xFE, memory[0x12FE]);
+			memory.Copy(0xFFF0, 0x1000, 0x20);
+			Assert::AreEqual((byte)0x00, memory[0xFFF0]);
+			Assert::AreEqual((byte)0x1F, memory[0x000F]);
+		}
+
+		TEST_METHOD(DMA_TRANSFER)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			Dma dma(cpu, memory, 0xD0);
+
+			for (int i = 0; i < 0x100; i++)
+				memory[(word)(0x1000 + i)] = (byte)(i ^ 0x5A);
+			// source $1000, destination $2000, length $100, CLI, start with an interrupt, then spin
+			memory.Write(0x0400, "A9 00 8D 00 D0 A9 10 8D 01 D0 A9 20 8D 03 D0 A9 01 8D 05 D0 58 A9 03 8D 06 D0 4C 1A 04"_6502);
+			// IRQ handler: LDA $D007, STA $0300, STA $D007, BRK
+			memory.Write(0x0500, "AD 07 D0 8D 00 03 8D 07 D0"_6502, true);
+			memory[0xFFFE] = 0x00;
+			memory[0xFFFF] = 0x05;
+			cpu.PC = 0x0400;
+			cpu.EndOnBreak = true;
+			Assert::AreEqual((int)srBreak, (int)cpu.Run(10000));
+			for (int i = 0; i < 0x100; i++)
+				Assert::AreEqual((byte)(i ^ 0x5A), memory[(word)(0x2000 + i)]);
+			Assert::AreEqual((byte)dsDone, memory[0x0300]);
+			Assert::AreEqual((byte)0x00, memory[0xD007]);
+			Assert::AreEqual((byte)dcInterrupt, memory[0xD006]);
+			Assert::AreEqual((uint64_t)1, dma.Transfers);
+			Assert::AreEqual((uint64_t)0x100, dma.Bytes);
+			Assert::AreEqual((uint64_t)(4 + 0x100), dma.StolenCycles);
+			Assert::IsTrue(cpu.Clock > 4 + 0x100);
+
+			// length 0: nothing copied, the transfer completes with its setup cost
+			const byte empty[7] = {0x00, 0x10, 0x00, 0x30, 0x00, 0x00, dcStart};
+			memory.CopyIn(0xD000, empty, 7);
+			Assert::AreEqual((byte)0x00, memory[0x3000]);
+			Assert::AreEqual((byte)dsDone, memory[0xD007]);
+			Assert::AreEqual((uint64_t)2, dma.Transfers);
+			Assert::AreEqual((uint64_t)0x100, dma.Bytes);
+			Assert::AreEqual((uint64_t)(4 + 0x100 + 4), dma.StolenCycles);
+		}
+	};
+
+	TEST_CLASS(BlockDevices)
+	{
+	public:
+		TEST_METHOD(BLOCK_READ_WRITE)
+		{
+			const char *filename = "emu6502test.img";
+			FILE *file = fopen(filename, "wb");
+			for (int i = 0; i < 0x980; i++)
+				fputc((i * 7 ^ i >> 8) & 0xFF, file);
+			fclose(file);
+
+			MappedFile image(filename);
+			Memory memory, other;
+			Processor cpu(&memory), otherCpu(&other);
+			BlockDevice disk(cpu, memory, 0xD1, image), otherDisk(otherCpu, other, 0xD1, image);
+
+			Assert::AreEqual((size_t)10, disk.Sectors());
+			// sectors 2 and 3 to $3000, BRK
+			memory.Write(0x0400, "A9 02 8D 00 D1 A9 30 8D 03 D1 A9 02 8D 04 D1 A9 01 8D 05 D1"_6502, true);
+			cpu.PC = 0x0400;
+			cpu.EndOnBreak = true;
+			Assert::AreEqual((int)srBreak, (int)cpu.Run(10000));
+			for (int i = 0x200; i < 0x400; i++)
+				Assert::AreEqual((byte)((i * 7 ^ i >> 8) & 0xFF), memory[(word)(0x2E00 + i)]);
+			Assert::AreEqual((byte)bsDone, memory[0xD106]);
+			Assert::AreEqual((byte)0x00, memory[0xD105]);
+			Assert::AreEqual((uint64_t)(100 + 2 * 256), disk.StolenCycles);
+
+			// the partial last sector from $4000, the registers written by a bulk copy
+			const byte write[6] = {9, 0, 0x00, 0x40, 1, bcWrite};
+			memory.Fill(0x4000, 0xEE, 0x100);
+			memory.CopyIn(0xD100, write, 6);
+			Assert::AreEqual((byte)bsDone, memory[0xD106]);
+			Assert::AreEqual((size_t)1, disk.DirtySectors());
+			Assert::AreEqual((uint64_t)(2 * 100 + 2 * 256 + 256), disk.StolenCycles);
+
+			// read it back, the other device still sees the image
+			const byte read[6] = {9, 0, 0x00, 0x50, 1, bcRead};
+			memory.CopyIn(0xD100, read, 6);
+			other.CopyIn(0xD100, read, 6);
+			Assert::AreEqual((byte)0xEE, memory[0x50FF]);
+			Assert::AreEqual((byte)((0x900 * 7 ^ 9) & 0xFF), other[0x5000]);
+			Assert::AreEqual((byte)0x00, other[0x50FF]);
+			// past the end of the image
+			const byte past[6] = {10, 0, 0x00, 0x50, 1, bcRead};
+			memory.CopyIn(0xD100, past, 6);
+			Assert::AreEqual((byte)(bsDone | bsError), memory[0xD106]);
+
+			Assert::IsTrue(disk.WriteBack(filename));
+			disk.Discard();
+			Assert::AreEqual((size_t)0, disk.DirtySectors());
+
+			MappedFile saved(filename);
+			Assert::AreEqual((size_t)0xA00, saved.Length());
+			Assert::AreEqual((byte)0xEE, saved.Data()[0x9FF]);
+			Assert::AreEqual((byte)((0x8FF * 7 ^ 8) & 0xFF), saved.Data()[0x8FF]);
+			remove(filename);
+		}
+
+		TEST_METHOD(BLOCK_READ_ONLY)
+		{
+			const char *filename = "emu6502test.img";
+			FILE *file = fopen(filename, "wb");
+			for (int i = 0; i < 0x400; i++)
+				fputc(i & 0xFF, file);
+			fclose(file);
+
+			MappedFile image(filename);
+			Memory memory;
+			Processor cpu(&memory);
+			BlockDevice disk(cpu, memory, 0xD1, image, true);
+
+			disk.Timing = {10, 100, 50, 2};
+			// sector 3 (track 1) from $0300 with an interrupt
+			const byte write[6] = {3, 0, 0x00, 0x03, 1, bcWrite | bcInterrupt};
+			memory.CopyIn(0xD100, write, 6);
+			Assert::AreEqual((byte)(bsDone | bsError), memory[0xD106]);
+			Assert::AreEqual((size_t)0, disk.DirtySectors());
+			Assert::AreEqual(10, cpu.Clock);
+			// reading it moves the head one track
+			const byte read[6] = {3, 0, 0x00, 0x03, 1, bcRead};
+			memory.CopyIn(0xD100, read, 6);
+			Assert::AreEqual((byte)bsDone, memory[0xD106]);
+			Assert::AreEqual(10 + 10 + 100 + 50, cpu.Clock);
+			Assert::AreEqual((byte)0x00, memory[0x0300]);
+			remove(filename);
+		}
+
+		TEST_METHOD(BLOCK_READ_OWN_PAGE)
+		{
+			// every register slot of the sector reads sector 0 onto the device page again
+			const char *filename = "emu6502test.img";
+			const byte slot[8] = {0, 0, 0x00, 0xD1, 1, bcRead, 0, 0};
+			FILE *file = fopen(filename, "wb");
+			for (int i = 0; i < 0x100; i++)
+				fputc(slot[i & 7], file);
+			fclose(file);
+
+			MappedFile image(filename);
+			Memory memory;
+			Processor cpu(&memory);
+			BlockDevice disk(cpu, memory, 0xD1, image);
+
+			// the commands landing on the page are ignored while the read runs
+			memory.CopyIn(0xD100, slot, 6);
+			Assert::AreEqual((uint64_t)1, disk.SectorsRead);
+			Assert::AreEqual((byte)0x00, memory[0xD105]);
+			Assert::AreEqual((byte)bsDone, memory[0xD106]);
+			Assert::AreEqual((byte)bcRead, memory[0xD10D]);
+			Assert::AreEqual(100 + 256, cpu.Clock);
+			remove(filename);
+		}
+	};
+
+	TEST_CLASS(TextScreens)
+	{
+	public:
+		TEST_METHOD(SCREEN_RENDER)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			TextScreen screen(memory, 0x8000);
+			char buffer[TextScreen::RenderCapacity];
+
+			Assert::AreEqual((int)ptDevice, (int)memory.GetPage(0x83));
+			Assert::AreEqual((int)ptRAM, (int)memory.GetPage(0x84));
+			// the first render draws everything
+			Assert::AreEqual(TextScreen::Cells + 25 * 6 + 16 * 1, (int)screen.Render(buffer, sizeof(buffer)));
+			Assert::IsFalse(screen.IsDirty());
+			Assert::AreEqual((size_t)0, screen.Render(buffer, sizeof(buffer)));
+
+			// LDA #'H', STA $8029, LDA #'I', STA $802A, STA $802E, STA $83E7, BRK
+			memory.Write(0x0400, "A9 48 8D 29 80 A9 49 8D 2A 80 8D 2E 80 8D E7 83"_6502, true);
+			cpu.PC = 0x0400;
+			cpu.EndOnBreak = true;
+			cpu.Run(1000);
+			Assert::IsTrue(screen.IsDirty());
+			// row 2 from column 2 to 7, printed through the gap, then the last cell
+			size_t length = screen.Render(buffer, sizeof(buffer));
+			Assert::AreEqual(std::string("\x1B[2;2HHI   I\x1B[25;40HI"), std::string(buffer, length));
+			Assert::AreEqual((size_t)0, screen.Render(buffer, sizeof(buffer)));
+			// raw writes aren't seen
+			memory[0x8000] = 'A';
+			Assert::IsFalse(screen.IsDirty());
+		}
+
+		TEST_METHOD(SCREEN_FRAME)
+		{
+			Memory memory;
+			TextScreen screen(memory, 0x8010);
+			char buffer[TextScreen::FrameCapacity];
+			const byte text[3] = {'a', 0x01, 'c'};
+
+			memory.CopyIn(0x8010 + 24 * 40 + 37, text, 3);
+			memory.CopyIn(0x8010 + 1000, text, 3);
+			Assert::AreEqual(TextScreen::FrameCapacity, screen.Frame(buffer, sizeof(buffer)));
+			Assert::AreEqual(std::string("a c\n"), std::string(buffer + TextScreen::FrameCapacity - 4, 4));
+			Assert::AreEqual('\n', buffer[40]);
+			Assert::IsFalse(screen.IsDirty());
+			// past the screen
+			memory.Fill(0x8010 + 1000, 'x', 16);
+			Assert::IsFalse(screen.IsDirty());
+			// too small a buffer: the run is left for the next call
+			char small[8];
+			memory.Fill(0x8010, 'x', 4);
+			Assert::AreEqual((size_t)0, screen.Render(small, sizeof(small)));
+			Assert::IsTrue(screen.IsDirty());
+			Assert::AreEqual((uint64_t)TextScreen::Cells, screen.CellsRendered);
+		}
+	};
+
+	TEST_CLASS(MathDevices)
+	{
+	public:
+		TEST_METHOD(MATH_MULTIPLY)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			MathDevice math(cpu, memory, 0xD2);
+
+			// $1234 x $5678, copies the product to $0300, BRK
+			memory.Write(0x0400, "A9 34 8D 00 D2 A9 12 8D 01 D2 A9 78 8D 04 D2 A9 56 8D 05 D2 A9 01 8D 06 D2 "
+				"AD 08 D2 8D 00 03 AD 09 D2 8D 01 03 AD 0A D2 8D 02 03 AD 0B D2 8D 03 03"_6502, true);
+			cpu.PC = 0x0400;
+			cpu.EndOnBreak = true;
+			Assert::AreEqual((int)srBreak, (int)cpu.Run(1000));
+			Assert::AreEqual((byte)0x60, memory[0x0300]);
+			Assert::AreEqual((byte)0x00, memory[0x0301]);
+			Assert::AreEqual((byte)0x26, memory[0x0302]);
+			Assert::AreEqual((byte)0x06, memory[0x0303]);
+			Assert::AreEqual((byte)msDone, memory[0xD207]);
+			Assert::AreEqual((byte)0x00, memory[0xD206]);
+			Assert::AreEqual((uint64_t)8, math.StolenCycles);
+
+			// BCD in the second set of registers: 1234 x 5678 = 7006652
+			const byte decimal[7] = {0x34, 0x12, 0x00, 0x00, 0x78, 0x56, moMultiplyBCD};
+			memory.CopyIn(0xD210, decimal, 7);
+			Assert::AreEqual((byte)0x52, memory[0xD218]);
+			Assert::AreEqual((byte)0x66, memory[0xD219]);
+			Assert::AreEqual((byte)0x00, memory[0xD21A]);
+			Assert::AreEqual((byte)0x07, memory[0xD21B]);
+			Assert::AreEqual((byte)0x60, memory[0xD208]);
+			// not a decimal digit
+			const byte invalid[7] = {0x3A, 0x12, 0x00, 0x00, 0x78, 0x56, moMultiplyBCD};
+			memory.CopyIn(0xD210, invalid, 7);
+			Assert::AreEqual((byte)(msDone | msError), memory[0xD217]);
+			Assert::AreEqual((byte)0x52, memory[0xD218]);
+		}
+
+		TEST_METHOD(MATH_DIVIDE)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			MathDevice math(cpu, memory, 0xD2);
+
+			math.DivideCycles = 20;
+			// $12345678 / $1234 = $10004 remainder $0DA8
+			const byte binary[7] = {0x78, 0x56, 0x34, 0x12, 0x34, 0x12, moDivide};
+			memory.CopyIn(0xD200, binary, 7);
+			Assert::AreEqual((byte)msDone, memory[0xD207]);
+			Assert::AreEqual((byte)0x04, memory[0xD208]);
+			Assert::AreEqual((byte)0x00, memory[0xD209]);
+			Assert::AreEqual((byte)0x01, memory[0xD20A]);
+			Assert::AreEqual((byte)0x00, memory[0xD20B]);
+			Assert::AreEqual((byte)0xA8, memory[0xD20C]);
+			Assert::AreEqual((byte)0x0D, memory[0xD20D]);
+			Assert::AreEqual(20, cpu.Clock);
+			// BCD: 12345678 / 1000 = 12345 remainder 678
+			const byte decimal[7] = {0x78, 0x56, 0x34, 0x12, 0x00, 0x10, moDivideBCD};
+			memory.CopyIn(0xD200, decimal, 7);
+			Assert::AreEqual((byte)0x45, memory[0xD208]);
+			Assert::AreEqual((byte)0x23, memory[0xD209]);
+			Assert::AreEqual((byte)0x01, memory[0xD20A]);
+			Assert::AreEqual((byte)0x78, memory[0xD20C]);
+			Assert::AreEqual((byte)0x06, memory[0xD20D]);
+			// division by zero
+			const byte zero[7] = {0x78, 0x56, 0x34, 0x12, 0x00, 0x00, moDivide};
+			memory.CopyIn(0xD200, zero, 7);
+			Assert::AreEqual((byte)(msDone | msError), memory[0xD207]);
+			Assert::AreEqual((uint64_t)3, math.Operations);
+			// unknown operation: rejected without stealing any cycle
+			const byte unknown = 0x7F;
+			int clock = cpu.Clock;
+			memory.CopyIn(0xD206, &unknown, 1);
+			Assert::AreEqual((byte)(msDone | msError), memory[0xD207]);
+			Assert::AreEqual(clock, cpu.Clock);
+		}
+	};
+
+	TEST_CLASS(Profilers)
+	{
+	public:
+		TEST_METHOD(PROFILER_BRACKET)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			Profiler profiler(cpu, memory, 0xD3);
+
+			// start slot 2, LDX #10, DEX, BNE -3, stop slot 2, latch, BRK
+			memory.Write(0x0400, "A9 02 8D 09 D3 A2 0A CA D0 FD A9 02 8D 0A D3 A9 01 8D 00 D3"_6502, true);
+			cpu.PC = 0x0400;
+			cpu.EndOnBreak = true;
+			Assert::AreEqual((int)srBreak, (int)cpu.Run(1000));
+
+			const Profiler::Slot &slot = profiler.Profile[2];
+			uint64_t total = 0, counter = 0;
+
+			for (int i = 7; i >= 0; i--)
+			{
+				total = total << 8 | memory[0xD310 + 2 * 8 + i];
+				counter = counter << 8 | memory[0xD301 + i];
+			}
+			Assert::AreEqual((uint64_t)1, slot.Count);
+			Assert::IsFalse(slot.Running);
+			// at least the loop, less than the whole program
+			Assert::IsTrue(slot.Total >= 10 * 4 && slot.Total < (uint64_t)cpu.Clock - 10);
+			Assert::AreEqual(slot.Total, total);
+			Assert::AreEqual(slot.Total, (uint64_t)(memory[0xD30B] | memory[0xD30C] << 8));
+			Assert::AreEqual(profiler.Counter, counter);
+			Assert::IsTrue(counter > slot.Total && counter <= (uint64_t)cpu.Clock);
+			Assert::AreEqual((uint64_t)0, profiler.Profile[0].Count);
+
+			// reset clears the slots and their registers
+			memory.Fill(0xD300, pcReset, 1);
+			Assert::AreEqual((uint64_t)0, profiler.Profile[2].Total);
+			Assert::AreEqual((byte)0x00, memory[0xD320]);
+		}
+
+		TEST_METHOD(PROFILER_REBASE_REPORT)
+		{
+			Memory memory;
+			Processor cpu(&memory);
+			Profiler profiler(cpu, memory, 0xD3);
+			char buffer[1024];
+
+			cpu.Clock = ClockRebase - 0x10;
+			profiler.Resync();
+			profiler.Profile[5].Name = "decompress";
+			memory.Fill(0xD309, 5, 1);
+			// the host rebases its clock in the middle of the bracket, the 0x10 cycles before are lost
+			cpu.Clock = 0x100;
+			memory.Fill(0xD30A, 5, 1);
+			// stopping a slot that isn't running does nothing
+			memory.Fill(0xD30A, 5, 1);
+			memory.Fill(0xD30A, 9, 1);
+			Assert::AreEqual((uint64_t)1, profiler.Profile[5].Count);
+			Assert::AreEqual((uint64_t)0x100, profiler.Profile[5].Total);
+			Assert::AreEqual((uint64_t)0x100, profiler.Now());
+
+			size_t length = profiler.Report(buffer, sizeof(buffer));
+			std::string report(buffer, length);
+			Assert::IsTrue(report.find("decompress") == 0);
+			Assert::IsTrue(report.find(" 256 cycles") != std::string::npos);
+			Assert::AreEqual(length - 1, report.find('\n'));
+		}
+	};
+
+	// native version of the routine at $2000: fills X bytes (256 for 0) with A from the pointer at $FB
+	static bool FillHook(Processor &CPU, Memory &RAM)
+	{
+		word destination = (word)(RAM[0x00FB] | RAM[0x00FC] << 8);
+
+		RAM.Fill(destination, CPU.A, CPU.X == 0 ? 0x100 : CPU.X);
+		// what the loop leaves behind: Y counted up to X, DEX cleared X
+		CPU.Y = CPU.X;
+		CPU.X = 0;
+		CPU.P = (CPU.P & ~fNegative) | fZero;
+		return true;
+	}
+
+	// only handles even counts
+	static bool EvenFillHook(Processor &CPU, Memory &RAM)
+	{
+		return (CPU.X & 1) == 0 && FillHook(CPU, RAM);
+	}
+
+	TEST_CLASS(HleHooks)
+	{
+	public:
+		// LDY #0, loop: STA ($FB),Y, INY, DEX, BNE loop, RTS
+		// main: pointer to $3000, LDA #$AA, LDX #Count, JSR $2000, STA $0300, BRK
+		void RunFill(Memory &Ram, Processor &Cpu, byte Count)
+		{
+			Ram.Write(0x2000, "A0 00 91 FB C8 CA D0 FA 60"_6502);
+			Ram.Write(0x0400, "A9 00 85 FB A9 30 85 FC A9 AA A2 00 20 00 20 8D 00 03"_6502, true);
+			Ram[0x040B] = Count;
+			Cpu.PC = 0x0400;
+			Cpu.S = 0xFF;
+			Cpu.EndOnBreak = true;
+			Assert::AreEqual((int)srBreak, (int)Cpu.Run(100000));
+		}
+
+		TEST_METHOD(HOOK_VALIDATE)
+		{
+			HookTable hooks;
+			Memory memory, reference;
+			Processor cpu(&memory), real(&reference);
+
+			hooks.Add(0x2000, FillHook, 20);
+			cpu.Hooks = &hooks;
+			RunFill(memory, cpu, 0x40);
+			// the same run with the hook switched off
+			hooks.Enable(0x2000, false);
+			Assert::IsFalse(hooks.IsEnabled(0x2000));
+			real.Hooks = &hooks;
+			RunFill(reference, real, 0x40);
+
+			Assert::AreEqual(reference.Digest(), memory.Digest());
+			Assert::AreEqual((byte)0xAA, memory[0x303F]);
+			Assert::AreEqual((byte)0x00, memory[0x3040]);
+			Assert::AreEqual(real.A, cpu.A);
+			Assert::AreEqual(real.X, cpu.X);
+			Assert::AreEqual(real.Y, cpu.Y);
+			Assert::AreEqual(real.S, cpu.S);
+			Assert::AreEqual(real.P, cpu.P);
+			Assert::AreEqual(real.PC, cpu.PC);
+			// the body is LDY #0 then 64 times STA (zp),Y, INY, DEX, BNE (17 cycles), the last BNE not taken,
+			// the hook charges 20 in its place and the JSR and RTS cost the same both ways
+			Assert::AreEqual(real.Clock - (2 + 0x40 * 17 - 1) + 20, cpu.Clock);
+		}
+
+		TEST_METHOD(HOOK_FALLBACK)
+		{
+			HookTable hooks;
+			Memory memory;
+			Processor cpu(&memory);
+			cpu.Hooks = &hooks;
+
+			hooks.Add(0x2000, EvenFillHook, 20);
+			RunFill(memory, cpu, 0x10);
+			int hooked = cpu.Clock;
+			// odd count: the hook gives up and the 6502 code runs
+			cpu.Clock = 0;
+			RunFill(memory, cpu, 0x11);
+			Assert::IsTrue(cpu.Clock > hooked + 0x10 * 10);
+			Assert::AreEqual((byte)0xAA, memory[0x3010]);
+			// removed
+			hooks.Remove(0x2000);
+			Assert::IsTrue(hooks.Find(0x2000) == nullptr);
+			cpu.Clock = 0;
+			RunFill(memory, cpu, 0x10);
+			Assert::IsTrue(cpu.Clock > hooked + 0x10 * 10);
+			// no table at all
+			hooks.Add(0x2000, FillHook, 20);
+			cpu.Hooks = nullptr;
+			cpu.Clock = 0;
+			RunFill(memory, cpu, 0x10);
+			Assert::IsTrue(cpu.Clock > hooked + 0x10 * 10);
+			cpu.Hooks = &hooks;
+			cpu.Clock = 0;
+			RunFill(memory, cpu, 0x10);
+			Assert::AreEqual(hooked, cpu.Clock);
+		}
+	};
 }
\ No newline at end of file